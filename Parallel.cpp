@@ -34,6 +34,7 @@
 */
 
 #include "Parallel.h"
+#include "ParallelStats.h"
 //#include "smc.h"
 
 // Data bus  16-bit bus not fully supported because D8/D9 pins (PC10/PC11) are not connected on the DUE.
@@ -99,6 +100,10 @@ const PinDescription ReadPin =
 const PinDescription WritePin =
 	{ PIOC, PIO_PC18A_NWE,        ID_PIOC, PIO_PERIPH_A, PIO_PULLUP, PIN_ATTR_DIGITAL,                  NO_ADC, NO_ADC, NOT_ON_PWM,  NOT_ON_TIMER }; // PIN 45
 
+// The pull-up keeps NWAIT released when nothing drives it
+const PinDescription WaitPin =
+	{ PIOA, PIO_PA4B_NWAIT,       ID_PIOA, PIO_PERIPH_B, PIO_PULLUP, PIN_ATTR_DIGITAL,                  NO_ADC, NO_ADC, NOT_ON_PWM,  NOT_ON_TIMER }; // AD5
+
 // Note that PB24 (NCS2) is not connected on the DUE board.
 const PinDescription ChipSelectPins[]=
 {	
@@ -117,6 +122,24 @@ const uint32_t chipSelectAddresses[] =
 	0x63000000
 };
 
+// Bus resources shared by every ParallelClass instance.  Each device only
+// adds the pins it needs on top of what earlier begin() calls set up, so 
+// devices on different chip selects can be started in any order.
+static uint32_t busDataPins = 0;		// bit n set when Dn is configured
+static uint32_t busAddressPins = 0;		// bit n set when An is configured
+static bool busReadPin = false;
+static bool busWritePin = false;
+static bool busWaitPin = false;
+static bool busClockEnabled = false;
+
+static void configurePin(const PinDescription &pin)
+{
+	PIO_Configure(pin.pPort,
+		pin.ulPinType,
+		pin.ulPin,
+		pin.ulPinConfiguration);
+}
+
 void ParallelClass::begin(  ParallelBusWidth_t width, 
 							              ParallelChipSelect_t cs, 
 							              uint8_t numAddressLines, 
@@ -127,10 +150,13 @@ void ParallelClass::begin(  ParallelBusWidth_t width,
 	
 	// Save the chip select
 	_cs = cs;
+	_width = width;
+	_waitHandler = NULL;
+	_waitTimeouts = 0;
 	
 	// Configure GPIOs
 	// Data Bus
-	if (width == PARALLEL_BUS_WIDTH_16)
+	if (width != PARALLEL_BUS_WIDTH_8)
 	{
 		dataPinCount = 16;
 	}
@@ -141,10 +167,15 @@ void ParallelClass::begin(  ParallelBusWidth_t width,
 	
 	for (int i=0; i < dataPinCount; i++)
 	{
-		PIO_Configure(DataPins[i].pPort,
-			DataPins[i].ulPinType,
-			DataPins[i].ulPin,
-			DataPins[i].ulPinConfiguration);
+		// D8/D9 aren't used in the packed 14-bit mode, leave them as GPIO
+		if ((width == PARALLEL_BUS_WIDTH_14) && ((i == 8) || (i == 9)))
+			continue;
+		
+		if (busDataPins & (1u << i))
+			continue;
+		
+		configurePin(DataPins[i]);
+		busDataPins |= (1u << i);
 	}
 	
 	// address bus
@@ -155,26 +186,23 @@ void ParallelClass::begin(  ParallelBusWidth_t width,
 	
 	for (int i=0; i < numAddressLines; i++)
 	{
-		PIO_Configure(AddressPins[i].pPort,
-			AddressPins[i].ulPinType,
-			AddressPins[i].ulPin,
-			AddressPins[i].ulPinConfiguration);
+		if (busAddressPins & (1u << i))
+			continue;
+		
+		configurePin(AddressPins[i]);
+		busAddressPins |= (1u << i);
 	}		
 	
-	if (readEnable > 0)
+	if ((readEnable > 0) && !busReadPin)
 	{
-		PIO_Configure(ReadPin.pPort,
-			ReadPin.ulPinType,
-			ReadPin.ulPin,
-			ReadPin.ulPinConfiguration);
+		configurePin(ReadPin);
+		busReadPin = true;
 	}
 	
-	if (writeEnable > 0)
+	if ((writeEnable > 0) && !busWritePin)
 	{
-		PIO_Configure(WritePin.pPort,
-			WritePin.ulPinType,
-			WritePin.ulPin,
-			WritePin.ulPinConfiguration);
+		configurePin(WritePin);
+		busWritePin = true;
 	}
 	
 	// chip select
@@ -183,10 +211,7 @@ void ParallelClass::begin(  ParallelBusWidth_t width,
 		// save the chip select address to reduce overhead of read/write calls
 		_addr = chipSelectAddresses[_cs];
 		
-		PIO_Configure(ChipSelectPins[_cs].pPort,
-			ChipSelectPins[_cs].ulPinType,
-			ChipSelectPins[_cs].ulPin,
-			ChipSelectPins[_cs].ulPinConfiguration);
+		configurePin(ChipSelectPins[_cs]);
 	}
 	else 
 	{
@@ -196,12 +221,35 @@ void ParallelClass::begin(  ParallelBusWidth_t width,
 	}
 	
 	// Enable module
-	pmc_enable_periph_clk(ID_SMC);
+	if (!busClockEnabled)
+	{
+		pmc_enable_periph_clk(ID_SMC);
+		busClockEnabled = true;
+	}
+	
+#if PARALLEL_ENABLE_STATS
+	ParallelStats.begin();
+#endif
 	
 	// set mode
-	smc_set_mode(SMC, _cs, SMC_MODE_READ_MODE
+	_mode = SMC_MODE_READ_MODE
 		| SMC_MODE_WRITE_MODE
-		| SMC_MODE_DBW_BIT_8);
+		| SMC_MODE_BAT_BYTE_SELECT;
+	applyMode();
+}
+
+// The data bus width is part of the mode register, so keep it in step with
+// the width passed to begin() whenever the mode changes.
+void ParallelClass::applyMode(void)
+{
+	_mode &= ~SMC_MODE_DBW;
+	
+	if (_width == PARALLEL_BUS_WIDTH_8)
+		_mode |= SMC_MODE_DBW_BIT_8;
+	else
+		_mode |= SMC_MODE_DBW_BIT_16;
+	
+	smc_set_mode(SMC, smcChipSelect(), _mode);
 }
 
 // Configure the address setup time.  See datasheet for calculations
@@ -210,7 +258,7 @@ void ParallelClass::setAddressSetupTiming(uint8_t cyclesBeforeNWE,
 											                    uint8_t cyclesBeforeNRD,
 											                    uint8_t cyclesBeforeNCSRead)
 {
-	smc_set_setup_timing(SMC,_cs,SMC_SETUP_NWE_SETUP(cyclesBeforeNWE)
+	smc_set_setup_timing(SMC, smcChipSelect(),SMC_SETUP_NWE_SETUP(cyclesBeforeNWE)
 		| SMC_SETUP_NCS_WR_SETUP(cyclesBeforeNCSWrite)
 		| SMC_SETUP_NRD_SETUP(cyclesBeforeNRD)
 		| SMC_SETUP_NCS_RD_SETUP(cyclesBeforeNCSRead));
@@ -222,7 +270,7 @@ void ParallelClass::setPulseTiming( uint8_t cyclesNWEWidth,
 									                  uint8_t cyclesNRDWidth,
 									                  uint8_t cyclesNCSWidthRead)
 {
-	smc_set_pulse_timing(SMC, _cs, SMC_PULSE_NWE_PULSE(cyclesNWEWidth)
+	smc_set_pulse_timing(SMC, smcChipSelect(), SMC_PULSE_NWE_PULSE(cyclesNWEWidth)
 		| SMC_PULSE_NCS_WR_PULSE(cyclesNCSWidthWrite)
 		| SMC_PULSE_NRD_PULSE(cyclesNRDWidth)
 		| SMC_PULSE_NCS_RD_PULSE(cyclesNCSWidthRead));
@@ -232,26 +280,550 @@ void ParallelClass::setPulseTiming( uint8_t cyclesNWEWidth,
 void ParallelClass::setCycleTiming( uint8_t cyclesWriteTotal,
 									                  uint8_t cyclesReadTotal)
 {
-	smc_set_cycle_timing(SMC, _cs, SMC_CYCLE_NWE_CYCLE(cyclesWriteTotal)
+	smc_set_cycle_timing(SMC, smcChipSelect(), SMC_CYCLE_NWE_CYCLE(cyclesWriteTotal)
 		| SMC_CYCLE_NRD_CYCLE(cyclesReadTotal));
 }
 
+// Load a full set of timings solved from the device's data sheet values
+bool ParallelClass::setTiming(const ParallelSmcTiming_t &timing)
+{
+	if (!timing.valid)
+		return false;
+	
+	smc_set_setup_timing(SMC, smcChipSelect(), timing.setup);
+	smc_set_pulse_timing(SMC, smcChipSelect(), timing.pulse);
+	smc_set_cycle_timing(SMC, smcChipSelect(), timing.cycle);
+	return true;
+}
+
+uint16_t ParallelClass::getReadCycles(void)
+{
+	uint32_t cycle = SMC->SMC_CS_NUMBER[smcChipSelect()].SMC_CYCLE;
+	return (uint16_t)parallelDecodeCycle((cycle >> 16) & 0x1FF);
+}
+
+uint16_t ParallelClass::getWriteCycles(void)
+{
+	uint32_t cycle = SMC->SMC_CS_NUMBER[smcChipSelect()].SMC_CYCLE;
+	return (uint16_t)parallelDecodeCycle(cycle & 0x1FF);
+}
+
+void ParallelClass::getProfile(ParallelBusProfile_t &profile)
+{
+	SmcCs_number &r = SMC->SMC_CS_NUMBER[smcChipSelect()];
+
+	profile.setup = r.SMC_SETUP;
+	profile.pulse = r.SMC_PULSE;
+	profile.cycle = r.SMC_CYCLE;
+	profile.mode = _mode;
+}
+
+bool ParallelClass::makeProfile(const ParallelSmcTiming_t &timing, ParallelBusProfile_t &profile)
+{
+	if (!timing.valid)
+		return false;
+
+	profile.setup = timing.setup;
+	profile.pulse = timing.pulse;
+	profile.cycle = timing.cycle;
+	profile.mode = _mode;
+	return true;
+}
+
 // Set how the which signals latch data in the read and write modes (NCS or NRD/NWE).
 void ParallelClass::setMode(ReadModeFlags_t readMode, WriteModeFlags_t writeMode)
 {
-	smc_set_mode(SMC, _cs, readMode
-		| writeMode
-		| SMC_MODE_DBW_BIT_8);	// we only support 8-bit bus
+	_mode &= ~(SMC_MODE_READ_MODE | SMC_MODE_WRITE_MODE);
+	_mode |= readMode | writeMode;
+	applyMode();
+}
+
+// Select byte select or byte write access for 16-bit devices
+void ParallelClass::setByteAccess(ByteAccessFlags_t byteAccess)
+{
+	_mode &= ~SMC_MODE_BAT;
+	_mode |= byteAccess;
+	applyMode();
+}
+
+void ParallelClass::setWaitMode(WaitModeFlags_t waitMode)
+{
+	if ((waitMode != WAIT_MODE_DISABLED) && !busWaitPin)
+	{
+		configurePin(WaitPin);
+		busWaitPin = true;
+	}
+	
+	_mode &= ~SMC_MODE_EXNW_MODE_Msk;
+	_mode |= waitMode;
+	
+	if (waitMode != WAIT_MODE_DISABLED)
+		_mode &= ~(SMC_MODE_PMEN | SMC_MODE_PS_Msk);
+	applyMode();
+}
+
+// NWAIT can't be used together with page mode
+void ParallelClass::setPageMode(PageSizeFlags_t pageSize, 
+                                uint8_t cyclesFirstAccess, 
+                                uint8_t cyclesPageAccess)
+{
+	uint32_t pulse = SMC->SMC_CS_NUMBER[smcChipSelect()].SMC_PULSE;
+	
+	pulse &= ~(SMC_PULSE_NRD_PULSE_Msk | SMC_PULSE_NCS_RD_PULSE_Msk);
+	pulse |= SMC_PULSE_NRD_PULSE(cyclesPageAccess)
+		| SMC_PULSE_NCS_RD_PULSE(cyclesFirstAccess);
+	smc_set_pulse_timing(SMC, smcChipSelect(), pulse);
+	
+	_mode &= ~(SMC_MODE_EXNW_MODE_Msk | SMC_MODE_PS_Msk);
+	_mode |= SMC_MODE_PMEN | pageSize;
+	applyMode();
+}
+
+void ParallelClass::disablePageMode(void)
+{
+	_mode &= ~(SMC_MODE_PMEN | SMC_MODE_PS_Msk);
+	applyMode();
+}
+
+uint16_t ParallelClass::getPageSize(void)
+{
+	if ((_mode & SMC_MODE_PMEN) == 0)
+		return 0;
+	
+	return 4 << ((_mode & SMC_MODE_PS_Msk) >> 28);
+}
+
+bool ParallelClass::isWaitAsserted(void)
+{
+	return (WaitPin.pPort->PIO_PDSR & WaitPin.ulPin) == 0;
+}
+
+bool ParallelClass::waitReleased(void)
+{
+	for (uint32_t i = 0; i < PARALLEL_WAIT_POLL_LIMIT; i++)
+	{
+		if (!isWaitAsserted())
+			return true;
+	}
+	
+	_waitTimeouts++;
+	if (_waitHandler)
+		_waitHandler();
+	return false;
+}
+
+// The port pointer is volatile, which is all that is needed to keep every
+// access, in order, at any optimization level.
+void ParallelClass::write(uint32_t offset, uint8_t data)
+{
+	PARALLEL_STATS_BEGIN(1);
+	*_port(offset) = data;
+	PARALLEL_STATS_END(smcChipSelect());
+}
+
+uint8_t ParallelClass::read(uint32_t offset)
+{
+	PARALLEL_STATS_BEGIN(1);
+	uint8_t data = *_port(offset);
+	PARALLEL_STATS_END(smcChipSelect());
+	return data;
+}
+
+// Word sized view of the caller's buffers, used to fetch/store four bytes of 
+// internal SRAM at a time in the block routines below.
+typedef uint32_t __attribute__((__may_alias__)) ParallelWord_t;
+
+// Writes n bytes from src to the same bus offset.  The source is read a word 
+// at a time once aligned and the loop is unrolled so the bus stays busy.
+void ParallelClass::writeBlock(uint32_t offset, const uint8_t *src, size_t n)
+{
+	if (!waitGuard())
+		return;
+	
+	PARALLEL_STATS_BEGIN(n);
+	
+	ParallelPort<uint8_t> port = _port(offset);
+	
+	while ((n > 0) && ((uintptr_t)src & 3))
+	{
+		*port = *src++;
+		n--;
+	}
+	
+	const ParallelWord_t *words = (const ParallelWord_t *)src;
+	while (n >= 8)
+	{
+		uint32_t w0 = words[0];
+		uint32_t w1 = words[1];
+		
+		*port = (uint8_t)(w0);
+		*port = (uint8_t)(w0 >> 8);
+		*port = (uint8_t)(w0 >> 16);
+		*port = (uint8_t)(w0 >> 24);
+		*port = (uint8_t)(w1);
+		*port = (uint8_t)(w1 >> 8);
+		*port = (uint8_t)(w1 >> 16);
+		*port = (uint8_t)(w1 >> 24);
+		
+		words += 2;
+		n -= 8;
+	}
+	
+	src = (const uint8_t *)words;
+	while (n--)
+	{
+		*port = *src++;
+	}
+	
+	PARALLEL_STATS_END(smcChipSelect());
+}
+
+// Writes the same value n times to one bus offset
+void ParallelClass::fill(uint32_t offset, uint8_t value, size_t n)
+{
+	if (!waitGuard())
+		return;
+	
+	PARALLEL_STATS_BEGIN(n);
+	
+	ParallelPort<uint8_t> port = _port(offset);
+	
+	while (n >= 8)
+	{
+		*port = value;
+		*port = value;
+		*port = value;
+		*port = value;
+		*port = value;
+		*port = value;
+		*port = value;
+		*port = value;
+		n -= 8;
+	}
+	
+	while (n--)
+	{
+		*port = value;
+	}
+	
+	PARALLEL_STATS_END(smcChipSelect());
+}
+
+// Reads n bytes from the same bus offset into dst.  Bytes are assembled into 
+// words so internal SRAM only sees one store per four bus reads.
+void ParallelClass::readBlock(uint32_t offset, uint8_t *dst, size_t n)
+{
+	if (!waitGuard())
+		return;
+	
+	PARALLEL_STATS_BEGIN(n);
+	
+	ParallelPort<uint8_t> port = _port(offset);
+	
+	while ((n > 0) && ((uintptr_t)dst & 3))
+	{
+		*dst++ = *port;
+		n--;
+	}
+	
+	ParallelWord_t *words = (ParallelWord_t *)dst;
+	while (n >= 8)
+	{
+		uint32_t w0, w1;
+		
+		w0  = (uint32_t)*port;
+		w0 |= (uint32_t)*port << 8;
+		w0 |= (uint32_t)*port << 16;
+		w0 |= (uint32_t)*port << 24;
+		w1  = (uint32_t)*port;
+		w1 |= (uint32_t)*port << 8;
+		w1 |= (uint32_t)*port << 16;
+		w1 |= (uint32_t)*port << 24;
+		
+		words[0] = w0;
+		words[1] = w1;
+		words += 2;
+		n -= 8;
+	}
+	
+	dst = (uint8_t *)words;
+	while (n--)
+	{
+		*dst++ = *port;
+	}
+	
+	PARALLEL_STATS_END(smcChipSelect());
+}
+
+void ParallelClass::write16(uint32_t offset, uint16_t data)
+{
+	PARALLEL_STATS_BEGIN(2);
+	
+	if (_width == PARALLEL_BUS_WIDTH_14)
+		data = pack14(data);
+	
+	*_port16(offset) = data;
+	
+	PARALLEL_STATS_END(smcChipSelect());
 }
 
-__attribute__((optimize("O0"))) void ParallelClass::write(uint32_t offset, uint8_t data)
+uint16_t ParallelClass::read16(uint32_t offset)
 {
-	*((volatile uint8_t *)(_addr + (offset&0x00FFFFFF))) = data;
+	PARALLEL_STATS_BEGIN(2);
+	
+	uint16_t data = *_port16(offset);
+	
+	if (_width == PARALLEL_BUS_WIDTH_14)
+		data = unpack14(data);
+	
+	PARALLEL_STATS_END(smcChipSelect());
+	return data;
+}
+
+void ParallelClass::writeBlock16(uint32_t offset, const uint16_t *src, size_t n)
+{
+	if (!waitGuard())
+		return;
+	
+	PARALLEL_STATS_BEGIN(n * 2);
+	
+	ParallelPort<uint16_t> port = _port16(offset);
+	
+	if (_width == PARALLEL_BUS_WIDTH_14)
+	{
+		while (n--)
+		{
+			*port = pack14(*src++);
+		}
+	}
+	else
+	{
+		while (n >= 4)
+		{
+			*port = src[0];
+			*port = src[1];
+			*port = src[2];
+			*port = src[3];
+			src += 4;
+			n -= 4;
+		}
+		
+		while (n--)
+		{
+			*port = *src++;
+		}
+	}
+	
+	PARALLEL_STATS_END(smcChipSelect());
 }
 
-__attribute__((optimize("O0"))) uint8_t ParallelClass::read(uint32_t offset)
+void ParallelClass::fill16(uint32_t offset, uint16_t value, size_t n)
 {
-	return *((volatile uint8_t *)(_addr + (offset&0x00FFFFFF)));
+	if (!waitGuard())
+		return;
+	
+	PARALLEL_STATS_BEGIN(n * 2);
+	
+	ParallelPort<uint16_t> port = _port16(offset);
+	
+	if (_width == PARALLEL_BUS_WIDTH_14)
+		value = pack14(value);
+	
+	while (n >= 8)
+	{
+		*port = value;
+		*port = value;
+		*port = value;
+		*port = value;
+		*port = value;
+		*port = value;
+		*port = value;
+		*port = value;
+		n -= 8;
+	}
+	
+	while (n--)
+	{
+		*port = value;
+	}
+	
+	PARALLEL_STATS_END(smcChipSelect());
+}
+
+void ParallelClass::readBlock16(uint32_t offset, uint16_t *dst, size_t n)
+{
+	if (!waitGuard())
+		return;
+	
+	PARALLEL_STATS_BEGIN(n * 2);
+	
+	ParallelPort<uint16_t> port = _port16(offset);
+	
+	if (_width == PARALLEL_BUS_WIDTH_14)
+	{
+		while (n--)
+		{
+			*dst++ = unpack14(*port);
+		}
+	}
+	else
+	{
+		while (n >= 4)
+		{
+			dst[0] = *port;
+			dst[1] = *port;
+			dst[2] = *port;
+			dst[3] = *port;
+			dst += 4;
+			n -= 4;
+		}
+		
+		while (n--)
+		{
+			*dst++ = *port;
+		}
+	}
+	
+	PARALLEL_STATS_END(smcChipSelect());
+}
+
+// Writes n bytes from src to incrementing bus offsets
+void ParallelClass::writeMemory(uint32_t offset, const void *src, size_t n)
+{
+	if (!waitGuard())
+		return;
+	
+	PARALLEL_STATS_BEGIN(n);
+	
+	const uint8_t *s = (const uint8_t *)src;
+	
+	if (_width == PARALLEL_BUS_WIDTH_8)
+	{
+		ParallelPort<uint8_t> port = _port(offset);
+		
+		while (n >= 4)
+		{
+			port[0] = s[0];
+			port[1] = s[1];
+			port[2] = s[2];
+			port[3] = s[3];
+			port = port + 4;
+			s += 4;
+			n -= 4;
+		}
+		
+		while (n--)
+		{
+			*port = *s++;
+			port = port + 1;
+		}
+	}
+	else
+	{
+		if ((offset & 1) && (n > 0))
+		{
+			*_port(offset++) = *s++;
+			n--;
+		}
+		
+		ParallelPort<uint16_t> port = _port16(offset);
+		size_t halfwords = n >> 1;
+		
+		for (size_t i = 0; i < halfwords; i++)
+		{
+			port[i] = (uint16_t)(s[0] | (s[1] << 8));
+			s += 2;
+		}
+		
+		if (n & 1)
+			*_port(offset + (halfwords << 1)) = *s;
+	}
+	
+	PARALLEL_STATS_END(smcChipSelect());
+}
+
+// Reads n bytes from incrementing bus offsets into dst
+// In page mode the reads are made a page at a time, each page starting on a
+// page boundary, so only the first read of every page pays the full access
+// time.
+void ParallelClass::readMemory(uint32_t offset, void *dst, size_t n)
+{
+	if (!waitGuard())
+		return;
+	
+	PARALLEL_STATS_BEGIN(n);
+	
+	uint8_t *d = (uint8_t *)dst;
+	uint32_t pageSize = getPageSize();
+	
+	if (pageSize == 0)
+	{
+		readSpan(offset, d, n);
+	}
+	else
+	{
+		while (n > 0)
+		{
+			size_t chunk = pageSize - (offset & (pageSize - 1));
+			
+			if (chunk > n)
+				chunk = n;
+			
+			readSpan(offset, d, chunk);
+			offset += chunk;
+			d += chunk;
+			n -= chunk;
+		}
+	}
+	
+	PARALLEL_STATS_END(smcChipSelect());
+}
+
+void ParallelClass::readSpan(uint32_t offset, uint8_t *d, size_t n)
+{
+	if (_width == PARALLEL_BUS_WIDTH_8)
+	{
+		ParallelPort<uint8_t> port = _port(offset);
+		
+		while (n >= 4)
+		{
+			d[0] = port[0];
+			d[1] = port[1];
+			d[2] = port[2];
+			d[3] = port[3];
+			port = port + 4;
+			d += 4;
+			n -= 4;
+		}
+		
+		while (n--)
+		{
+			*d++ = *port;
+			port = port + 1;
+		}
+	}
+	else
+	{
+		if ((offset & 1) && (n > 0))
+		{
+			*d++ = *_port(offset++);
+			n--;
+		}
+		
+		ParallelPort<uint16_t> port = _port16(offset);
+		size_t halfwords = n >> 1;
+		
+		for (size_t i = 0; i < halfwords; i++)
+		{
+			uint16_t v = port[i];
+			d[0] = (uint8_t)v;
+			d[1] = (uint8_t)(v >> 8);
+			d += 2;
+		}
+		
+		if (n & 1)
+			*d = *_port(offset + (halfwords << 1));
+	}
 }
 
 // Gets the address of the memory mapped peripheral.  Note, the begin() 
@@ -266,5 +838,25 @@ uint32_t ParallelClass::getAddress(void)
 }
   
 
-// Create our object
+// CRC a nibble at a time, so the table is only 32 bytes of flash
+uint16_t parallelCrc16(const uint8_t *data, size_t n, uint16_t crc)
+{
+	static const uint16_t table[16] = {
+		0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+		0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+	};
+
+	while (n--)
+	{
+		uint8_t b = *data++;
+
+		crc = (uint16_t)((crc << 4) ^ table[(crc >> 12) ^ (b >> 4)]);
+		crc = (uint16_t)((crc << 4) ^ table[(crc >> 12) ^ (b & 0x0F)]);
+	}
+
+	return crc;
+}
+
+// Create our default object.  Sketches with more than one device can create
+// their own ParallelClass objects, one per chip select.
 ParallelClass Parallel = ParallelClass();
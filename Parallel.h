@@ -36,8 +36,27 @@
 #ifndef PARALLEL_H
 #define PARALLEL_H
 
+#ifdef PARALLEL_HOST_SIM
+#include "ParallelSim.h"
+#else
 #include "Arduino.h"
+#endif
 #include "smc.h"
+#include "ParallelTiming.h"
+
+// Handle used to reach a location on the external bus.  On the board this is
+// a plain volatile pointer; the host simulator substitutes a proxy type.
+// Addresses handed to the DMA controller are stored as ParallelDmaAddr_t.
+#ifdef PARALLEL_HOST_SIM
+typedef uintptr_t ParallelDmaAddr_t;
+#define PARALLEL_DMA_KICK(channel)	ParallelSim.runDma(channel)
+#else
+template <typename T> using ParallelPort = volatile T *;
+typedef uint32_t ParallelDmaAddr_t;
+#define PARALLEL_DMA_KICK(channel)
+#endif
+
+#define PARALLEL_DMA_ADDR(p)	((ParallelDmaAddr_t)(uintptr_t)(p))
 
 typedef enum 
 {
@@ -48,10 +67,19 @@ typedef enum
 	PARALLEL_CS_NONE
 } ParallelChipSelect_t;
 
+// In the 16-bit modes the SMC drives A0 as the low byte select (NBS0), so 
+// the first address line a 16-bit device sees is A1 and offsets passed to the
+// 16-bit accessors are byte offsets (use even values).
+//
+// D8/D9 (PC10/PC11) are not connected on the DUE, so PARALLEL_BUS_WIDTH_14 
+// runs the SMC in 16-bit mode but packs 14-bit values around the missing 
+// lines: value bits 0-7 go out on D0-D7 and bits 8-13 on D10-D15.  Wire the 
+// device's D8-D13 to D10-D15 and the 16-bit accessors take care of the rest.
 typedef enum
 {
 	PARALLEL_BUS_WIDTH_8,
-	PARALLEL_BUS_WIDTH_16
+	PARALLEL_BUS_WIDTH_16,
+	PARALLEL_BUS_WIDTH_14
 } ParallelBusWidth_t;
 
 typedef enum 
@@ -66,13 +94,128 @@ typedef enum
 	WRITE_MODE_NWE_CTRL = SMC_MODE_WRITE_MODE_NWE_CTRL		// Default
 } WriteModeFlags_t;	
 
+// How the two byte lanes of a 16-bit device are qualified.  Byte select uses
+// NWE plus NBS0/NBS1; byte write uses NWR0/NWR1 as per lane write strobes.
+typedef enum
+{
+	BYTE_ACCESS_SELECT = SMC_MODE_BAT_BYTE_SELECT,		// Default
+	BYTE_ACCESS_WRITE = SMC_MODE_BAT_BYTE_WRITE
+} ByteAccessFlags_t;
+
+// How the SMC uses the NWAIT input (PA4, analog pin A5 on the DUE).  In 
+// frozen mode the access is paused for as long as NWAIT is low; in ready 
+// mode the strobe is held until NWAIT goes high.  Either way a slow device 
+// only stretches the accesses that need it, so the timings can be set for 
+// the fast case.  NWAIT is resynchronised, so the NRD/NWE pulse must be at 
+// least 3 cycles (and the device must assert NWAIT within pulse - 3 cycles 
+// of the strobe) for the SMC to see it.
+typedef enum
+{
+	WAIT_MODE_DISABLED = SMC_MODE_EXNW_MODE_DISABLED,		// Default
+	WAIT_MODE_FROZEN = SMC_MODE_EXNW_MODE_FROZEN,
+	WAIT_MODE_READY = SMC_MODE_EXNW_MODE_READY
+} WaitModeFlags_t;
+
+// Page mode, for memories that read a page into a buffer on the first
+// access (page mode NOR flash, PSRAM).  The first read in a page takes the
+// full access time, the following reads within that page only the (much 
+// shorter) page access time.  Page mode applies to reads only and can't be
+// combined with a wait mode.
+typedef enum
+{
+	PAGE_SIZE_4 = SMC_MODE_PS_4_BYTE,
+	PAGE_SIZE_8 = SMC_MODE_PS_8_BYTE,
+	PAGE_SIZE_16 = SMC_MODE_PS_16_BYTE,
+	PAGE_SIZE_32 = SMC_MODE_PS_32_BYTE
+} PageSizeFlags_t;
+
+// Pin reads made by waitReleased() before it reports NWAIT as stuck
+#ifndef PARALLEL_WAIT_POLL_LIMIT
+#define PARALLEL_WAIT_POLL_LIMIT	10000
+#endif
+
+// DMA channel used for asynchronous transfers.  The DMAC has six channels
+// (0-5); pick one that doesn't collide with other libraries in the sketch.
+#ifndef PARALLEL_DMA_CHANNEL
+#define PARALLEL_DMA_CHANNEL	5
+#endif
+
+// Largest block the DMAC moves per buffer transfer.  Longer transfers are 
+// split up and restarted from the DMA interrupt.
+#define PARALLEL_DMA_MAX_BLOCK	4095
+
+// Set to 1 to count bytes, accesses and bus time per chip select (see 
+// ParallelStats.h).  Adds a little overhead to every access when enabled.
+#ifndef PARALLEL_ENABLE_STATS
+#define PARALLEL_ENABLE_STATS	0
+#endif
+
+// Called from the DMA interrupt when an asynchronous transfer completes.
+typedef void (*ParallelCallback_t)(void);
+
+// SMC register images for one chip select: everything setTiming(), the
+// setters and setMode() and friends leave behind, captured by getProfile()
+// so it can be put back in one go with setProfile()
+typedef struct
+{
+	uint32_t setup;		// SMC_SETUP
+	uint32_t pulse;		// SMC_PULSE
+	uint32_t cycle;		// SMC_CYCLE
+	uint32_t mode;		// SMC_MODE
+} ParallelBusProfile_t;
+
+// CRC-16/CCITT (polynomial 0x1021), starting from crc
+uint16_t parallelCrc16(const uint8_t *data, size_t n, uint16_t crc = 0xFFFF);
+
+// Storage for the single byte writes of a ParallelSequence or
+// ParallelTransaction.  add() copies the byte in, then has the owner grow
+// its last run of writes with extendRun(offset, p), which only does so if
+// that run ends right at p and goes to the same offset, or start a new one
+// with add(offset, p, 1).
+template <size_t N>
+class ParallelByteStore {
+public:
+  ParallelByteStore() : _used(0) { }
+
+  void clear() { _used = 0; }
+
+  // Returns false if the store or the owner is full
+  template <class Owner>
+  bool add(Owner &owner, uint32_t offset, uint8_t value)
+  {
+    if (_used >= N)
+      return false;
+
+    uint8_t *p = &_bytes[_used];
+    *p = value;
+
+    if (!owner.extendRun(offset, p) && !owner.add(offset, p, (size_t)1))
+      return false;
+
+    _used++;
+    return true;
+  }
+
+private:
+  uint8_t _bytes[N];
+  size_t _used;
+};
+
 // See SAM3X data sheet in the Static Memory Controller section.  Each chip 
 // select above corresponds to these physical addresses 
 extern const uint32_t chipSelectAddresses[];
 
+class ParallelSequence;
+
+// One ParallelClass object drives the device on one chip select.  Each chip
+// select has its own timing and mode registers in the SMC, so several 
+// devices (e.g. an LCD on NCS1 and an SRAM on NCS0) can be used side by side,
+// from the main loop or interrupts, without reconfiguring anything between
+// accesses.  The global Parallel object is there for the common single 
+// device case.
 class ParallelClass {
 public:
-  ParallelClass() { };
+  ParallelClass() : _mode(0), _waitHandler(NULL), _waitTimeouts(0) { }
   void begin(	ParallelBusWidth_t width,
 				      ParallelChipSelect_t cs, 
 				      uint8_t numAddressLines, 
@@ -95,18 +238,187 @@ public:
   void setCycleTiming(	uint8_t cyclesWriteTotal,
 						            uint8_t cyclesReadTotal);
 									
+  // Load setup, pulse and cycle timings computed by parallelSolveTiming()
+  // (see ParallelTiming.h) in one go.  Returns false, changing nothing, if
+  // the timing is invalid.
+  bool setTiming(const ParallelSmcTiming_t &timing);
+  
+  // MCK cycles per read/write access with the timings currently loaded
+  uint16_t getReadCycles();
+  uint16_t getWriteCycles();
+  
+  // The chip select's timing and mode registers, and loading a set back.
+  // setProfile() is four register writes with interrupts masked, so it can
+  // switch profiles from an interrupt and no access sees half of each.  The
+  // profile should come from getProfile() on the same bus (the NWAIT pin is
+  // only set up by setWaitMode()).  Don't switch during a DMA transfer.
+  void getProfile(ParallelBusProfile_t &profile);
+  void setProfile(const ParallelBusProfile_t &profile)
+  {
+    SmcCs_number &r = SMC->SMC_CS_NUMBER[smcChipSelect()];
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    
+    r.SMC_SETUP = profile.setup;
+    r.SMC_PULSE = profile.pulse;
+    r.SMC_CYCLE = profile.cycle;
+    r.SMC_MODE = profile.mode;
+    _mode = profile.mode;
+    
+    __set_PRIMASK(primask);
+  }
+  
+  // A profile with timing's registers and the mode currently set, without
+  // loading it.  Returns false if timing is invalid.
+  bool makeProfile(const ParallelSmcTiming_t &timing, ParallelBusProfile_t &profile);
+  
   // Set how the which signals latch data in the read and write modes (NCS or NRD/NWE).
   void setMode(ReadModeFlags_t readMode, WriteModeFlags_t writeMode);
   
+  // Select byte select or byte write access for 16-bit devices.
+  void setByteAccess(ByteAccessFlags_t byteAccess);
+  
+  // Turns on page mode.  cyclesFirstAccess is the access time of the first
+  // read in a page (tpa) and cyclesPageAccess that of the others (tsa); they
+  // replace the NCS/NRD read pulse timings, and the read setup and cycle 
+  // times no longer apply.  Load the read timings again after turning page 
+  // mode off.  readMemory() walks the memory a page at a time.
+  void setPageMode(PageSizeFlags_t pageSize, uint8_t cyclesFirstAccess, 
+                   uint8_t cyclesPageAccess);
+  void disablePageMode();
+  
+  // Page size in bytes, 0 with page mode off
+  uint16_t getPageSize();
+  
+  // Let the device stretch accesses with NWAIT.  The first call configures
+  // the NWAIT pin, which is shared by every chip select.  Turns page mode
+  // off.
+  void setWaitMode(WaitModeFlags_t waitMode);
+  
+  // An access started while a device holds NWAIT low stalls until it lets
+  // go; the SMC has no timeout of its own.  With a wait mode set, the block,
+  // memory and asynchronous transfers first check the pin and are dropped 
+  // (counting a timeout and calling the handler) if it stays low for 
+  // PARALLEL_WAIT_POLL_LIMIT reads.  Single read()/write() calls aren't 
+  // checked; call waitReleased() first where that matters.
+  bool isWaitAsserted();
+  bool waitReleased();
+  void setWaitTimeoutHandler(ParallelCallback_t handler) { _waitHandler = handler; }
+  uint32_t waitTimeouts() { return _waitTimeouts; }
+  
   void write(uint32_t offset, uint8_t data) ;
   uint8_t read(uint32_t offset);  
 
+  // Block transfers to/from a single offset (e.g. the data register of an
+  // index addressed LCD controller).  Much cheaper than calling write()/read()
+  // in a loop since the address is only computed once per block.
+  void writeBlock(uint32_t offset, const uint8_t *src, size_t n);
+  void fill(uint32_t offset, uint8_t value, size_t n);
+  void readBlock(uint32_t offset, uint8_t *dst, size_t n);
+  
+  // 16-bit accessors for the 16 and 14 bit bus widths.  Each transfer is a 
+  // single halfword bus cycle.
+  void write16(uint32_t offset, uint16_t data);
+  uint16_t read16(uint32_t offset);
+  void writeBlock16(uint32_t offset, const uint16_t *src, size_t n);
+  void fill16(uint32_t offset, uint16_t value, size_t n);
+  void readBlock16(uint32_t offset, uint16_t *dst, size_t n);
+  
+  // Block transfers to/from consecutive offsets, for memory devices such as
+  // external SRAM.  8-bit buses move a byte per cycle; the 16-bit widths 
+  // move halfwords (no 14-bit packing) with byte cycles at odd ends.
+  void writeMemory(uint32_t offset, const void *src, size_t n);
+  void readMemory(uint32_t offset, void *dst, size_t n);
+  
+  // Map a 14-bit value onto the DUE's usable data lines and back
+  static uint16_t pack14(uint16_t value) 
+  { 
+    return (value & 0x00FF) | ((value & 0x3F00) << 2); 
+  }
+  static uint16_t unpack14(uint16_t bus) 
+  { 
+    return (bus & 0x00FF) | ((bus >> 2) & 0x3F00); 
+  }
+
+  // Asynchronous block write to a single offset using the DMA controller.
+  // The buffer must stay valid until the transfer completes.  If a transfer 
+  // is already running this waits for it to finish first.  Note that the 
+  // library provides the DMAC_Handler interrupt routine.
+  void writeAsync(uint32_t offset, const uint8_t *src, size_t n, 
+                  ParallelCallback_t callback = NULL);
+  
+  // Runs a prebuilt sequence of writes (see ParallelSequence.h) as a single
+  // DMA job.  The sequence must stay valid until the transfer completes.
+  void writeAsync(ParallelSequence &sequence, ParallelCallback_t callback = NULL);
+  
+  // Same as writeAsync() but returns false instead of waiting when the DMA 
+  // channel is already in use (e.g. by another device) or NWAIT is stuck.
+  // Safe to call from interrupts that must not block.
+  bool tryWriteAsync(uint32_t offset, const uint8_t *src, size_t n, 
+                     ParallelCallback_t callback = NULL);
+  
+  // Asynchronous block read into dst, from a single offset (e.g. a FIFO) or
+  // with incrementing set from consecutive offsets.  Shares the DMA channel
+  // with the writes; tryReadAsync() is the non-blocking version.
+  void readAsync(uint32_t offset, uint8_t *dst, size_t n, 
+                 ParallelCallback_t callback = NULL, bool incrementing = false);
+  bool tryReadAsync(uint32_t offset, uint8_t *dst, size_t n, 
+                    ParallelCallback_t callback = NULL, bool incrementing = false);
+  
+  // True while an asynchronous transfer is in progress.
+  bool isBusy();
+  
+  // Blocks until the current asynchronous transfer has completed.
+  void wait();
+
   // returns the address of the memory mapped peripheral
   uint32_t getAddress();	
+  
+  ParallelChipSelect_t getChipSelect() { return _cs; }
+  ParallelBusWidth_t getBusWidth() { return _width; }
 
 private:
+  uint32_t _busAddress(uint32_t offset) 
+  { 
+    return _addr + (offset&0x00FFFFFF); 
+  }
+  
+  ParallelPort<uint8_t> _port(uint32_t offset) 
+  { 
+    return ParallelPort<uint8_t>(_busAddress(offset)); 
+  }
+  
+  ParallelPort<uint16_t> _port16(uint32_t offset) 
+  { 
+    return ParallelPort<uint16_t>(_addr + (offset&0x00FFFFFE)); 
+  }
+  
+  // Writes the cached mode register image to the SMC
+  void applyMode();
+  
+  // readMemory() for a range that doesn't need splitting
+  void readSpan(uint32_t offset, uint8_t *dst, size_t n);
+  
+  // NWAIT check made before block transfers when a wait mode is set
+  bool waitGuard()
+  {
+    return ((_mode & SMC_MODE_EXNW_MODE_Msk) == SMC_MODE_EXNW_MODE_DISABLED) 
+      || waitReleased();
+  }
+  
+  // SMC register set to program.  Without a chip select the bus is mapped
+  // through the NCS0 window, so that's the one whose timings apply.
+  uint32_t smcChipSelect() 
+  { 
+    return (_cs < PARALLEL_CS_NONE) ? _cs : PARALLEL_CS_0; 
+  }
+
   ParallelChipSelect_t _cs;
   uint32_t _addr;
+  ParallelBusWidth_t _width;
+  uint32_t _mode;
+  ParallelCallback_t _waitHandler;
+  uint32_t _waitTimeouts;
 };
 
 extern ParallelClass Parallel;
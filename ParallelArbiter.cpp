@@ -0,0 +1,239 @@
+/*
+  ParallelArbiter.cpp
+
+  Transactions on a device shared between the main loop and interrupts.
+  See ParallelArbiter.h for usage.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ParallelArbiter.h"
+
+#if PARALLEL_TRANSACTION_MAX_WRITES > 255
+#error "PARALLEL_TRANSACTION_MAX_WRITES must be 255 or less"
+#endif
+
+// Sets *p to desired if it still holds expected.  An exception between the
+// LDREX and STREX clears the exclusive monitor, so the STREX fails and the
+// value is read again.  The simulator's handlers run synchronously.
+static bool compareAndSwap(volatile uintptr_t *p, uintptr_t expected, uintptr_t desired)
+{
+#ifdef PARALLEL_HOST_SIM
+	return __sync_bool_compare_and_swap(p, expected, desired);
+#else
+	do
+	{
+		if (__LDREXW((volatile uint32_t *)p) != expected)
+		{
+			__CLREX();
+			return false;
+		}
+	} while (__STREXW(desired, (volatile uint32_t *)p) != 0);
+
+	__DMB();
+	return true;
+#endif
+}
+
+static uintptr_t exchange(volatile uintptr_t *p, uintptr_t value)
+{
+	uintptr_t old;
+
+	do
+	{
+		old = *p;
+	} while (!compareAndSwap(p, old, value));
+
+	return old;
+}
+
+ParallelTransaction::ParallelTransaction()
+	: _pending(0), _next(NULL)
+{
+	clear();
+}
+
+void ParallelTransaction::clear(void)
+{
+	_count = 0;
+	_bytes.clear();
+}
+
+bool ParallelTransaction::add(uint32_t offset, uint8_t value)
+{
+	return _bytes.add(*this, offset, value);
+}
+
+// Grows the last write if it ends where the byte at p was stored and goes
+// to the same register
+bool ParallelTransaction::extendRun(uint32_t offset, const uint8_t *p)
+{
+	if (_count == 0)
+		return false;
+
+	Write_t &last = _writes[_count - 1];
+
+	if ((last.offset != offset) || (last.src + last.n != p))
+		return false;
+
+	last.n++;
+	return true;
+}
+
+bool ParallelTransaction::add(uint32_t offset, const uint8_t *src, size_t n)
+{
+	if (_count >= PARALLEL_TRANSACTION_MAX_WRITES)
+		return false;
+
+	Write_t &w = _writes[_count++];
+
+	w.offset = offset;
+	w.src = src;
+	w.n = n;
+	return true;
+}
+
+void ParallelTransaction::run(ParallelClass &bus)
+{
+	for (uint8_t i = 0; i < _count; i++)
+	{
+		const Write_t &w = _writes[i];
+
+		if (w.n == 1)
+			bus.write(w.offset, *w.src);
+		else
+			bus.writeBlock(w.offset, w.src, w.n);
+	}
+}
+
+ParallelArbiter::ParallelArbiter(ParallelClass &bus)
+	: _bus(bus), _owner(0), _deferred(0)
+{
+	for (uint8_t i = 0; i < PARALLEL_PRIORITY_COUNT; i++)
+	{
+		_submitted[i] = 0;
+		_ready[i] = NULL;
+	}
+}
+
+bool ParallelArbiter::begin(void)
+{
+	return compareAndSwap(&_owner, 0, 1);
+}
+
+void ParallelArbiter::end(void)
+{
+	// the bus work has to be finished before anyone else can start
+	__DMB();
+	_owner = 0;
+	drain();
+}
+
+bool ParallelArbiter::submit(ParallelTransaction &transaction, ParallelPriority_t priority)
+{
+	if (priority >= PARALLEL_PRIORITY_COUNT)
+		priority = PARALLEL_PRIORITY_HIGH;
+
+	if (!compareAndSwap(&transaction._pending, 0, 1))
+		return false;
+
+	// push onto the submitted list; only ever pushed onto or emptied whole,
+	// so a head that still matches means nothing changed underneath
+	uintptr_t head;
+	do
+	{
+		head = _submitted[priority];
+		transaction._next = (ParallelTransaction *)head;
+	} while (!compareAndSwap(&_submitted[priority], head, (uintptr_t)&transaction));
+
+	drain();
+
+	if (transaction._pending)
+	{
+		uintptr_t count;
+		do
+		{
+			count = _deferred;
+		} while (!compareAndSwap(&_deferred, count, count + 1));
+	}
+
+	return true;
+}
+
+// Runs what has been submitted if the bus is free.  Called after every
+// release: whoever held the bus when a transaction was pushed either sees
+// it here or has yet to release.
+void ParallelArbiter::drain(void)
+{
+	for (;;)
+	{
+		bool waiting = false;
+
+		for (uint8_t i = 0; i < PARALLEL_PRIORITY_COUNT; i++)
+		{
+			if (_submitted[i] != 0)
+				waiting = true;
+		}
+
+		if (!waiting || !begin())
+			return;
+
+		ParallelTransaction *transaction;
+
+		while ((transaction = next()) != NULL)
+		{
+			transaction->run(_bus);
+			__DMB();
+			transaction->_pending = 0;
+		}
+
+		__DMB();
+		_owner = 0;
+	}
+}
+
+// The next transaction to run, highest priority first.  Only called with
+// the bus held, so _ready needs no protection.
+ParallelTransaction *ParallelArbiter::next(void)
+{
+	for (int8_t i = PARALLEL_PRIORITY_COUNT - 1; i >= 0; i--)
+	{
+		if ((_ready[i] == NULL) && (_submitted[i] != 0))
+		{
+			// take the whole list and reverse it into submission order
+			ParallelTransaction *t = (ParallelTransaction *)exchange(&_submitted[i], 0);
+			ParallelTransaction *ordered = NULL;
+
+			while (t != NULL)
+			{
+				ParallelTransaction *following = t->_next;
+				t->_next = ordered;
+				ordered = t;
+				t = following;
+			}
+
+			_ready[i] = ordered;
+		}
+
+		if (_ready[i] != NULL)
+		{
+			ParallelTransaction *t = _ready[i];
+			_ready[i] = t->_next;
+			return t;
+		}
+	}
+
+	return NULL;
+}
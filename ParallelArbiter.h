@@ -0,0 +1,174 @@
+/*
+  ParallelArbiter.h
+
+  Shares one device on the parallel bus between the main loop and
+  interrupts.  Index addressed controllers take a command on one register
+  and its parameters on another, so an interrupt that writes to the device
+  in the middle of the main loop's command + data sequence leaves the
+  controller in the wrong state.  The arbiter makes each such sequence a
+  transaction that runs as a whole, without masking interrupts for the
+  length of the transfer.
+
+  The main loop wraps its sequences in begin()/end():
+
+    ParallelArbiter lcd(Parallel);
+
+    if (lcd.begin())
+    {
+      Parallel.write(0x01, 0x42);		// MWRITE
+      Parallel.writeBlock(0x00, pixels, n);
+      lcd.end();
+    }
+
+  and interrupts build a ParallelTransaction and submit() it:
+
+    ParallelTransaction status;		// static or global, not on the stack
+
+    void TC3_Handler()
+    {
+      ...
+      if (!status.isPending())
+      {
+        status.clear();
+        status.add(0x01, 0x46);		// CSRW
+        status.add(0x00, 0x00);
+        status.add(0x00, 0x00);
+        status.add(0x01, 0x42);		// MWRITE
+        status.add(0x00, text, 8);
+        lcd.submit(status, PARALLEL_PRIORITY_HIGH);
+      }
+    }
+
+  submit() never waits.  If the bus is free the transaction runs there and
+  then; if the main loop or a lower priority interrupt is part way through
+  a transaction, it is queued and the holder runs it as soon as it calls
+  end().  Queued transactions run high priority first, in the order they
+  were submitted within a priority.  Nothing is dropped.
+
+  The ownership flag and the queues are only updated with LDREX/STREX, so
+  there is no critical section at all; an interrupt that lands between the
+  two instructions just makes the update go round again.  The one cost is
+  that a queued transaction runs in whichever context releases the bus
+  next, possibly the main loop.
+
+  To hold the bus across a writeAsync(), call begin() before starting it
+  and end() from the completion callback.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PARALLEL_ARBITER_H
+#define PARALLEL_ARBITER_H
+
+#include "Parallel.h"
+
+// Writes in one transaction, and storage for its single byte writes
+#ifndef PARALLEL_TRANSACTION_MAX_WRITES
+#define PARALLEL_TRANSACTION_MAX_WRITES	8
+#endif
+
+#ifndef PARALLEL_TRANSACTION_MAX_BYTES
+#define PARALLEL_TRANSACTION_MAX_BYTES	16
+#endif
+
+// Order queued transactions run in
+typedef enum
+{
+	PARALLEL_PRIORITY_NORMAL,
+	PARALLEL_PRIORITY_HIGH,
+	PARALLEL_PRIORITY_COUNT
+} ParallelPriority_t;
+
+class ParallelArbiter;
+
+// A sequence of writes to run as a whole.  Single bytes are copied into the
+// transaction; buffers are referenced and must stay valid until it has run.
+// Subclass and override run() for anything else, reads included.
+class ParallelTransaction {
+public:
+  ParallelTransaction();
+  virtual ~ParallelTransaction() {}
+
+  // Empties the transaction.  Not while it is pending.
+  void clear();
+
+  // Appends a write.  Consecutive single bytes to the same offset are
+  // merged.  Returns false if the transaction is full.
+  bool add(uint32_t offset, uint8_t value);
+  bool add(uint32_t offset, const uint8_t *src, size_t n);
+
+  // True from submit() until the transaction has run
+  bool isPending() { return _pending; }
+
+  // Does the bus work, with the arbiter held
+  virtual void run(ParallelClass &bus);
+
+private:
+  friend class ParallelArbiter;
+  template <size_t> friend class ParallelByteStore;
+
+  bool extendRun(uint32_t offset, const uint8_t *p);
+
+  typedef struct
+  {
+    uint32_t offset;
+    const uint8_t *src;
+    size_t n;
+  } Write_t;
+
+  Write_t _writes[PARALLEL_TRANSACTION_MAX_WRITES];
+  ParallelByteStore<PARALLEL_TRANSACTION_MAX_BYTES> _bytes;
+  uint8_t _count;
+
+  volatile uintptr_t _pending;
+  ParallelTransaction *_next;
+};
+
+class ParallelArbiter {
+public:
+  ParallelArbiter(ParallelClass &bus);
+
+  // Takes the bus for a sequence of calls on it.  Returns false if it is
+  // held already, which the main loop only sees if it nests begin() calls.
+  bool begin();
+
+  // Gives the bus back, then runs any transactions queued meanwhile
+  void end();
+
+  // Runs the transaction now if the bus is free, or queues it.  Returns
+  // false, doing nothing, if it is still pending from an earlier submit().
+  bool submit(ParallelTransaction &transaction,
+              ParallelPriority_t priority = PARALLEL_PRIORITY_NORMAL);
+
+  bool isBusy() { return _owner != 0; }
+
+  // Transactions that were queued rather than run straight away
+  uint32_t deferred() { return (uint32_t)_deferred; }
+
+private:
+  void drain();
+  ParallelTransaction *next();
+
+  ParallelClass &_bus;
+  volatile uintptr_t _owner;
+  volatile uintptr_t _deferred;
+
+  // submitted transactions, newest first, and the holder's list of those
+  // taken off it, oldest first
+  volatile uintptr_t _submitted[PARALLEL_PRIORITY_COUNT];
+  ParallelTransaction *_ready[PARALLEL_PRIORITY_COUNT];
+};
+
+#endif
@@ -0,0 +1,237 @@
+/*
+  ParallelBridge.cpp
+
+  Framed streaming from the parallel bus to a PC.  See ParallelBridge.h
+  for usage and the frame format.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ParallelBridge.h"
+
+#if PARALLEL_BRIDGE_BUFFERS < 2
+#error "PARALLEL_BRIDGE_BUFFERS must be at least 2"
+#endif
+
+static void put16(uint8_t *p, uint16_t value)
+{
+	p[0] = (uint8_t)value;
+	p[1] = (uint8_t)(value >> 8);
+}
+
+static void put32(uint8_t *p, uint32_t value)
+{
+	put16(p, (uint16_t)value);
+	put16(p + 2, (uint16_t)(value >> 16));
+}
+
+ParallelBridge::Buffer_t *volatile ParallelBridge::_filling = NULL;
+
+ParallelBridge::ParallelBridge(ParallelClass &bus, ParallelTransport &out)
+	: _bus(bus), _out(out), _offset(0), _remaining(0), _endless(false),
+	  _incrementing(true), _payload(PARALLEL_BRIDGE_PAYLOAD), _fill(0), _send(0),
+	  _sequence(0), _frames(0), _bytes(0), _stalls(0)
+{
+	for (uint8_t i = 0; i < PARALLEL_BRIDGE_BUFFERS; i++)
+		_buffers[i].state = BUFFER_FREE;
+}
+
+bool ParallelBridge::begin(uint32_t offset, uint32_t length, bool incrementing,
+                           uint16_t payload)
+{
+	if ((payload == 0) || (payload > PARALLEL_BRIDGE_PAYLOAD))
+		return false;
+
+	for (uint8_t i = 0; i < PARALLEL_BRIDGE_BUFFERS; i++)
+	{
+		if (_buffers[i].state != BUFFER_FREE)
+			return false;
+	}
+
+	_offset = offset;
+	_remaining = length;
+	_endless = (length == 0);
+	_incrementing = incrementing;
+	_payload = payload;
+	_fill = 0;
+	_send = 0;
+	_sequence = 0;
+	_frames = 0;
+	_bytes = 0;
+	_stalls = 0;
+	return true;
+}
+
+// DMA interrupt: the payload is in
+void ParallelBridge::fillDone()
+{
+	Buffer_t *buffer = _filling;
+
+	__DMB();
+	buffer->state = BUFFER_FILLED;
+	_filling = NULL;
+}
+
+// Starts a bus read into the next buffer if it's free and the DMA channel
+// isn't in use
+void ParallelBridge::fill()
+{
+	Buffer_t &buffer = _buffers[_fill];
+
+	if ((buffer.state != BUFFER_FREE) || (_filling != NULL)
+		|| (!_endless && (_remaining == 0)))
+		return;
+
+	uint16_t n = _payload;
+	if (!_endless && (_remaining < n))
+		n = (uint16_t)_remaining;
+
+	put16(&buffer.data[2], n);
+	put32(&buffer.data[8], _offset);
+	buffer.length = PARALLEL_BRIDGE_HEADER + n + PARALLEL_BRIDGE_TRAILER;
+	buffer.sent = 0;
+
+	// the DMA interrupt can run before tryReadAsync() returns
+	buffer.state = BUFFER_FILLING;
+	_filling = &buffer;
+
+	if (!_bus.tryReadAsync(_offset, &buffer.data[PARALLEL_BRIDGE_HEADER], n,
+		fillDone, _incrementing))
+	{
+		_filling = NULL;
+		buffer.state = BUFFER_FREE;
+		return;
+	}
+
+	if (_incrementing)
+		_offset += n;
+	if (!_endless)
+		_remaining -= n;
+	_fill = (uint8_t)((_fill + 1) % PARALLEL_BRIDGE_BUFFERS);
+}
+
+// Header and CRC around a payload that has been read
+void ParallelBridge::frame(Buffer_t &buffer)
+{
+	uint16_t n = buffer.length - PARALLEL_BRIDGE_HEADER - PARALLEL_BRIDGE_TRAILER;
+
+	buffer.data[0] = PARALLEL_BRIDGE_SYNC0;
+	buffer.data[1] = PARALLEL_BRIDGE_SYNC1;
+	put32(&buffer.data[4], _sequence++);
+	put16(&buffer.data[PARALLEL_BRIDGE_HEADER + n],
+		parallelCrc16(&buffer.data[2], PARALLEL_BRIDGE_HEADER - 2 + n));
+}
+
+bool ParallelBridge::poll()
+{
+	Buffer_t &buffer = _buffers[_send];
+
+	if (buffer.state == BUFFER_FILLED)
+	{
+		__DMB();
+		frame(buffer);
+		buffer.state = BUFFER_SENDING;
+	}
+
+	// read the next payload while this one goes out
+	fill();
+
+	if (buffer.state == BUFFER_SENDING)
+	{
+		size_t n = buffer.length - buffer.sent;
+		size_t room = _out.room();
+
+		if (room == 0)
+		{
+			_stalls++;
+		}
+		else
+		{
+			if (n > room)
+				n = room;
+
+			buffer.sent += (uint16_t)_out.send(&buffer.data[buffer.sent], n);
+
+			if (buffer.sent == buffer.length)
+			{
+				_frames++;
+				_bytes += buffer.length - PARALLEL_BRIDGE_HEADER - PARALLEL_BRIDGE_TRAILER;
+				buffer.state = BUFFER_FREE;
+				_send = (uint8_t)((_send + 1) % PARALLEL_BRIDGE_BUFFERS);
+			}
+		}
+	}
+
+	if (_endless || (_remaining > 0))
+		return true;
+
+	for (uint8_t i = 0; i < PARALLEL_BRIDGE_BUFFERS; i++)
+	{
+		if (_buffers[i].state != BUFFER_FREE)
+			return true;
+	}
+
+	return false;
+}
+
+#ifdef PARALLEL_HOST_SIM
+
+ParallelSimLoopback::ParallelSimLoopback(uint32_t bytesPerSecond, size_t fifo) :
+	cyclesPerByte(1), _rate(bytesPerSecond), _fifo(fifo), _level(0), 
+	_last(ParallelSim.cycles())
+{
+}
+
+// The far end takes bytes out of the FIFO at the link rate
+void ParallelSimLoopback::drain()
+{
+	uint64_t now = ParallelSim.cycles();
+	uint64_t n = (now - _last) * _rate / VARIANT_MCK;
+
+	if (n >= _level)
+	{
+		_level = 0;
+		_last = now;
+	}
+	else
+	{
+		_level -= (size_t)n;
+		_last += n * VARIANT_MCK / _rate;
+	}
+}
+
+size_t ParallelSimLoopback::room()
+{
+	drain();
+	return _fifo - _level;
+}
+
+size_t ParallelSimLoopback::send(const uint8_t *data, size_t n)
+{
+	size_t free = room();
+
+	if (n > free)
+		n = free;
+
+	if (_level == 0)
+		_last = ParallelSim.cycles();
+
+	received.insert(received.end(), data, data + n);
+	_level += n;
+	ParallelSim.advance((uint64_t)n * cyclesPerByte);
+	return n;
+}
+
+#endif
@@ -0,0 +1,182 @@
+/*
+  ParallelBridge.h
+
+  Streams data from the parallel bus to a PC over USB or a serial port.
+  Blocks are read from the SMC window by DMA straight into frame buffers,
+  and the transport sends them from there, so each byte is copied once on
+  its way through the SAM3X.  While one frame is going out the next is
+  being read from the bus.
+
+    ParallelPrintTransport usb(SerialUSB);
+    ParallelBridge bridge(Parallel, usb);
+
+    bridge.begin(0, 65536);			// offset, bytes
+    while (bridge.poll())
+      ;
+
+  poll() never waits: it sends what the transport has room for and starts
+  the next read when a buffer is free.  When the PC falls behind, the
+  buffers stay full and the bus reads stop until there is room again, so
+  nothing is dropped.  A length of 0 streams from a FIFO until stop().
+
+  Each frame on the wire is:
+
+    A5 5A             sync
+    length (2)        payload bytes
+    sequence (4)      frame count from begin()
+    offset (4)        bus offset of the first payload byte
+    payload
+    CRC (2)           parallelCrc16() of everything from length to payload
+
+  all little endian.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PARALLEL_BRIDGE_H
+#define PARALLEL_BRIDGE_H
+
+#include "Parallel.h"
+
+// Largest payload per frame, and frame buffers (at least 2 to overlap the
+// bus reads with sending)
+#ifndef PARALLEL_BRIDGE_PAYLOAD
+#define PARALLEL_BRIDGE_PAYLOAD		512
+#endif
+
+#ifndef PARALLEL_BRIDGE_BUFFERS
+#define PARALLEL_BRIDGE_BUFFERS		3
+#endif
+
+#define PARALLEL_BRIDGE_SYNC0		0xA5
+#define PARALLEL_BRIDGE_SYNC1		0x5A
+#define PARALLEL_BRIDGE_HEADER		12
+#define PARALLEL_BRIDGE_TRAILER		2
+
+// Where the frames go.  Neither call may wait.
+class ParallelTransport {
+public:
+  virtual ~ParallelTransport() {}
+
+  // Bytes send() would take now
+  virtual size_t room() = 0;
+
+  // Takes up to n bytes and returns how many it took
+  virtual size_t send(const uint8_t *data, size_t n) = 0;
+};
+
+// Any Print (Serial, SerialUSB), up to chunk bytes at a time.  Print has no
+// way to ask for room, so write() may wait for the port; keep chunk to a
+// USB packet or the serial buffer size so the wait stays short.
+class ParallelPrintTransport : public ParallelTransport {
+public:
+  ParallelPrintTransport(Print &out, size_t chunk = 64) : _out(out), _chunk(chunk) {}
+  virtual size_t room() { return _chunk; }
+  virtual size_t send(const uint8_t *data, size_t n) { return _out.write(data, n); }
+
+private:
+  Print &_out;
+  size_t _chunk;
+};
+
+class ParallelBridge {
+public:
+  ParallelBridge(ParallelClass &bus, ParallelTransport &out);
+
+  // Streams length bytes from offset on, or with incrementing false, all
+  // from offset.  A length of 0 carries on until stop().  Returns false if
+  // a stream is still going or payload is out of range.
+  bool begin(uint32_t offset, uint32_t length, bool incrementing = true,
+             uint16_t payload = PARALLEL_BRIDGE_PAYLOAD);
+
+  // Moves the stream along.  Returns true while there is more to do.
+  bool poll();
+
+  // No more bus reads; frames already read are still sent by poll()
+  void stop() { _remaining = 0; _endless = false; }
+
+  // Frames and payload bytes sent, and polls that had a frame ready but
+  // found no room in the transport
+  uint32_t frames() { return _frames; }
+  uint32_t bytes() { return _bytes; }
+  uint32_t stalls() { return _stalls; }
+
+private:
+  typedef enum
+  {
+    BUFFER_FREE,
+    BUFFER_FILLING,		// DMA read in progress
+    BUFFER_FILLED,
+    BUFFER_SENDING
+  } BufferState_t;
+
+  typedef struct
+  {
+    volatile uint8_t state;
+    uint16_t length;		// frame bytes, header and CRC included
+    uint16_t sent;
+    uint8_t data[PARALLEL_BRIDGE_HEADER + PARALLEL_BRIDGE_PAYLOAD
+                 + PARALLEL_BRIDGE_TRAILER];
+  } Buffer_t;
+
+  static void fillDone();
+  void fill();
+  void frame(Buffer_t &buffer);
+
+  static Buffer_t *volatile _filling;
+
+  ParallelClass &_bus;
+  ParallelTransport &_out;
+  uint32_t _offset;
+  uint32_t _remaining;
+  bool _endless;
+  bool _incrementing;
+  uint16_t _payload;
+  uint8_t _fill;		// next buffer to read into
+  uint8_t _send;		// next buffer to send
+  uint32_t _sequence;
+  uint32_t _frames;
+  uint32_t _bytes;
+  uint32_t _stalls;
+  Buffer_t _buffers[PARALLEL_BRIDGE_BUFFERS];
+};
+
+#ifdef PARALLEL_HOST_SIM
+
+// Host stand-in for the link to the PC: a transmit FIFO of fifo bytes that
+// the far end empties at bytesPerSecond of model time.  Everything sent is
+// kept in received for checking.  Copying into the FIFO costs
+// cyclesPerByte of CPU time.
+class ParallelSimLoopback : public ParallelTransport {
+public:
+  ParallelSimLoopback(uint32_t bytesPerSecond, size_t fifo = 512);
+  virtual size_t room();
+  virtual size_t send(const uint8_t *data, size_t n);
+
+  std::vector<uint8_t> received;
+  uint32_t cyclesPerByte;
+
+private:
+  void drain();
+
+  uint32_t _rate;
+  size_t _fifo;
+  size_t _level;
+  uint64_t _last;
+};
+
+#endif
+
+#endif
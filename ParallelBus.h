@@ -0,0 +1,125 @@
+/*
+  ParallelBus.h
+
+  Compile time specialized bus accessors.  ParallelClass keeps the chip 
+  select address in a member and is called out of line, which costs a call
+  and a load on every access.  ParallelBus bakes the chip select, data width
+  and number of address lines into the type instead, so every access inlines
+  to a single STRB/STRH (or LDRB/LDRH) to a constant address:
+
+    typedef ParallelBus<PARALLEL_CS_1, PARALLEL_BUS_WIDTH_8, 1> Lcd;
+
+    Parallel.begin(PARALLEL_BUS_WIDTH_8, PARALLEL_CS_1, 1, 0, 1);  // pins, mode
+    Lcd::write(0x01, 0x40);     // a single strb to 0x61000001
+
+  The pointers are volatile, so the compiler keeps every access and keeps 
+  them in program order without any need to turn optimization off.  Use
+  ParallelClass::begin() and the timing functions to configure the bus.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PARALLEL_BUS_H
+#define PARALLEL_BUS_H
+
+#include "Parallel.h"
+
+#define PARALLEL_INLINE	inline __attribute__((always_inline))
+
+// Data type moved per bus cycle for each bus width
+template <ParallelBusWidth_t Width> struct ParallelBusTraits;
+
+template <> struct ParallelBusTraits<PARALLEL_BUS_WIDTH_8>
+{
+	typedef uint8_t data_t;
+	static PARALLEL_INLINE uint8_t toBus(uint8_t v) { return v; }
+	static PARALLEL_INLINE uint8_t fromBus(uint8_t v) { return v; }
+};
+
+template <> struct ParallelBusTraits<PARALLEL_BUS_WIDTH_16>
+{
+	typedef uint16_t data_t;
+	static PARALLEL_INLINE uint16_t toBus(uint16_t v) { return v; }
+	static PARALLEL_INLINE uint16_t fromBus(uint16_t v) { return v; }
+};
+
+template <> struct ParallelBusTraits<PARALLEL_BUS_WIDTH_14>
+{
+	typedef uint16_t data_t;
+	static PARALLEL_INLINE uint16_t toBus(uint16_t v) { return ParallelClass::pack14(v); }
+	static PARALLEL_INLINE uint16_t fromBus(uint16_t v) { return ParallelClass::unpack14(v); }
+};
+
+template <ParallelChipSelect_t CS, 
+          ParallelBusWidth_t Width = PARALLEL_BUS_WIDTH_8, 
+          uint8_t AddressLines = 24>
+class ParallelBus {
+public:
+  typedef ParallelBusTraits<Width> traits;
+  typedef typename traits::data_t data_t;
+  
+  // Window for the chip select (NCS0's when there is no chip select)
+  static constexpr uint32_t base = 0x60000000u 
+    + ((uint32_t)((CS < PARALLEL_CS_NONE) ? CS : PARALLEL_CS_0) << 24);
+  
+  // Only offset bits that reach an address pin matter.  In the 16-bit modes
+  // A0 is the byte select, so halfword accesses clear it.  ParallelClass
+  // keeps all 24 bits instead, so an offset past AddressLines wraps here
+  // but not there.
+  static constexpr uint32_t mask = ((AddressLines >= 24) ? 0x00FFFFFFu 
+    : ((1u << AddressLines) - 1)) & ((sizeof(data_t) == 2) ? ~1u : ~0u);
+  
+  static PARALLEL_INLINE ParallelPort<data_t> port(uint32_t offset)
+  {
+    return ParallelPort<data_t>(base + (offset & mask));
+  }
+  
+  static PARALLEL_INLINE void write(uint32_t offset, data_t data)
+  {
+    *port(offset) = traits::toBus(data);
+  }
+  
+  static PARALLEL_INLINE data_t read(uint32_t offset)
+  {
+    return traits::fromBus(*port(offset));
+  }
+  
+  static PARALLEL_INLINE void writeBlock(uint32_t offset, const data_t *src, size_t n)
+  {
+    ParallelPort<data_t> p = port(offset);
+    
+    while (n--)
+      *p = traits::toBus(*src++);
+  }
+  
+  static PARALLEL_INLINE void fill(uint32_t offset, data_t value, size_t n)
+  {
+    ParallelPort<data_t> p = port(offset);
+    data_t v = traits::toBus(value);
+    
+    while (n--)
+      *p = v;
+  }
+  
+  static PARALLEL_INLINE void readBlock(uint32_t offset, data_t *dst, size_t n)
+  {
+    ParallelPort<data_t> p = port(offset);
+    
+    while (n--)
+      *dst++ = traits::fromBus(*p);
+  }
+};
+
+#endif
@@ -0,0 +1,242 @@
+/*
+  ParallelCache.cpp
+
+  Read-through cache for slow external reads.  See ParallelCache.h for
+  usage.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ParallelCache.h"
+
+#define LINE_MASK	(PARALLEL_CACHE_LINE_SIZE - 1)
+#define INDEX_MASK	(PARALLEL_CACHE_LINES - 1)
+#define NO_TAG		0xFFFFFFFFu
+
+#if (PARALLEL_CACHE_LINE_SIZE & LINE_MASK) != 0
+#error "PARALLEL_CACHE_LINE_SIZE must be a power of two"
+#endif
+
+#if (PARALLEL_CACHE_LINES & INDEX_MASK) != 0
+#error "PARALLEL_CACHE_LINES must be a power of two"
+#endif
+
+static inline uint32_t lineIndex(uint32_t tag)
+{
+	return (tag / PARALLEL_CACHE_LINE_SIZE) & INDEX_MASK;
+}
+
+ParallelCache::ParallelCache(ParallelClass &bus)
+	: _bus(bus), _uncacheable(NULL)
+{
+	invalidate();
+	resetStats();
+}
+
+void ParallelCache::setUncacheable(ParallelUncacheable_t uncacheable)
+{
+	_uncacheable = uncacheable;
+	invalidate();
+}
+
+// A line is only filled if none of its bytes are marked uncacheable, so
+// prefetching never touches a register with read side effects.  The hook
+// is asked about every byte of the line, so the verdict is kept as the
+// slot's negative tag and later misses on the line skip the scan.
+bool ParallelCache::isUncacheable(uint32_t line, uint32_t tag)
+{
+	if (_uncacheable == NULL)
+		return false;
+
+	if (_uncacheableTags[line] == tag)
+		return true;
+
+	for (uint32_t i = 0; i < PARALLEL_CACHE_LINE_SIZE; i++)
+	{
+		if (_uncacheable(tag + i))
+		{
+			_uncacheableTags[line] = tag;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ParallelCache::fill(uint32_t line, uint32_t tag)
+{
+	if (isUncacheable(line, tag))
+		return false;
+
+	_bus.readMemory(tag, _data[line], PARALLEL_CACHE_LINE_SIZE);
+	_tags[line] = tag;
+	_misses++;
+	return true;
+}
+
+uint8_t ParallelCache::read(uint32_t offset)
+{
+	offset &= 0x00FFFFFF;
+
+	uint32_t tag = offset & ~LINE_MASK;
+	uint32_t line = lineIndex(tag);
+
+	if (_tags[line] == tag)
+	{
+		_hits++;
+	}
+	else if (!fill(line, tag))
+	{
+		_uncached++;
+		return _bus.read(offset);
+	}
+
+	return _data[line][offset & LINE_MASK];
+}
+
+void ParallelCache::read(uint32_t offset, uint8_t *dst, size_t n)
+{
+	offset &= 0x00FFFFFF;
+
+	while (n > 0)
+	{
+		uint32_t tag = offset & ~LINE_MASK;
+		uint32_t line = lineIndex(tag);
+		uint32_t first = offset & LINE_MASK;
+		size_t chunk = PARALLEL_CACHE_LINE_SIZE - first;
+
+		if (chunk > n)
+			chunk = n;
+
+		if (_tags[line] == tag)
+		{
+			_hits += chunk;
+			memcpy(dst, &_data[line][first], chunk);
+		}
+		else if (fill(line, tag))
+		{
+			// the first byte was the miss, the rest came with the line
+			_hits += chunk - 1;
+			memcpy(dst, &_data[line][first], chunk);
+		}
+		else
+		{
+			_uncached += chunk;
+			for (size_t i = 0; i < chunk; i++)
+				dst[i] = _bus.read(offset + i);
+		}
+
+		dst += chunk;
+		offset += chunk;
+		n -= chunk;
+	}
+}
+
+void ParallelCache::write(uint32_t offset, uint8_t data)
+{
+	offset &= 0x00FFFFFF;
+	_bus.write(offset, data);
+
+	uint32_t tag = offset & ~LINE_MASK;
+	uint32_t line = lineIndex(tag);
+
+	if (_tags[line] == tag)
+		_data[line][offset & LINE_MASK] = data;
+}
+
+void ParallelCache::write(uint32_t offset, const uint8_t *src, size_t n)
+{
+	offset &= 0x00FFFFFF;
+	_bus.writeMemory(offset, src, n);
+
+	while (n > 0)
+	{
+		uint32_t tag = offset & ~LINE_MASK;
+		uint32_t line = lineIndex(tag);
+		uint32_t first = offset & LINE_MASK;
+		size_t chunk = PARALLEL_CACHE_LINE_SIZE - first;
+
+		if (chunk > n)
+			chunk = n;
+
+		if (_tags[line] == tag)
+			memcpy(&_data[line][first], src, chunk);
+
+		src += chunk;
+		offset += chunk;
+		n -= chunk;
+	}
+}
+
+void ParallelCache::invalidate(void)
+{
+	for (uint32_t i = 0; i < PARALLEL_CACHE_LINES; i++)
+	{
+		_tags[i] = NO_TAG;
+		_uncacheableTags[i] = NO_TAG;
+	}
+}
+
+void ParallelCache::invalidate(uint32_t offset, size_t n)
+{
+	if (n == 0)
+		return;
+
+	offset &= 0x00FFFFFF;
+
+	uint32_t tag = offset & ~LINE_MASK;
+	uint32_t last = (offset + n - 1) & ~LINE_MASK;
+
+	// a range longer than the cache covers every line anyway
+	if ((last - tag) / PARALLEL_CACHE_LINE_SIZE >= PARALLEL_CACHE_LINES)
+	{
+		invalidate();
+		return;
+	}
+
+	for ( ; tag <= last; tag += PARALLEL_CACHE_LINE_SIZE)
+	{
+		uint32_t line = lineIndex(tag);
+
+		if (_tags[line] == tag)
+			_tags[line] = NO_TAG;
+	}
+}
+
+uint8_t ParallelCache::hitRate(void)
+{
+	uint32_t total = _hits + _misses;
+
+	if (total == 0)
+		return 0;
+
+	return (uint8_t)(((uint64_t)_hits * 100) / total);
+}
+
+// Each hit saves one read cycle, each miss spends a line's worth of reads
+// where one would have done.
+int32_t ParallelCache::savedCycles(void)
+{
+	int64_t reads = (int64_t)_hits
+		- (int64_t)_misses * (PARALLEL_CACHE_LINE_SIZE - 1);
+
+	return (int32_t)(reads * _bus.getReadCycles());
+}
+
+void ParallelCache::resetStats(void)
+{
+	_hits = 0;
+	_misses = 0;
+	_uncached = 0;
+}
@@ -0,0 +1,108 @@
+/*
+  ParallelCache.h
+
+  Read-through cache for devices that are slow to read back.  Every read()
+  on the bus costs a full NRD cycle, so code that keeps re-reading the same
+  locations (pixel rows, lookup tables in external memory, ...) can save a
+  lot of bus time by keeping a copy in internal RAM.
+
+  The cache is direct mapped.  A miss fetches the whole line with
+  readMemory(), writes go through to the bus and update any cached copy.
+  Anything the device can change on its own (status registers, data ports
+  that auto-increment) must not be cached: give setUncacheable() a function
+  that returns true for those offsets and they always go to the bus.  A line
+  containing such an offset is never filled, so it is never prefetched
+  either.  The function is asked about each byte of a line when the line
+  is fetched, and a line found uncacheable is remembered, so later reads
+  of it skip the check until setUncacheable() or invalidate() is called.
+  invalidate() drops cached data after the device has been written some
+  other way (DMA, another ParallelClass object, ...).
+
+    static bool isRegister(uint32_t offset) { return offset < 0x10; }
+
+    ParallelCache cache(Parallel);
+    cache.setUncacheable(isRegister);
+    uint8_t v = cache.read(0x1234);
+
+  hits(), misses() and savedCycles() help pick the line size: savedCycles()
+  is the bus time saved by hits less the time spent fetching the rest of
+  each line, so it goes negative when lines are too long for the access
+  pattern.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PARALLEL_CACHE_H
+#define PARALLEL_CACHE_H
+
+#include "Parallel.h"
+
+// Bytes per line and number of lines.  Both must be powers of two.
+#ifndef PARALLEL_CACHE_LINE_SIZE
+#define PARALLEL_CACHE_LINE_SIZE	16
+#endif
+
+#ifndef PARALLEL_CACHE_LINES
+#define PARALLEL_CACHE_LINES		32
+#endif
+
+// Returns true for offsets that must always be read from the bus
+typedef bool (*ParallelUncacheable_t)(uint32_t offset);
+
+class ParallelCache {
+public:
+  ParallelCache(ParallelClass &bus);
+
+  void setUncacheable(ParallelUncacheable_t uncacheable);
+
+  uint8_t read(uint32_t offset);
+  void read(uint32_t offset, uint8_t *dst, size_t n);
+
+  // Write through to the bus, keeping any cached copy up to date
+  void write(uint32_t offset, uint8_t data);
+  void write(uint32_t offset, const uint8_t *src, size_t n);
+
+  void invalidate();
+  void invalidate(uint32_t offset, size_t n);
+
+  uint32_t hits() { return _hits; }
+  uint32_t misses() { return _misses; }
+  uint32_t uncached() { return _uncached; }
+
+  // Hits as a percentage of cacheable reads
+  uint8_t hitRate();
+
+  // Net MCK cycles saved compared with reading every byte from the bus
+  int32_t savedCycles();
+
+  void resetStats();
+
+private:
+  bool fill(uint32_t line, uint32_t tag);
+  bool isUncacheable(uint32_t line, uint32_t tag);
+
+  ParallelClass &_bus;
+  ParallelUncacheable_t _uncacheable;
+
+  uint32_t _tags[PARALLEL_CACHE_LINES];
+  uint32_t _uncacheableTags[PARALLEL_CACHE_LINES];	// last line found uncacheable
+  uint8_t _data[PARALLEL_CACHE_LINES][PARALLEL_CACHE_LINE_SIZE];
+
+  uint32_t _hits;
+  uint32_t _misses;
+  uint32_t _uncached;
+};
+
+#endif
@@ -0,0 +1,192 @@
+/*
+  ParallelCapture.cpp
+
+  Timer paced DMA capture from the parallel bus into a ring buffer.  See
+  ParallelCapture.h for usage.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ParallelCapture.h"
+
+#define CAPTURE_MASK	(PARALLEL_CAPTURE_SIZE - 1)
+
+#if (PARALLEL_CAPTURE_SIZE & CAPTURE_MASK) != 0
+#error "PARALLEL_CAPTURE_SIZE must be a power of two"
+#endif
+
+#define TIMER		PARALLEL_CAPTURE_TIMER
+#define TIMER_CH	PARALLEL_CAPTURE_TIMER_CHANNEL
+
+ParallelCapture *volatile ParallelCapture::_running = NULL;
+ParallelCapture *volatile ParallelCapture::_filling = NULL;
+
+ParallelCapture::ParallelCapture(ParallelClass &bus)
+	: _bus(bus), _offset(0), _chunk(0), _sweep(false), _head(0), _tail(0)
+{
+	clearCounters();
+}
+
+bool ParallelCapture::begin(uint32_t offset, uint16_t chunk, bool sweep)
+{
+	// whole chunks always fit before the end of the ring, so a chunk is
+	// one DMA transfer and never wraps
+	if ((chunk == 0) || (chunk > PARALLEL_DMA_MAX_BLOCK)
+		|| (PARALLEL_CAPTURE_SIZE % chunk) != 0)
+		return false;
+
+	stop();
+	while (_filling == this)
+		;
+
+	_offset = offset;
+	_chunk = chunk;
+	_sweep = sweep;
+	_head = 0;
+	_tail = 0;
+	clearCounters();
+	return true;
+}
+
+bool ParallelCapture::start(uint32_t chunksPerSecond)
+{
+	// TIMER_CLOCK1 is MCK/2
+	uint32_t rc = (chunksPerSecond > 0) ? (VARIANT_MCK / 2) / chunksPerSecond : 0;
+
+	if ((_chunk == 0) || (rc < 2) || ((_running != NULL) && (_running != this)))
+		return false;
+
+	_running = this;
+
+	pmc_enable_periph_clk(PARALLEL_CAPTURE_TIMER_ID);
+	TC_Configure(TIMER, TIMER_CH, TC_CMR_WAVE | TC_CMR_WAVSEL_UP_RC
+		| TC_CMR_TCCLKS_TIMER_CLOCK1);
+	TC_SetRC(TIMER, TIMER_CH, rc);
+	TIMER->TC_CHANNEL[TIMER_CH].TC_IER = TC_IER_CPCS;
+	TIMER->TC_CHANNEL[TIMER_CH].TC_IDR = ~TC_IER_CPCS;
+
+	NVIC_ClearPendingIRQ(PARALLEL_CAPTURE_TIMER_IRQ);
+	NVIC_EnableIRQ(PARALLEL_CAPTURE_TIMER_IRQ);
+	TC_Start(TIMER, TIMER_CH);
+	return true;
+}
+
+// A chunk already in flight still completes
+void ParallelCapture::stop()
+{
+	if (_running != this)
+		return;
+
+	TC_Stop(TIMER, TIMER_CH);
+	TIMER->TC_CHANNEL[TIMER_CH].TC_IDR = TC_IDR_CPCS;
+	NVIC_DisableIRQ(PARALLEL_CAPTURE_TIMER_IRQ);
+	_running = NULL;
+}
+
+void ParallelCapture::tick()
+{
+	if (_chunk == 0)
+		return;
+
+	// the sketch may free space at any time, so it can only be
+	// underestimated here
+	uint32_t head = _head;
+	uint32_t tail = _tail;
+	__DMB();
+
+	if (PARALLEL_CAPTURE_SIZE - (head - tail) < _chunk)
+	{
+		_overruns = _overruns + 1;
+		return;
+	}
+
+	// claim the chunk before starting it, as the DMA interrupt can run
+	// before tryReadAsync() returns
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	bool claimed = (_filling == NULL);
+	if (claimed)
+		_filling = this;
+
+	__set_PRIMASK(primask);
+
+	if (!claimed)
+	{
+		_missed = _missed + 1;
+		return;
+	}
+
+	if (!_bus.tryReadAsync(_offset, &_ring[head & CAPTURE_MASK], _chunk, chunkDone, _sweep))
+	{
+		_filling = NULL;
+		_missed = _missed + 1;
+	}
+}
+
+// DMA interrupt: publish the chunk once its data is in the ring
+void ParallelCapture::chunkDone()
+{
+	ParallelCapture *capture = _filling;
+
+	__DMB();
+	capture->_head = capture->_head + capture->_chunk;
+	capture->_chunks = capture->_chunks + 1;
+	_filling = NULL;
+}
+
+const uint8_t *ParallelCapture::peek(size_t &n)
+{
+	uint32_t tail = _tail;
+	uint32_t i = tail & CAPTURE_MASK;
+
+	n = _head - tail;
+
+	// don't read the samples before the head that covers them
+	__DMB();
+
+	if (n > PARALLEL_CAPTURE_SIZE - i)
+		n = PARALLEL_CAPTURE_SIZE - i;
+
+	return &_ring[i];
+}
+
+void ParallelCapture::release(size_t n)
+{
+	uint32_t waiting = _head - _tail;
+
+	if (n > waiting)
+		n = waiting;
+
+	// finish with the samples before handing the space back
+	__DMB();
+	_tail = _tail + n;
+}
+
+void ParallelCapture::clearCounters()
+{
+	_chunks = 0;
+	_overruns = 0;
+	_missed = 0;
+}
+
+void ParallelCapture::timerInterrupt()
+{
+	TC_GetStatus(TIMER, TIMER_CH);
+
+	ParallelCapture *capture = _running;
+	if (capture)
+		capture->tick();
+}
@@ -0,0 +1,129 @@
+/*
+  ParallelCapture.h
+
+  Logic analyzer style capture from the parallel bus.  A timer interrupt
+  starts a DMA read of one chunk of samples each period, either from a
+  single offset read over and over (a FIFO, or a latch being sampled) or
+  from a run of consecutive offsets (a snapshot of a block of registers),
+  into a ring buffer in SRAM.  The sketch takes the samples out in place:
+
+    ParallelCapture capture(Parallel);
+    capture.begin(0x00, 64);		// offset, bytes per chunk
+    capture.start(10000);			// chunks per second
+
+    size_t n;
+    const uint8_t *samples = capture.peek(n);
+    if (n)
+    {
+      ...
+      capture.release(n);
+    }
+
+  The interrupts fill the ring and the sketch empties it.  They only share
+  the free running head and tail counts, so neither side ever waits for
+  the other.  A tick that finds no room for a whole chunk skips it and
+  counts an overrun; one that finds the DMA channel still busy, with the
+  last chunk or another transfer on the bus, counts a miss.  Either way
+  that period's samples are lost, and the counters show how many.
+
+  The timer is TC2 channel 0 by default.  The sketch defines its interrupt
+  handler, so the library doesn't claim a handler other code may want:
+
+    void TC6_Handler()
+    {
+      ParallelCapture::timerInterrupt();
+    }
+
+  Define PARALLEL_CAPTURE_TIMER and the related macros below to use another
+  channel, and define that channel's handler instead.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PARALLEL_CAPTURE_H
+#define PARALLEL_CAPTURE_H
+
+#include "Parallel.h"
+
+// Ring buffer bytes.  Must be a power of two.
+#ifndef PARALLEL_CAPTURE_SIZE
+#define PARALLEL_CAPTURE_SIZE	8192
+#endif
+
+// Timer channel that paces the capture, its peripheral ID and interrupt
+#ifndef PARALLEL_CAPTURE_TIMER
+#define PARALLEL_CAPTURE_TIMER			TC2
+#define PARALLEL_CAPTURE_TIMER_CHANNEL	0
+#define PARALLEL_CAPTURE_TIMER_ID		ID_TC6
+#define PARALLEL_CAPTURE_TIMER_IRQ		TC6_IRQn
+#endif
+
+class ParallelCapture {
+public:
+  ParallelCapture(ParallelClass &bus);
+
+  // chunk bytes are read each tick, all from offset or, with sweep, from
+  // offset to offset + chunk - 1.  chunk must divide PARALLEL_CAPTURE_SIZE.
+  // Empties the ring and clears the counters.
+  bool begin(uint32_t offset, uint16_t chunk, bool sweep = false);
+
+  // Ticks from the timer.  Only one capture can run at a time.
+  bool start(uint32_t chunksPerSecond);
+  void stop();
+  bool isRunning() { return _running == this; }
+
+  // Starts one chunk.  Called from the timer interrupt, or directly when
+  // something else paces the capture.
+  void tick();
+
+  // Samples waiting, and the oldest of them that are contiguous in the
+  // ring: n is set to how many.  release() frees them once used.  Call from
+  // one context only.
+  size_t available() { return _head - _tail; }
+  const uint8_t *peek(size_t &n);
+  void release(size_t n);
+
+  // Chunks captured, chunks skipped for lack of room, and ticks that found
+  // the DMA channel busy
+  uint32_t chunks() { return _chunks; }
+  uint32_t overruns() { return _overruns; }
+  uint32_t missed() { return _missed; }
+  void clearCounters();
+
+  // Timer interrupt, to be called from the channel's handler
+  static void timerInterrupt();
+
+private:
+  static void chunkDone();
+
+  static ParallelCapture *volatile _running;	// owner of the timer
+  static ParallelCapture *volatile _filling;	// owner of the chunk in flight
+
+  ParallelClass &_bus;
+  uint32_t _offset;
+  uint16_t _chunk;
+  bool _sweep;
+
+  // free running byte counts, the interrupts own _head and the sketch _tail
+  volatile uint32_t _head;
+  volatile uint32_t _tail;
+
+  volatile uint32_t _chunks;
+  volatile uint32_t _overruns;
+  volatile uint32_t _missed;
+  uint8_t _ring[PARALLEL_CAPTURE_SIZE];
+};
+
+#endif
@@ -0,0 +1,304 @@
+/*
+  ParallelDMA.cpp
+
+  Asynchronous transfers for the parallel port on the Arduino DUE board.  The
+  SAM3X DMA controller (DMAC) is used in memory to memory mode to move a buffer
+  between internal SRAM and the memory mapped SMC window while the CPU carries
+  on with other work.  The bus address is normally held fixed, which matches
+  the data register of index addressed devices such as LCD controllers, or a
+  FIFO being read.  Sequences built with ParallelSequence run from a linked 
+  descriptor list.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Parallel.h"
+#include "ParallelSequence.h"
+#include "ParallelStats.h"
+
+#define DMA_CH		PARALLEL_DMA_CHANNEL
+#define DMA_CH_BIT	(1u << DMA_CH)
+
+// State of the transfer in flight.  There is only one DMA channel for the 
+// library so this is shared by all users of the bus.
+static volatile bool dmaBusy = false;
+static bool dmaChained;
+static ParallelDmaAddr_t dmaSrc;
+static ParallelDmaAddr_t dmaDst;
+static uint32_t dmaIncrement;		// DMAC_CTRLB SRC_INCR/DST_INCR bits
+static volatile size_t dmaRemaining;
+static ParallelCallback_t dmaCallback;
+
+// Turn on the DMA controller the first time it is needed
+static void dmaInit(void)
+{
+	static bool initialized = false;
+	
+	if (initialized)
+		return;
+	
+	pmc_enable_periph_clk(ID_DMAC);
+	DMAC->DMAC_EN = 0;
+	DMAC->DMAC_GCFG = DMAC_GCFG_ARB_CFG_ROUND_ROBIN;
+	DMAC->DMAC_EN = DMAC_EN_ENABLE;
+	
+	NVIC_EnableIRQ(DMAC_IRQn);
+	initialized = true;
+}
+
+// Program the channel for the next chunk of the transfer and start it
+static void dmaStartChunk(void)
+{
+	size_t n = dmaRemaining;
+	
+	if (n > PARALLEL_DMA_MAX_BLOCK)
+		n = PARALLEL_DMA_MAX_BLOCK;
+	
+	DMAC->DMAC_CH_NUM[DMA_CH].DMAC_SADDR = dmaSrc;
+	DMAC->DMAC_CH_NUM[DMA_CH].DMAC_DADDR = dmaDst;
+	DMAC->DMAC_CH_NUM[DMA_CH].DMAC_DSCR = 0;
+	DMAC->DMAC_CH_NUM[DMA_CH].DMAC_CTRLA = DMAC_CTRLA_BTSIZE(n)
+		| DMAC_CTRLA_SRC_WIDTH_BYTE
+		| DMAC_CTRLA_DST_WIDTH_BYTE;
+	DMAC->DMAC_CH_NUM[DMA_CH].DMAC_CTRLB = DMAC_CTRLB_SRC_DSCR_FETCH_DISABLE
+		| DMAC_CTRLB_DST_DSCR_FETCH_DISABLE
+		| DMAC_CTRLB_FC_MEM2MEM_DMA_FC
+		| dmaIncrement;
+	DMAC->DMAC_CH_NUM[DMA_CH].DMAC_CFG = DMAC_CFG_SOD_ENABLE
+		| DMAC_CFG_AHB_PROT(1)
+		| DMAC_CFG_FIFOCFG_ALAP_CFG;
+	
+	if ((dmaIncrement & DMAC_CTRLB_SRC_INCR_Msk) == DMAC_CTRLB_SRC_INCR_INCREMENTING)
+		dmaSrc += n;
+	if ((dmaIncrement & DMAC_CTRLB_DST_INCR_Msk) == DMAC_CTRLB_DST_INCR_INCREMENTING)
+		dmaDst += n;
+	dmaRemaining -= n;
+	
+	DMAC->DMAC_EBCIER = (DMAC_EBCIER_BTC0 | DMAC_EBCIER_ERR0) << DMA_CH;
+	DMAC->DMAC_CHER = DMAC_CHER_ENA0 << DMA_CH;
+	PARALLEL_DMA_KICK(DMA_CH);
+}
+
+// Takes ownership of the DMA channel if it is free.  Interrupts are masked
+// for the test-and-set so an interrupt can't claim it in between.
+static bool dmaClaim(void)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	
+	bool claimed = !dmaBusy;
+	if (claimed)
+		dmaBusy = true;
+	
+	__set_PRIMASK(primask);
+	return claimed;
+}
+
+// Starts a single block transfer on a channel that has already been claimed
+static void dmaStartBlock(ParallelDmaAddr_t dst, ParallelDmaAddr_t src, 
+                          uint32_t increment, size_t n, ParallelCallback_t callback)
+{
+	dmaInit();
+	
+	dmaSrc = src;
+	dmaDst = dst;
+	dmaIncrement = increment;
+	dmaRemaining = n;
+	dmaCallback = callback;
+	dmaChained = false;
+	
+	// clear any stale status before starting
+	(void)DMAC->DMAC_EBCISR;
+	dmaStartChunk();
+}
+
+void ParallelClass::writeAsync(uint32_t offset, const uint8_t *src, size_t n, 
+                               ParallelCallback_t callback)
+{
+	if (n == 0)
+	{
+		wait();
+		if (callback)
+			callback();
+		return;
+	}
+	
+	if (!waitGuard())
+		return;
+	
+	PARALLEL_STATS_BEGIN(n);
+	
+	while (!dmaClaim())
+		;
+	
+	dmaStartBlock(_busAddress(offset), PARALLEL_DMA_ADDR(src),
+		DMAC_CTRLB_SRC_INCR_INCREMENTING | DMAC_CTRLB_DST_INCR_FIXED, n, callback);
+	
+	// only the time spent waiting for the channel and setting it up is 
+	// counted, the transfer itself runs in the background
+	PARALLEL_STATS_END(smcChipSelect());
+}
+
+void ParallelClass::writeAsync(ParallelSequence &sequence, ParallelCallback_t callback)
+{
+	const ParallelDmaDescriptor_t *first = sequence.descriptors();
+	
+	if (first == NULL)
+	{
+		wait();
+		if (callback)
+			callback();
+		return;
+	}
+	
+	if (!waitGuard())
+		return;
+	
+	PARALLEL_STATS_BEGIN(sequence.byteCount());
+	
+	while (!dmaClaim())
+		;
+	
+	dmaInit();
+	
+	dmaRemaining = 0;
+	dmaCallback = callback;
+	dmaChained = true;
+	
+	// Source, destination and control words all come from the descriptors
+	DMAC->DMAC_CH_NUM[DMA_CH].DMAC_SADDR = 0;
+	DMAC->DMAC_CH_NUM[DMA_CH].DMAC_DADDR = 0;
+	DMAC->DMAC_CH_NUM[DMA_CH].DMAC_DSCR = PARALLEL_DMA_ADDR(first);
+	DMAC->DMAC_CH_NUM[DMA_CH].DMAC_CTRLB = DMAC_CTRLB_SRC_DSCR_FETCH_FROM_MEM
+		| DMAC_CTRLB_DST_DSCR_FETCH_FROM_MEM;
+	DMAC->DMAC_CH_NUM[DMA_CH].DMAC_CFG = DMAC_CFG_AHB_PROT(1)
+		| DMAC_CFG_FIFOCFG_ALAP_CFG;
+	
+	(void)DMAC->DMAC_EBCISR;
+	DMAC->DMAC_EBCIER = (DMAC_EBCIER_CBTC0 | DMAC_EBCIER_ERR0) << DMA_CH;
+	DMAC->DMAC_CHER = DMAC_CHER_ENA0 << DMA_CH;
+	PARALLEL_DMA_KICK(DMA_CH);
+	
+	PARALLEL_STATS_END(smcChipSelect());
+}
+
+bool ParallelClass::tryWriteAsync(uint32_t offset, const uint8_t *src, size_t n, 
+                                  ParallelCallback_t callback)
+{
+	if (!waitGuard() || !dmaClaim())
+		return false;
+	
+	if (n == 0)
+	{
+		dmaBusy = false;
+		if (callback)
+			callback();
+		return true;
+	}
+	
+	PARALLEL_STATS_BEGIN(n);
+	dmaStartBlock(_busAddress(offset), PARALLEL_DMA_ADDR(src),
+		DMAC_CTRLB_SRC_INCR_INCREMENTING | DMAC_CTRLB_DST_INCR_FIXED, n, callback);
+	PARALLEL_STATS_END(smcChipSelect());
+	return true;
+}
+
+static uint32_t readIncrement(bool incrementing)
+{
+	return (incrementing ? DMAC_CTRLB_SRC_INCR_INCREMENTING : DMAC_CTRLB_SRC_INCR_FIXED)
+		| DMAC_CTRLB_DST_INCR_INCREMENTING;
+}
+
+void ParallelClass::readAsync(uint32_t offset, uint8_t *dst, size_t n, 
+                              ParallelCallback_t callback, bool incrementing)
+{
+	if (n == 0)
+	{
+		wait();
+		if (callback)
+			callback();
+		return;
+	}
+	
+	if (!waitGuard())
+		return;
+	
+	PARALLEL_STATS_BEGIN(n);
+	
+	while (!dmaClaim())
+		;
+	
+	dmaStartBlock(PARALLEL_DMA_ADDR(dst), _busAddress(offset), 
+		readIncrement(incrementing), n, callback);
+	PARALLEL_STATS_END(smcChipSelect());
+}
+
+bool ParallelClass::tryReadAsync(uint32_t offset, uint8_t *dst, size_t n, 
+                                 ParallelCallback_t callback, bool incrementing)
+{
+	if (!waitGuard() || !dmaClaim())
+		return false;
+	
+	if (n == 0)
+	{
+		dmaBusy = false;
+		if (callback)
+			callback();
+		return true;
+	}
+	
+	PARALLEL_STATS_BEGIN(n);
+	dmaStartBlock(PARALLEL_DMA_ADDR(dst), _busAddress(offset), 
+		readIncrement(incrementing), n, callback);
+	PARALLEL_STATS_END(smcChipSelect());
+	return true;
+}
+
+bool ParallelClass::isBusy(void)
+{
+	return dmaBusy;
+}
+
+void ParallelClass::wait(void)
+{
+	while (dmaBusy)
+		;
+}
+
+// DMA interrupt.  Restarts the channel until the whole buffer has been moved, 
+// then signals completion.  A descriptor chain only interrupts once, at the
+// end of the last descriptor.  Reading the status register clears it.
+extern "C" void DMAC_Handler(void)
+{
+	uint32_t status = DMAC->DMAC_EBCISR;
+	uint32_t done = dmaChained ? DMAC_EBCISR_CBTC0 : DMAC_EBCISR_BTC0;
+	
+	if ((status & ((done | DMAC_EBCISR_ERR0) << DMA_CH)) == 0)
+		return;
+	
+	if ((dmaRemaining > 0) && !(status & (DMAC_EBCISR_ERR0 << DMA_CH)))
+	{
+		dmaStartChunk();
+		return;
+	}
+	
+	DMAC->DMAC_EBCIDR = (DMAC_EBCIER_BTC0 | DMAC_EBCIER_CBTC0 | DMAC_EBCIER_ERR0) << DMA_CH;
+	DMAC->DMAC_CHDR = DMAC_CHDR_DIS0 << DMA_CH;
+	dmaRemaining = 0;
+	dmaBusy = false;
+	
+	if (dmaCallback)
+		dmaCallback();
+}
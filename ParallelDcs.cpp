@@ -0,0 +1,96 @@
+/*
+  ParallelDcs.cpp
+
+  Drivers for MIPI DCS TFT controllers.  See ParallelDcs.h.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ParallelDcs.h"
+
+// Bytes of pattern built up for fillPixels(), a whole number of pixels of
+// every size up to PARALLEL_DCS_MAX_PIXEL
+#define FILL_CHUNK	48
+
+void ParallelDcsDevice::fillPixels(const uint8_t *pixel, uint8_t size, uint32_t count)
+{
+	if ((size == 0) || (size > PARALLEL_DCS_MAX_PIXEL))
+		return;
+
+	// A pixel with all bytes equal is just a fill
+	bool uniform = true;
+	for (uint8_t i = 1; i < size; i++)
+		uniform = uniform && (pixel[i] == pixel[0]);
+
+	if (uniform)
+	{
+		fillData(pixel[0], (size_t)count * size);
+		return;
+	}
+
+	uint8_t chunk[FILL_CHUNK];
+	uint32_t perChunk = FILL_CHUNK / size;
+
+	for (uint32_t i = 0; i < perChunk * size; i++)
+		chunk[i] = pixel[i % size];
+
+	while (count >= perChunk)
+	{
+		writeData(chunk, perChunk * size);
+		count -= perChunk;
+	}
+
+	if (count > 0)
+		writeData(chunk, count * size);
+}
+
+static const uint8_t ili9341Init[] = {
+	DCS_SOFT_RESET, 0 | PARALLEL_INIT_DELAY, 5,
+	DCS_SLEEP_OUT, 0 | PARALLEL_INIT_DELAY, 120,
+	DCS_PIXEL_FORMAT, 1, 0x55,			// 16 bits per pixel
+	DCS_ADDRESS_MODE, 1, 0x48,			// portrait, BGR panel
+	DCS_DISPLAY_ON, 0,
+};
+
+void ParallelILI9341::begin(void)
+{
+	initialize(ili9341Init, sizeof(ili9341Init));
+}
+
+static const uint8_t ssd1963Init[] = {
+	DCS_SOFT_RESET, 0 | PARALLEL_INIT_DELAY, 5,
+	0xE2, 3, 0x23, 0x02, 0x54,			// PLL: 10 MHz * 36 / 3 = 120 MHz
+	0xE0, 1 | PARALLEL_INIT_DELAY, 0x01, 1,	// start PLL
+	0xE0, 1 | PARALLEL_INIT_DELAY, 0x03, 5,	// lock PLL
+	DCS_SOFT_RESET, 0 | PARALLEL_INIT_DELAY, 5,
+	0xE6, 3, 0x01, 0x1F, 0xFF,			// pixel clock ~9 MHz
+	0xB0, 7,							// LCD mode: 24-bit TFT, 480x272
+		0x20, 0x00,
+		0x01, 0xDF,
+		0x01, 0x0F,
+		0x00,
+	0xB4, 8,							// horizontal period 531, pulse 43
+		0x02, 0x13, 0x00, 0x08, 0x2B, 0x00, 0x02, 0x00,
+	0xB6, 7,							// vertical period 288, pulse 12
+		0x01, 0x20, 0x00, 0x04, 0x0C, 0x00, 0x02,
+	0xF0, 1, 0x00,						// 8-bit pixel data interface
+	DCS_ADDRESS_MODE, 1, 0x00,
+	DCS_DISPLAY_ON, 0,
+};
+
+void ParallelSSD1963::begin(void)
+{
+	initialize(ssd1963Init, sizeof(ssd1963Init));
+}
@@ -0,0 +1,95 @@
+/*
+  ParallelDcs.h
+
+  Drivers for TFT controllers using the MIPI DCS command set over an 8080
+  style bus, with D/C (RS) on the first address line: low selects the
+  command register, high the data register.  ParallelDcsDevice has the
+  window and memory write commands they share; the controller classes only
+  add their init tables.
+
+    ParallelILI9341 tft(Parallel);
+    static const uint8_t red[] = { 0xF8, 0x00 };	// RGB565, high byte first
+
+    tft.begin();
+    tft.setWindow(0, 0, 239, 319);
+    tft.fillPixels(red, sizeof(red), 240 * 320UL);
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PARALLEL_DCS_H
+#define PARALLEL_DCS_H
+
+#include "ParallelDevice.h"
+
+// DCS command codes
+#define DCS_SOFT_RESET			0x01
+#define DCS_SLEEP_OUT			0x11
+#define DCS_DISPLAY_OFF			0x28
+#define DCS_DISPLAY_ON			0x29
+#define DCS_COLUMN_ADDRESS		0x2A
+#define DCS_PAGE_ADDRESS		0x2B
+#define DCS_MEMORY_WRITE		0x2C
+#define DCS_MEMORY_READ			0x2E
+#define DCS_ADDRESS_MODE		0x36
+#define DCS_PIXEL_FORMAT		0x3A
+
+// Largest pixel pattern fillPixels() takes, in bytes
+#define PARALLEL_DCS_MAX_PIXEL	4
+
+class ParallelDcsDevice : public ParallelIndexedDevice {
+public:
+  ParallelDcsDevice(ParallelClass &bus, uint32_t commandOffset = 0x00,
+                    uint32_t dataOffset = 0x01)
+    : ParallelIndexedDevice(bus, commandOffset, dataOffset, commandOffset) { }
+
+  // Selects the rectangle (inclusive) that pixel data fills and starts a
+  // memory write
+  void setWindow(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1)
+  {
+    command(DCS_COLUMN_ADDRESS, x0 >> 8, x0, x1 >> 8, x1);
+    command(DCS_PAGE_ADDRESS, y0 >> 8, y0, y1 >> 8, y1);
+    command(DCS_MEMORY_WRITE);
+  }
+
+  // Pixel data in the controller's interface format
+  void writePixels(const uint8_t *src, size_t n) { writeData(src, n); }
+
+  // Sends count copies of one pixel of size bytes
+  void fillPixels(const uint8_t *pixel, uint8_t size, uint32_t count);
+
+  void setAddressMode(uint8_t mode) { command(DCS_ADDRESS_MODE, mode); }
+  void displayOn() { command(DCS_DISPLAY_ON); }
+  void displayOff() { command(DCS_DISPLAY_OFF); }
+};
+
+// ILITEK ILI9341, 240x320, RGB565 pixels sent as two bytes, high byte first
+class ParallelILI9341 : public ParallelDcsDevice {
+public:
+  ParallelILI9341(ParallelClass &bus) : ParallelDcsDevice(bus) { }
+  void begin();
+};
+
+// Solomon SSD1963 with a 480x272 TFT panel and a 10 MHz crystal, 8-bit
+// interface with 24-bit pixels sent as three bytes (R, G, B).  Pass a table
+// for other panels.
+class ParallelSSD1963 : public ParallelDcsDevice {
+public:
+  ParallelSSD1963(ParallelClass &bus) : ParallelDcsDevice(bus) { }
+  void begin();
+  void begin(const uint8_t *table, size_t length) { initialize(table, length); }
+};
+
+#endif
@@ -0,0 +1,82 @@
+/*
+  ParallelDevice.cpp
+
+  Base class for command/data (A0) controllers.  See ParallelDevice.h for
+  usage.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ParallelDevice.h"
+
+ParallelIndexedDevice::ParallelIndexedDevice(ParallelClass &bus,
+                                             uint32_t commandOffset,
+                                             uint32_t dataOffset,
+                                             uint32_t statusOffset)
+	: _bus(bus), _commandOffset(commandOffset), _dataOffset(dataOffset),
+	  _readOffset(dataOffset), _statusOffset(statusOffset), _busyPoll(NULL),
+	  _timeouts(0)
+{
+}
+
+bool ParallelIndexedDevice::waitReady(void)
+{
+	if (_busyPoll == NULL)
+		return true;
+
+	for (uint32_t i = 0; i < PARALLEL_BUSY_POLL_LIMIT; i++)
+	{
+		if (!_busyPoll(_bus.read(_statusOffset)))
+			return true;
+	}
+
+	_timeouts++;
+	return false;
+}
+
+// A DMA transfer to the data port may still be running, and the command
+// must not land in the middle of it.
+void ParallelIndexedDevice::writeCommand(uint8_t cmd, const uint8_t *params, size_t n)
+{
+	_bus.wait();
+	waitReady();
+
+	_bus.write(_commandOffset, cmd);
+
+	if (n > 0)
+		_bus.writeBlock(_dataOffset, params, n);
+}
+
+void ParallelIndexedDevice::initialize(const uint8_t *table, size_t length)
+{
+	const uint8_t *end = table + length;
+
+	while (table + 2 <= end)
+	{
+		uint8_t cmd = table[0];
+		uint8_t count = table[1] & ~PARALLEL_INIT_DELAY;
+		bool hasDelay = (table[1] & PARALLEL_INIT_DELAY) != 0;
+
+		table += 2;
+		if (table + count + (hasDelay ? 1 : 0) > end)
+			break;
+
+		writeCommand(cmd, table, count);
+		table += count;
+
+		if (hasDelay)
+			delay(*table++);
+	}
+}
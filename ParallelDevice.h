@@ -0,0 +1,136 @@
+/*
+  ParallelDevice.h
+
+  Base class for index addressed controllers that use one address line (A0,
+  RS or D/C) to tell commands from data, such as the S1D13700, SSD1963 and
+  ILI9341 in 8080 mode.  A command is a write to the command offset followed
+  by its parameters written as a block to the data offset:
+
+    ParallelIndexedDevice lcd(Parallel, 0x01, 0x00, 0x00);
+    lcd.command(0x5D, 0x07, 0x87);		// CSRFORM with two parameters
+    lcd.command(0x42);					// MWRITE
+    lcd.writeData(pixels, sizeof(pixels));
+
+  command() packs its parameters into a block at compile time, so a command
+  costs one write plus one writeBlock() however many parameters it takes.
+
+  Controllers are brought up from an init table of
+  { command, count [| PARALLEL_INIT_DELAY], parameters..., [delay ms] }
+  entries, which lives in flash and runs with initialize().
+
+  For controllers that need it, setBusyPoll() makes every command wait
+  until a function of the status register says the controller is ready.
+  The status register is read from its own offset, which isn't always the
+  command offset (the S1D13700 returns status with A0 low).
+
+  All of the calls wait for a writeDataAsync() that is still running, so
+  the CPU's accesses never land in the middle of the DMA's.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PARALLEL_DEVICE_H
+#define PARALLEL_DEVICE_H
+
+#include "Parallel.h"
+
+// Set in an init table count byte when a delay in ms follows the parameters
+#define PARALLEL_INIT_DELAY		0x80
+
+// Status reads made by a busy poll before it gives up
+#ifndef PARALLEL_BUSY_POLL_LIMIT
+#define PARALLEL_BUSY_POLL_LIMIT	10000
+#endif
+
+// Returns true while the status value says the controller is busy
+typedef bool (*ParallelBusyPoll_t)(uint8_t status);
+
+class ParallelIndexedDevice {
+public:
+  ParallelIndexedDevice(ParallelClass &bus, uint32_t commandOffset,
+                        uint32_t dataOffset, uint32_t statusOffset);
+
+  // Command with no parameters
+  void command(uint8_t cmd) { writeCommand(cmd, NULL, 0); }
+
+  // Command with parameters, each sent as one byte
+  template <typename... Args> void command(uint8_t cmd, Args... args)
+  {
+    const uint8_t params[] = { static_cast<uint8_t>(args)... };
+    writeCommand(cmd, params, sizeof(params));
+  }
+
+  void writeCommand(uint8_t cmd, const uint8_t *params, size_t n);
+
+  // Data stream to/from the controller's memory or registers
+  void writeData(uint8_t data)
+  {
+    _bus.wait();
+    _bus.write(_dataOffset, data);
+  }
+  void writeData(const uint8_t *src, size_t n)
+  {
+    _bus.wait();
+    _bus.writeBlock(_dataOffset, src, n);
+  }
+  void fillData(uint8_t value, size_t n)
+  {
+    _bus.wait();
+    _bus.fill(_dataOffset, value, n);
+  }
+  void readData(uint8_t *dst, size_t n)
+  {
+    _bus.wait();
+    _bus.readBlock(_readOffset, dst, n);
+  }
+  void writeDataAsync(const uint8_t *src, size_t n, ParallelCallback_t callback = NULL)
+  {
+    _bus.writeAsync(_dataOffset, src, n, callback);
+  }
+
+  // Where readData() reads from, if not the data offset
+  void setReadOffset(uint32_t offset) { _readOffset = offset; }
+
+  // Commands wait until poll(status) returns false.  NULL turns it off.
+  void setBusyPoll(ParallelBusyPoll_t poll) { _busyPoll = poll; }
+  uint8_t readStatus()
+  {
+    _bus.wait();
+    return _bus.read(_statusOffset);
+  }
+
+  // Returns false if the controller was still busy after
+  // PARALLEL_BUSY_POLL_LIMIT status reads
+  bool waitReady();
+
+  // Number of busy polls that gave up
+  uint32_t timeouts() { return _timeouts; }
+
+  // Runs an init table of length bytes
+  void initialize(const uint8_t *table, size_t length);
+
+  ParallelClass &bus() { return _bus; }
+
+protected:
+  ParallelClass &_bus;
+  uint32_t _commandOffset;
+  uint32_t _dataOffset;
+  uint32_t _readOffset;
+  uint32_t _statusOffset;
+  ParallelBusyPoll_t _busyPoll;
+  uint32_t _timeouts;
+};
+
+#endif
@@ -0,0 +1,204 @@
+/*
+  ParallelFont.cpp
+
+  Bitmap fonts and rendered text cache.  See ParallelFont.h for usage.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ParallelFont.h"
+
+ParallelFont::ParallelFont()
+	: _glyphs(NULL), _width(0), _height(0), _first(0), _count(0),
+	  _rowBytes(0), _glyphBytes(0), _spacing(0)
+{
+}
+
+bool ParallelFont::begin(const ParallelFont_t &font, uint8_t *buffer)
+{
+	_width = font.width;
+	_height = font.height;
+	_first = font.first;
+	_rowBytes = (font.width + 7) / 8;
+	_glyphBytes = _rowBytes * font.height;
+
+	if (font.layout == PARALLEL_FONT_ROWS)
+	{
+		_glyphs = font.data;
+		_count = font.count;
+		return true;
+	}
+
+	if (buffer == NULL)
+	{
+		_glyphs = NULL;
+		_count = 0;
+		return false;
+	}
+
+	// Transpose each glyph from columns (LSB at the top) to rows (MSB on
+	// the left)
+	uint8_t columnBytes = (font.height + 7) / 8;
+
+	memset(buffer, 0, packedSize(font));
+
+	for (uint16_t g = 0; g < font.count; g++)
+	{
+		const uint8_t *src = font.data + g * font.width * columnBytes;
+		uint8_t *dst = buffer + g * _glyphBytes;
+
+		for (uint8_t x = 0; x < font.width; x++)
+		{
+			for (uint8_t y = 0; y < font.height; y++)
+			{
+				if (src[x * columnBytes + (y >> 3)] & (1 << (y & 7)))
+					dst[y * _rowBytes + (x >> 3)] |= 0x80 >> (x & 7);
+			}
+		}
+	}
+
+	_glyphs = buffer;
+	_count = font.count;
+	return true;
+}
+
+ParallelTextCache::ParallelTextCache(ParallelFont &font)
+	: _font(font), _clock(0), _hits(0), _misses(0), _glyphs(0)
+{
+	invalidate();
+}
+
+void ParallelTextCache::invalidate(void)
+{
+	for (uint8_t i = 0; i < PARALLEL_TEXT_CACHE_ENTRIES; i++)
+	{
+		_entries[i].text[0] = '\0';
+		_entries[i].width = 0;
+		_entries[i].stride = 0;
+		_entries[i].used = 0;
+	}
+}
+
+const uint8_t *ParallelTextCache::render(const char *text, uint16_t *width,
+                                         uint16_t *stride)
+{
+	Entry_t *entry = NULL;
+
+	_clock++;
+
+	for (uint8_t i = 0; i < PARALLEL_TEXT_CACHE_ENTRIES; i++)
+	{
+		Entry_t &e = _entries[i];
+
+		if ((e.used != 0) && (strncmp(e.text, text, PARALLEL_TEXT_MAX_CHARS) == 0))
+		{
+			entry = &e;
+			_hits++;
+			break;
+		}
+	}
+
+	if (entry == NULL)
+	{
+		// replace the least recently used entry
+		entry = &_entries[0];
+		for (uint8_t i = 1; i < PARALLEL_TEXT_CACHE_ENTRIES; i++)
+		{
+			if (_entries[i].used < entry->used)
+				entry = &_entries[i];
+		}
+
+		renderEntry(*entry, text);
+		_misses++;
+	}
+
+	entry->used = _clock;
+	*width = entry->width;
+	*stride = entry->stride;
+	return entry->bitmap;
+}
+
+void ParallelTextCache::renderEntry(Entry_t &entry, const char *text)
+{
+	uint8_t advance = _font.advance();
+	uint8_t height = _font.height();
+	uint8_t rowBytes = _font.rowBytes();
+	size_t n = strlen(text);
+
+	if (n > PARALLEL_TEXT_MAX_CHARS)
+		n = PARALLEL_TEXT_MAX_CHARS;
+
+	// cut the string short if the bitmap wouldn't fit
+	if (height > 0)
+	{
+		uint16_t maxStride = PARALLEL_TEXT_MAX_BYTES / height;
+
+		while ((n > 0) && (((n * advance + 7) >> 3) > maxStride))
+			n--;
+	}
+
+	memcpy(entry.text, text, n);
+	entry.text[n] = '\0';
+	entry.width = (n > 0) ? n * advance - (advance - _font.width()) : 0;
+	entry.stride = (n * advance + 7) >> 3;
+
+	memset(entry.bitmap, 0, entry.stride * height);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		const uint8_t *glyph = _font.glyph(text[i]);
+
+		if (glyph == NULL)
+			continue;
+
+		uint16_t x = i * advance;
+		uint16_t column = x >> 3;
+		uint8_t shift = x & 7;
+
+		for (uint8_t r = 0; r < height; r++)
+		{
+			const uint8_t *src = glyph + r * rowBytes;
+			uint8_t *dst = entry.bitmap + r * entry.stride + column;
+
+			if (shift == 0)
+			{
+				for (uint8_t b = 0; b < rowBytes; b++)
+					dst[b] |= src[b];
+			}
+			else
+			{
+				for (uint8_t b = 0; b < rowBytes; b++)
+				{
+					dst[b] |= src[b] >> shift;
+					if (column + b + 1 < entry.stride)
+						dst[b + 1] |= (uint8_t)(src[b] << (8 - shift));
+				}
+			}
+		}
+
+		_glyphs++;
+	}
+}
+
+void ParallelTextCache::draw(ParallelS1D13700 &lcd, uint16_t x, uint16_t y,
+                             const char *text)
+{
+	uint16_t width;
+	uint16_t stride;
+	const uint8_t *bitmap = render(text, &width, &stride);
+
+	if (width > 0)
+		lcd.blit(x, y, bitmap, width, _font.height(), stride);
+}
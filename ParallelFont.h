@@ -0,0 +1,161 @@
+/*
+  ParallelFont.h
+
+  Bitmap fonts and rendered text for 1bpp graphics layers.  Drawing text a
+  pixel at a time costs several bus cycles per pixel; instead, strings are
+  rendered in SRAM into the controller's own layout (rows of bytes, MSB is
+  the leftmost pixel) and sent as one block write per row, each starting a
+  run of the cursor auto-increment.
+
+  ParallelFont holds the glyphs in that row-major layout.  Fonts stored that
+  way are used straight from flash.  The common column-major layout (one
+  byte per column, LSB at the top, as in most 5x7 LCD fonts) is packed into
+  a buffer once by begin(), so nothing is rearranged while drawing.
+
+  ParallelTextCache renders whole strings and keeps the last few, so a
+  label that is redrawn (menus, status lines, ...) is only rendered once.
+
+    extern const uint8_t font5x7[];
+    static const ParallelFont_t font5x7Info =
+      { font5x7, 5, 7, 0x20, 96, PARALLEL_FONT_COLUMNS };
+    static uint8_t packed[96 * 7];
+
+    ParallelFont font;
+    ParallelTextCache text(font);
+
+    font.begin(font5x7Info, packed);
+    font.setSpacing(1);
+    text.draw(lcd, 10, 20, "Hello");
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PARALLEL_FONT_H
+#define PARALLEL_FONT_H
+
+#include "ParallelS1D13700.h"
+
+// Number of strings kept by ParallelTextCache
+#ifndef PARALLEL_TEXT_CACHE_ENTRIES
+#define PARALLEL_TEXT_CACHE_ENTRIES	4
+#endif
+
+// Longest string, and largest rendered bitmap in bytes, per cache entry
+#ifndef PARALLEL_TEXT_MAX_CHARS
+#define PARALLEL_TEXT_MAX_CHARS		40
+#endif
+
+#ifndef PARALLEL_TEXT_MAX_BYTES
+#define PARALLEL_TEXT_MAX_BYTES		640
+#endif
+
+typedef enum
+{
+	PARALLEL_FONT_ROWS,		// rows of (width + 7) / 8 bytes, MSB leftmost
+	PARALLEL_FONT_COLUMNS	// columns of (height + 7) / 8 bytes, LSB at the top
+} ParallelFontLayout_t;
+
+typedef struct
+{
+	const uint8_t *data;	// glyphs for first .. first + count - 1
+	uint8_t width;			// pixels
+	uint8_t height;			// pixels
+	uint8_t first;			// first character code
+	uint8_t count;			// number of glyphs
+	ParallelFontLayout_t layout;
+} ParallelFont_t;
+
+class ParallelFont {
+public:
+  ParallelFont();
+
+  // Row-major fonts are used in place.  Column-major fonts are packed into
+  // buffer, which must hold packedSize() bytes.  Returns false if a buffer
+  // is needed and missing.
+  bool begin(const ParallelFont_t &font, uint8_t *buffer = NULL);
+
+  static size_t packedSize(const ParallelFont_t &font)
+  {
+    return (size_t)font.count * font.height * ((font.width + 7) / 8);
+  }
+
+  // Blank columns added after each glyph
+  void setSpacing(uint8_t spacing) { _spacing = spacing; }
+
+  // Row-major glyph, or NULL for characters the font doesn't have
+  const uint8_t *glyph(char c)
+  {
+    uint8_t index = (uint8_t)c - _first;
+    return (index < _count) ? _glyphs + index * _glyphBytes : NULL;
+  }
+
+  uint8_t width() { return _width; }
+  uint8_t height() { return _height; }
+  uint8_t rowBytes() { return _rowBytes; }
+  uint8_t advance() { return _width + _spacing; }
+
+private:
+  const uint8_t *_glyphs;
+  uint8_t _width;
+  uint8_t _height;
+  uint8_t _first;
+  uint8_t _count;
+  uint8_t _rowBytes;
+  uint16_t _glyphBytes;
+  uint8_t _spacing;
+};
+
+class ParallelTextCache {
+public:
+  ParallelTextCache(ParallelFont &font);
+
+  // Returns text rendered as font.height() rows of stride bytes, width
+  // pixels wide.  The bitmap stays valid until PARALLEL_TEXT_CACHE_ENTRIES
+  // other strings have been rendered.  Text that doesn't fit an entry is
+  // cut short.
+  const uint8_t *render(const char *text, uint16_t *width, uint16_t *stride);
+
+  void draw(ParallelS1D13700 &lcd, uint16_t x, uint16_t y, const char *text);
+
+  // Call after changing the font or its spacing
+  void invalidate();
+
+  uint32_t hits() { return _hits; }
+  uint32_t misses() { return _misses; }
+
+  // Glyphs rendered (cache hits don't render any)
+  uint32_t glyphs() { return _glyphs; }
+
+private:
+  typedef struct
+  {
+    char text[PARALLEL_TEXT_MAX_CHARS + 1];
+    uint16_t width;
+    uint16_t stride;
+    uint32_t used;
+    uint8_t bitmap[PARALLEL_TEXT_MAX_BYTES];
+  } Entry_t;
+
+  void renderEntry(Entry_t &entry, const char *text);
+
+  ParallelFont &_font;
+  Entry_t _entries[PARALLEL_TEXT_CACHE_ENTRIES];
+  uint32_t _clock;
+  uint32_t _hits;
+  uint32_t _misses;
+  uint32_t _glyphs;
+};
+
+#endif
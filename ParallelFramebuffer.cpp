@@ -0,0 +1,235 @@
+/*
+  ParallelFramebuffer.cpp
+
+  Double buffered 1bpp framebuffer with dirty span tracking.  See 
+  ParallelFramebuffer.h for usage.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ParallelFramebuffer.h"
+
+ParallelFramebuffer::ParallelFramebuffer(ParallelClass &bus, uint16_t width, 
+                                         uint16_t height, uint8_t *back, 
+                                         uint8_t *front) 
+	: _bus(bus), _back(back), _front(front), _layer(0)
+{
+	if (width > PARALLEL_FB_MAX_WIDTH)
+		width = PARALLEL_FB_MAX_WIDTH;
+	if (height > PARALLEL_FB_MAX_HEIGHT)
+		height = PARALLEL_FB_MAX_HEIGHT;
+	
+	_width = width;
+	_height = height;
+	_stride = (width + 7) / 8;
+	
+	setController(0x01, 0x00, 0x46, 0x42);
+	
+	// every row clean, so markDirty() starts from known spans
+	memset(_dirtyFirst, 0xFF, sizeof(_dirtyFirst));
+	memset(_dirtyLast, 0, sizeof(_dirtyLast));
+	
+	memset(_back, 0, _stride * _height);
+	invalidate();
+}
+
+void ParallelFramebuffer::setController(uint32_t commandOffset, uint32_t dataOffset,
+                                        uint8_t cursorCommand, uint8_t writeCommand)
+{
+	_commandOffset = commandOffset;
+	_dataOffset = dataOffset;
+	_cursorCommand = cursorCommand;
+	_writeCommand = writeCommand;
+}
+
+void ParallelFramebuffer::clear(uint8_t value)
+{
+	memset(_back, value, _stride * _height);
+	markAllDirty();
+}
+
+void ParallelFramebuffer::setPixel(uint16_t x, uint16_t y, bool on)
+{
+	if ((x >= _width) || (y >= _height))
+		return;
+	
+	// MSB is the leftmost pixel
+	uint8_t *p = &_back[y * _stride + (x >> 3)];
+	uint8_t mask = 0x80 >> (x & 7);
+	
+	if (on)
+		*p |= mask;
+	else
+		*p &= ~mask;
+	
+	markDirty(x, y, 1, 1);
+}
+
+void ParallelFramebuffer::fillRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, bool on)
+{
+	if ((x >= _width) || (y >= _height) || (w == 0) || (h == 0))
+		return;
+	if (x + w > _width)
+		w = _width - x;
+	if (y + h > _height)
+		h = _height - y;
+	
+	uint16_t firstByte = x >> 3;
+	uint16_t lastByte = (x + w - 1) >> 3;
+	uint8_t firstMask = 0xFF >> (x & 7);
+	uint8_t lastMask = 0xFF << (7 - ((x + w - 1) & 7));
+	
+	if (firstByte == lastByte)
+		firstMask &= lastMask;
+	
+	for (uint16_t row = y; row < y + h; row++)
+	{
+		uint8_t *p = &_back[row * _stride];
+		
+		if (on)
+			p[firstByte] |= firstMask;
+		else
+			p[firstByte] &= ~firstMask;
+		
+		if (lastByte > firstByte)
+		{
+			if (lastByte > firstByte + 1)
+				memset(&p[firstByte + 1], on ? 0xFF : 0x00, lastByte - firstByte - 1);
+			
+			if (on)
+				p[lastByte] |= lastMask;
+			else
+				p[lastByte] &= ~lastMask;
+		}
+	}
+	
+	markDirty(x, y, w, h);
+}
+
+void ParallelFramebuffer::markDirty(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+	if ((x >= _width) || (y >= _height) || (w == 0) || (h == 0))
+		return;
+	if (x + w > _width)
+		w = _width - x;
+	if (y + h > _height)
+		h = _height - y;
+	
+	uint8_t first = x >> 3;
+	uint8_t last = (x + w - 1) >> 3;
+	
+	for (uint16_t row = y; row < y + h; row++)
+	{
+		if (_dirtyFirst[row] > _dirtyLast[row])
+		{
+			_dirtyFirst[row] = first;
+			_dirtyLast[row] = last;
+			continue;
+		}
+		
+		if (first < _dirtyFirst[row])
+			_dirtyFirst[row] = first;
+		if (last > _dirtyLast[row])
+			_dirtyLast[row] = last;
+	}
+}
+
+void ParallelFramebuffer::markAllDirty(void)
+{
+	markDirty(0, 0, _width, _height);
+}
+
+void ParallelFramebuffer::invalidate(void)
+{
+	// make sure every byte compares as changed on the next flush
+	for (uint32_t i=0; i < (uint32_t)_stride * _height; i++)
+	{
+		_front[i] = ~_back[i];
+	}
+	markAllDirty();
+}
+
+// Sends bytes [start, end] of the layer, taken from the front buffer
+void ParallelFramebuffer::sendRun(uint32_t start, uint32_t end)
+{
+	uint16_t address = _layer + start;
+	
+	_bus.write(_commandOffset, _cursorCommand);
+	_bus.write(_dataOffset, address & 0xFF);
+	_bus.write(_dataOffset, address >> 8);
+	_bus.write(_commandOffset, _writeCommand);
+	_bus.writeBlock(_dataOffset, &_front[start], end - start + 1);
+}
+
+uint32_t ParallelFramebuffer::flush(void)
+{
+	uint32_t bytes = 0;
+	bool inRun = false;
+	uint32_t runStart = 0;
+	uint32_t runEnd = 0;
+	
+	for (uint16_t row = 0; row < _height; row++)
+	{
+		if (_dirtyFirst[row] > _dirtyLast[row])
+			continue;
+		
+		uint32_t base = (uint32_t)row * _stride;
+		uint32_t first = base + _dirtyFirst[row];
+		uint32_t last = base + _dirtyLast[row];
+		
+		_dirtyFirst[row] = 0xFF;
+		_dirtyLast[row] = 0;
+		
+		// trim bytes that didn't actually change
+		while ((first <= last) && (_back[first] == _front[first]))
+			first++;
+		while ((last > first) && (_back[last] == _front[last]))
+			last--;
+		
+		if (first > last)
+			continue;
+		
+		memcpy(&_front[first], &_back[first], last - first + 1);
+		
+		// Display memory is linear, so the end of one row runs straight into
+		// the next.  Join spans when the gap is cheaper to send than a new 
+		// cursor set.  Gap bytes are copied too so the front buffer stays 
+		// an exact image of the panel.
+		if (inRun && (first - runEnd - 1 <= PARALLEL_FB_RUN_OVERHEAD))
+		{
+			memcpy(&_front[runEnd + 1], &_back[runEnd + 1], first - runEnd - 1);
+			runEnd = last;
+			continue;
+		}
+		
+		if (inRun)
+		{
+			sendRun(runStart, runEnd);
+			bytes += PARALLEL_FB_RUN_OVERHEAD + runEnd - runStart + 1;
+		}
+		
+		inRun = true;
+		runStart = first;
+		runEnd = last;
+	}
+	
+	if (inRun)
+	{
+		sendRun(runStart, runEnd);
+		bytes += PARALLEL_FB_RUN_OVERHEAD + runEnd - runStart + 1;
+	}
+	
+	return bytes;
+}
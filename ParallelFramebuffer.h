@@ -0,0 +1,101 @@
+/*
+  ParallelFramebuffer.h
+
+  Double buffered 1bpp framebuffer for index addressed LCD controllers such 
+  as the EPSON S1D13700.  The application draws into a back buffer in SRAM
+  while a front buffer mirrors what the panel currently shows.  Drawing marks
+  rows dirty; flush() compares the dirty spans against the front buffer,
+  coalesces them and streams only the changed bytes to the controller, each 
+  run preceded by a cursor set (CSRW) and memory write (MWRITE) command.
+
+  Both buffers are supplied by the sketch and must be (width/8)*height bytes.
+  Widths above PARALLEL_FB_MAX_WIDTH and heights above PARALLEL_FB_MAX_HEIGHT
+  are clamped to them.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PARALLEL_FRAMEBUFFER_H
+#define PARALLEL_FRAMEBUFFER_H
+
+#include "Parallel.h"
+
+// Largest number of rows tracked for dirty spans
+#ifndef PARALLEL_FB_MAX_HEIGHT
+#define PARALLEL_FB_MAX_HEIGHT	240
+#endif
+
+// Dirty spans are kept as byte columns in a uint8_t, so rows are at most
+// 255 bytes
+#define PARALLEL_FB_MAX_WIDTH	2040
+
+// Bytes of command overhead for starting a new run (CSRW + 2 address bytes 
+// + MWRITE).  Gaps shorter than this are sent rather than skipped.
+#define PARALLEL_FB_RUN_OVERHEAD	4
+
+class ParallelFramebuffer {
+public:
+  ParallelFramebuffer(ParallelClass &bus, uint16_t width, uint16_t height,
+                      uint8_t *back, uint8_t *front);
+  
+  // Controller specifics.  Defaults match the S1D13700 (A0 high selects the
+  // command register, CSRW = 0x46, MWRITE = 0x42).
+  void setController(uint32_t commandOffset, uint32_t dataOffset,
+                     uint8_t cursorCommand, uint8_t writeCommand);
+  
+  // Display memory address of the layer this buffer is shown on
+  void setLayerAddress(uint16_t address) { _layer = address; }
+  
+  // Back buffer for drawing directly.  Call markDirty() for changed areas.
+  uint8_t *buffer() { return _back; }
+  uint16_t stride() { return _stride; }
+  uint16_t width() { return _width; }
+  uint16_t height() { return _height; }
+  
+  void clear(uint8_t value = 0x00);
+  void setPixel(uint16_t x, uint16_t y, bool on);
+  void fillRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, bool on);
+  
+  void markDirty(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+  void markAllDirty();
+  
+  // Forces the next flush to resend everything, e.g. after a panel reset
+  void invalidate();
+  
+  // Sends the changed areas to the controller.  Returns the number of bytes
+  // put on the bus (commands included).
+  uint32_t flush();
+
+private:
+  void sendRun(uint32_t start, uint32_t end);
+
+  ParallelClass &_bus;
+  uint8_t *_back;
+  uint8_t *_front;
+  uint16_t _width;
+  uint16_t _height;
+  uint16_t _stride;
+  uint16_t _layer;
+  uint32_t _commandOffset;
+  uint32_t _dataOffset;
+  uint8_t _cursorCommand;
+  uint8_t _writeCommand;
+  
+  // first/last dirty byte column per row, first > last when the row is clean
+  uint8_t _dirtyFirst[PARALLEL_FB_MAX_HEIGHT];
+  uint8_t _dirtyLast[PARALLEL_FB_MAX_HEIGHT];
+};
+
+#endif
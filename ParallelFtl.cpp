@@ -0,0 +1,800 @@
+/*
+  ParallelFtl.cpp
+
+  Log-structured flash translation layer.  See ParallelFtl.h for usage.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ParallelFtl.h"
+
+#define NO_BLOCK			0xFFFF
+#define UNMAPPED			0xFFFF
+
+#define TYPE_DATA			'D'
+#define TYPE_CHECKPOINT		'C'
+#define CHECKPOINT_MAGIC	0x4C54464EUL
+
+// Record layout in the spare bytes: type, page (2), seq (4), erases (4) and
+// a check byte, little endian.  An erased spare area fails the check.  The
+// spare area has no ECC, so the record is stored twice.
+#define RECORD_SIZE			12
+#define MAX_SPARE_BYTES		128
+
+ParallelFtl::ParallelFtl(ParallelNand &nand)
+	: _nand(nand), _first(0), _count(0), _pagesPerBlock(0), _pageSize(0),
+	  _capacity(0), _seq(0), _active(NO_BLOCK), _next(0), _victim(NO_BLOCK),
+	  _victimPage(0), _checkpointNext(0), _sinceCheckpoint(0), _freeCount(0),
+	  _hostWrites(0), _flashWrites(0), _eraseTotal(0), _wearCheck(0)
+{
+	_checkpoint[0] = NO_BLOCK;
+	_checkpoint[1] = NO_BLOCK;
+}
+
+bool ParallelFtl::setup(uint16_t first, uint16_t count)
+{
+	uint16_t good = 0;
+
+	_pagesPerBlock = _nand.pagesPerBlock();
+	_pageSize = _nand.pageSize();
+
+	if ((count > PARALLEL_FTL_MAX_BLOCKS) || (first + count > _nand.blocks())
+		|| (_pageSize > PARALLEL_FTL_MAX_PAGE_SIZE)
+		|| ((uint32_t)count * _pagesPerBlock >= UNMAPPED)
+		|| (_nand.spareBytes() < 2 * RECORD_SIZE))
+		return false;
+
+	_first = first;
+	_count = count;
+	_capacity = 0;
+	_seq = 1;
+	_active = NO_BLOCK;
+	_victim = NO_BLOCK;
+	_checkpoint[0] = NO_BLOCK;
+	_checkpoint[1] = NO_BLOCK;
+	_checkpointNext = 0;
+	_sinceCheckpoint = 0;
+	_freeCount = 0;
+	_hostWrites = 0;
+	_flashWrites = 0;
+	_eraseTotal = 0;
+	_wearCheck = 0;
+	memset(_map, 0xFF, sizeof(_map));
+
+	for (uint16_t b = 0; b < _count; b++)
+	{
+		_live[b] = 0;
+		_erases[b] = 0;
+
+		if (_nand.isBad(_first + b))
+		{
+			_state[b] = BLOCK_BAD;
+		}
+		else
+		{
+			_state[b] = BLOCK_FREE;
+			good++;
+		}
+	}
+
+	return good > 2 + PARALLEL_FTL_RESERVE_BLOCKS;
+}
+
+bool ParallelFtl::format(uint16_t first, uint16_t count)
+{
+	uint16_t good = 0;
+
+	if (!setup(first, count))
+		return false;
+
+	for (uint16_t b = 0; b < _count; b++)
+	{
+		if ((_state[b] == BLOCK_FREE) && eraseBlock(b))
+		{
+			if (_checkpoint[0] == NO_BLOCK)
+				_checkpoint[0] = b;
+			else if (_checkpoint[1] == NO_BLOCK)
+				_checkpoint[1] = b;
+			else
+				_freeCount++;
+
+			good++;
+		}
+	}
+
+	if (good <= 2 + PARALLEL_FTL_RESERVE_BLOCKS)
+		return false;
+
+	_state[_checkpoint[0]] = BLOCK_CHECKPOINT;
+	_state[_checkpoint[1]] = BLOCK_CHECKPOINT;
+
+	_capacity = (uint32_t)(good - 2 - PARALLEL_FTL_RESERVE_BLOCKS) * _pagesPerBlock;
+	if (_capacity > PARALLEL_FTL_MAX_PAGES)
+		_capacity = PARALLEL_FTL_MAX_PAGES;
+
+	// the whole checkpoint has to fit in half a block
+	while (checkpointBytes() > (uint32_t)_pageSize * (_pagesPerBlock / 2))
+		_capacity -= _pagesPerBlock;
+
+	return checkpoint();
+}
+
+// The last complete checkpoint gives the map as it was then.  The block
+// that was being filled and those started since are replayed oldest first
+// (each block is filled before the next is started, so their first sequence
+// numbers order them), and the newest copy of each page wins.
+bool ParallelFtl::begin(uint16_t first, uint16_t count)
+{
+	uint32_t firstSeq[PARALLEL_FTL_MAX_BLOCKS];
+	uint32_t checkpointSeq = 0;
+	uint16_t checkpointBlock = NO_BLOCK;
+	uint16_t checkpointStart = 0;
+
+	if (!setup(first, count))
+		return false;
+
+	for (uint16_t b = 0; b < _count; b++)
+	{
+		Record_t r;
+
+		if ((_state[b] == BLOCK_BAD) || !readRecord(b, 0, r))
+			continue;
+
+		if (r.type == TYPE_DATA)
+		{
+			_state[b] = BLOCK_DATA;
+			continue;
+		}
+
+		// Look for complete checkpoints: a header page and the rest of its
+		// pages, all with the same sequence number
+		_state[b] = BLOCK_CHECKPOINT;
+
+		uint16_t p = 0;
+
+		while (p < _pagesPerBlock)
+		{
+			uint16_t n = 1;
+
+			if (!readRecord(b, p, r) || (r.type != TYPE_CHECKPOINT))
+				break;
+
+			if ((r.page == 0) && (r.seq > checkpointSeq)
+				&& (_nand.readPage(nandPage(b, p), _buffer) <= PARALLEL_NAND_CORRECTED))
+			{
+				Header_t header;
+
+				memcpy(&header, _buffer, sizeof(header));
+
+				if ((header.magic == CHECKPOINT_MAGIC) && (header.first == _first)
+					&& (header.count == _count) && (header.capacity <= PARALLEL_FTL_MAX_PAGES)
+					&& (header.pages > 0) && (p + header.pages <= _pagesPerBlock))
+				{
+					Record_t last;
+
+					n = header.pages;
+
+					if (readRecord(b, p + n - 1, last) && (last.type == TYPE_CHECKPOINT)
+						&& (last.seq == r.seq) && (last.page == n - 1))
+					{
+						checkpointSeq = r.seq;
+						checkpointBlock = b;
+						checkpointStart = p;
+					}
+				}
+			}
+
+			p += n;
+		}
+	}
+
+	if ((checkpointBlock == NO_BLOCK)
+		|| !loadCheckpoint(checkpointBlock, checkpointStart))
+		return false;
+
+	// Anything after the checkpoint may be a torn one, so the next goes in
+	// the other block
+	_checkpoint[0] = checkpointBlock;
+	_checkpointNext = _pagesPerBlock;
+	_seq = checkpointSeq + 1;
+
+	// Other checkpoint blocks are free, except one kept as the next one
+	for (uint16_t b = 0; b < _count; b++)
+	{
+		if ((_state[b] == BLOCK_CHECKPOINT) && (b != checkpointBlock))
+		{
+			if (_checkpoint[1] == NO_BLOCK)
+				_checkpoint[1] = b;
+			else
+				_state[b] = BLOCK_FREE;
+		}
+	}
+
+	for (uint16_t b = 0; b < _count; b++)
+	{
+		Record_t r;
+
+		firstSeq[b] = 0;
+
+		if ((_state[b] == BLOCK_DATA) && readRecord(b, 0, r)
+			&& ((r.seq > checkpointSeq) || (b == _header.active)))
+		{
+			firstSeq[b] = r.seq;
+
+			// erased since the checkpoint
+			if (r.erases > _erases[b])
+				_erases[b] = r.erases;
+		}
+
+		if (_state[b] == BLOCK_FREE)
+			_freeCount++;
+	}
+
+	if (_checkpoint[1] == NO_BLOCK)
+	{
+		_checkpoint[1] = leastWorn();
+
+		if (_checkpoint[1] == NO_BLOCK)
+			return false;
+
+		_state[_checkpoint[1]] = BLOCK_CHECKPOINT;
+		_freeCount--;
+	}
+
+	replay(firstSeq, checkpointSeq);
+
+	for (uint32_t page = 0; page < _capacity; page++)
+	{
+		if (_map[page] == UNMAPPED)
+			continue;
+
+		if (_map[page] / _pagesPerBlock < _count)
+			_live[_map[page] / _pagesPerBlock]++;
+		else
+			_map[page] = UNMAPPED;
+	}
+
+	// Blocks with nothing live left can be reused straight away
+	for (uint16_t b = 0; b < _count; b++)
+	{
+		if ((_state[b] == BLOCK_DATA) && (_live[b] == 0))
+			release(b);
+	}
+
+	return true;
+}
+
+void ParallelFtl::replay(uint32_t *firstSeq, uint32_t checkpointSeq)
+{
+	uint32_t after = 0;
+	uint32_t lastPage = UNMAPPED;
+	uint16_t lastPrevious = UNMAPPED;
+	uint16_t lastBlock = NO_BLOCK;
+	uint16_t lastIndex = 0;
+
+	for (;;)
+	{
+		uint16_t next = NO_BLOCK;
+
+		for (uint16_t b = 0; b < _count; b++)
+		{
+			if ((firstSeq[b] > after) && ((next == NO_BLOCK) || (firstSeq[b] < firstSeq[next])))
+				next = b;
+		}
+
+		if (next == NO_BLOCK)
+			break;
+
+		after = firstSeq[next];
+
+		for (uint16_t p = 0; p < _pagesPerBlock; p++)
+		{
+			Record_t r;
+
+			if (!readRecord(next, p, r) || (r.type != TYPE_DATA) || (r.page >= _capacity)
+				|| (r.seq <= checkpointSeq))
+				continue;
+
+			lastPage = r.page;
+			lastPrevious = _map[r.page];
+			lastBlock = next;
+			lastIndex = p;
+
+			_map[r.page] = next * _pagesPerBlock + p;
+
+			if (r.seq >= _seq)
+				_seq = r.seq + 1;
+		}
+	}
+
+	// Only the last page written can have been cut short by a power loss.
+	// If it doesn't read back the previous copy stands.
+	if ((lastBlock != NO_BLOCK)
+		&& (_nand.readPage(nandPage(lastBlock, lastIndex), _buffer) > PARALLEL_NAND_CORRECTED))
+		_map[lastPage] = lastPrevious;
+}
+
+bool ParallelFtl::readRecord(uint16_t block, uint16_t page, Record_t &record)
+{
+	uint8_t buffer[MAX_SPARE_BYTES];
+	uint8_t *spare = NULL;
+
+	if (_nand.readSpare(nandPage(block, page), buffer) != PARALLEL_NAND_OK)
+		return false;
+
+	for (uint8_t copy = 0; (copy < 2) && (spare == NULL); copy++)
+	{
+		uint8_t *p = buffer + copy * RECORD_SIZE;
+		uint8_t check = 0xFF;
+
+		for (uint8_t i = 0; i < RECORD_SIZE - 1; i++)
+			check ^= p[i];
+
+		if (check == p[RECORD_SIZE - 1])
+			spare = p;
+	}
+
+	if (spare == NULL)
+		return false;
+
+	record.type = spare[0];
+	record.page = spare[1] | ((uint16_t)spare[2] << 8);
+	record.seq = spare[3] | ((uint32_t)spare[4] << 8)
+		| ((uint32_t)spare[5] << 16) | ((uint32_t)spare[6] << 24);
+	record.erases = spare[7] | ((uint32_t)spare[8] << 8)
+		| ((uint32_t)spare[9] << 16) | ((uint32_t)spare[10] << 24);
+
+	return (record.type == TYPE_DATA) || (record.type == TYPE_CHECKPOINT);
+}
+
+ParallelNandStatus_t ParallelFtl::programPage(uint16_t block, uint16_t page,
+                                              const Record_t &record, const uint8_t *data)
+{
+	uint8_t spare[MAX_SPARE_BYTES];
+	uint8_t check = 0xFF;
+
+	memset(spare, 0xFF, sizeof(spare));
+	spare[0] = record.type;
+	spare[1] = (uint8_t)record.page;
+	spare[2] = (uint8_t)(record.page >> 8);
+
+	for (uint8_t i = 0; i < 4; i++)
+	{
+		spare[3 + i] = (uint8_t)(record.seq >> (8 * i));
+		spare[7 + i] = (uint8_t)(record.erases >> (8 * i));
+	}
+
+	for (uint8_t i = 0; i < RECORD_SIZE - 1; i++)
+		check ^= spare[i];
+	spare[RECORD_SIZE - 1] = check;
+	memcpy(spare + RECORD_SIZE, spare, RECORD_SIZE);
+
+	_flashWrites++;
+	return _nand.writePage(nandPage(block, page), data, spare);
+}
+
+// Appends to the active block, moving on to a new one when it is full or
+// when a program fails.  A block that fails keeps its live pages until
+// garbage collection moves them.
+ParallelNandStatus_t ParallelFtl::program(uint16_t page, const uint8_t *data)
+{
+	for (;;)
+	{
+		if ((_active != NO_BLOCK) && (_next == _pagesPerBlock))
+		{
+			_state[_active] = BLOCK_DATA;
+			_active = NO_BLOCK;
+		}
+
+		if ((_active == NO_BLOCK) && !allocate())
+			return PARALLEL_NAND_FAIL;
+
+		Record_t r = { TYPE_DATA, page, _seq, _erases[_active] };
+		ParallelNandStatus_t status = programPage(_active, _next, r, data);
+
+		if (status == PARALLEL_NAND_OK)
+		{
+			uint16_t old = _map[page];
+
+			if (old != UNMAPPED)
+				_live[old / _pagesPerBlock]--;
+
+			_map[page] = _active * _pagesPerBlock + _next;
+			_live[_active]++;
+			_next++;
+			_seq++;
+			return PARALLEL_NAND_OK;
+		}
+
+		if (status != PARALLEL_NAND_FAIL)
+			return status;
+
+		_state[_active] = BLOCK_RETIRED;
+		_active = NO_BLOCK;
+	}
+}
+
+uint16_t ParallelFtl::leastWorn()
+{
+	uint16_t best = NO_BLOCK;
+
+	for (uint16_t b = 0; b < _count; b++)
+	{
+		if ((_state[b] == BLOCK_FREE) && ((best == NO_BLOCK) || (_erases[b] < _erases[best])))
+			best = b;
+	}
+
+	return best;
+}
+
+bool ParallelFtl::allocate()
+{
+	for (;;)
+	{
+		uint16_t b = leastWorn();
+
+		if (b == NO_BLOCK)
+			return false;
+
+		_freeCount--;
+
+		if (eraseBlock(b))
+		{
+			_state[b] = BLOCK_ACTIVE;
+			_live[b] = 0;
+			_active = b;
+			_next = 0;
+			return true;
+		}
+	}
+}
+
+bool ParallelFtl::eraseBlock(uint16_t block)
+{
+	_erases[block]++;
+	_eraseTotal++;
+
+	if (_nand.eraseBlock(_first + block) != PARALLEL_NAND_OK)
+	{
+		_state[block] = BLOCK_BAD;
+		return false;
+	}
+
+	return true;
+}
+
+// Freed blocks are erased when they are next used
+void ParallelFtl::release(uint16_t block)
+{
+	_live[block] = 0;
+
+	if (_state[block] == BLOCK_RETIRED)
+	{
+		_state[block] = BLOCK_BAD;
+	}
+	else
+	{
+		_state[block] = BLOCK_FREE;
+		_freeCount++;
+	}
+}
+
+uint16_t ParallelFtl::pickVictim(bool background)
+{
+	uint16_t best = NO_BLOCK;
+	uint16_t coldest = NO_BLOCK;
+
+	for (uint16_t b = 0; b < _count; b++)
+	{
+		if (_state[b] == BLOCK_RETIRED)
+			return b;
+
+		if (_state[b] != BLOCK_DATA)
+			continue;
+
+		if ((best == NO_BLOCK) || (_live[b] < _live[best]))
+			best = b;
+
+		if ((coldest == NO_BLOCK) || (_erases[b] < _erases[coldest]))
+			coldest = b;
+	}
+
+	// Static wear leveling, at most once per round of erases over the range
+	if ((coldest != NO_BLOCK) && (_eraseTotal >= _wearCheck)
+		&& (_erases[coldest] + PARALLEL_FTL_WEAR_LIMIT < maxErases()))
+	{
+		_wearCheck = _eraseTotal + _count;
+		return coldest;
+	}
+
+	if (background && (_freeCount >= PARALLEL_FTL_GC_TARGET))
+		return NO_BLOCK;
+
+	// nothing to gain from a full block
+	if ((best != NO_BLOCK) && (_live[best] >= _pagesPerBlock))
+		return NO_BLOCK;
+
+	return best;
+}
+
+// Moves up to maxPages live pages off the victim, releasing it once
+// they are all gone.  Returns false if nothing could be moved.
+bool ParallelFtl::moveLive(uint16_t maxPages)
+{
+	uint16_t moved = 0;
+
+	while ((_victimPage < _pagesPerBlock) && (_live[_victim] > 0) && (moved < maxPages))
+	{
+		uint16_t p = _victimPage++;
+		Record_t r;
+
+		if (!readRecord(_victim, p, r) || (r.type != TYPE_DATA) || (r.page >= _capacity)
+			|| (_map[r.page] != _victim * _pagesPerBlock + p))
+			continue;
+
+		// Pages the ECC can't fix are moved as they are
+		_nand.readPage(nandPage(_victim, p), _buffer);
+
+		if (program(r.page, _buffer) != PARALLEL_NAND_OK)
+			return false;
+
+		moved++;
+	}
+
+	if ((_victimPage == _pagesPerBlock) || (_live[_victim] == 0))
+	{
+		release(_victim);
+		_victim = NO_BLOCK;
+	}
+
+	return true;
+}
+
+bool ParallelFtl::collect(uint16_t maxPages)
+{
+	if (_capacity == 0)
+		return false;
+
+	if (_victim == NO_BLOCK)
+	{
+		if (_sinceCheckpoint >= PARALLEL_FTL_CHECKPOINT_PAGES)
+			return checkpoint();
+
+		_victim = pickVictim(true);
+		_victimPage = 0;
+
+		if (_victim == NO_BLOCK)
+			return false;
+	}
+
+	return moveLive(maxPages);
+}
+
+ParallelNandStatus_t ParallelFtl::read(uint32_t page, uint8_t *data)
+{
+	if (page >= _capacity)
+		return PARALLEL_NAND_FAIL;
+
+	if (_map[page] == UNMAPPED)
+	{
+		memset(data, 0xFF, _pageSize);
+		return PARALLEL_NAND_OK;
+	}
+
+	return _nand.readPage(nandPage(_map[page] / _pagesPerBlock, _map[page] % _pagesPerBlock),
+		data);
+}
+
+// Collects in the foreground only when free blocks run out, a block's
+// worth of pages at a time
+ParallelNandStatus_t ParallelFtl::write(uint32_t page, const uint8_t *data)
+{
+	if (page >= _capacity)
+		return PARALLEL_NAND_FAIL;
+
+	while (_freeCount <= PARALLEL_FTL_GC_BLOCKS)
+	{
+		if (_victim == NO_BLOCK)
+		{
+			_victim = pickVictim(false);
+			_victimPage = 0;
+
+			if (_victim == NO_BLOCK)
+				break;
+		}
+
+		if (!moveLive(_pagesPerBlock))
+			break;
+	}
+
+	ParallelNandStatus_t status = program(page, data);
+
+	if (status == PARALLEL_NAND_OK)
+	{
+		_hostWrites++;
+		_sinceCheckpoint++;
+	}
+
+	return status;
+}
+
+uint32_t ParallelFtl::checkpointBytes()
+{
+	return sizeof(Header_t) + _capacity * sizeof(_map[0]) + _count * sizeof(_erases[0]);
+}
+
+// The checkpoint is the header, the map and the erase counts back to back.
+// Copies bytes offset .. offset + n - 1 of it to or from page.
+void ParallelFtl::checkpointData(uint32_t offset, uint8_t *page, uint32_t n, bool save)
+{
+	uint32_t base = 0;
+
+	for (uint8_t part = 0; part < 3; part++)
+	{
+		uint8_t *p;
+		uint32_t size;
+
+		switch (part)
+		{
+		case 0:
+			p = (uint8_t *)&_header;
+			size = sizeof(_header);
+			break;
+		case 1:
+			p = (uint8_t *)_map;
+			size = _capacity * sizeof(_map[0]);
+			break;
+		default:
+			p = (uint8_t *)_erases;
+			size = _count * sizeof(_erases[0]);
+			break;
+		}
+
+		uint32_t from = (offset > base) ? offset : base;
+		uint32_t to = (offset + n < base + size) ? offset + n : base + size;
+
+		if (from < to)
+		{
+			if (save)
+				memcpy(page + from - offset, p + from - base, to - from);
+			else
+				memcpy(p + from - base, page + from - offset, to - from);
+		}
+
+		// the map's size comes from the header
+		if ((part == 0) && !save && (offset + n >= sizeof(_header)))
+			_capacity = _header.capacity;
+
+		base += size;
+	}
+}
+
+bool ParallelFtl::loadCheckpoint(uint16_t block, uint16_t start)
+{
+	uint16_t pages = 1;
+
+	for (uint16_t i = 0; i < pages; i++)
+	{
+		if (_nand.readPage(nandPage(block, start + i), _buffer) > PARALLEL_NAND_CORRECTED)
+			return false;
+
+		checkpointData((uint32_t)i * _pageSize, _buffer, _pageSize, false);
+
+		if (i == 0)
+			pages = _header.pages;
+	}
+
+	return true;
+}
+
+bool ParallelFtl::checkpoint()
+{
+	uint16_t pages = (checkpointBytes() + _pageSize - 1) / _pageSize;
+
+	if ((_checkpoint[0] == NO_BLOCK) || (pages > _pagesPerBlock))
+		return false;
+
+	_header.magic = CHECKPOINT_MAGIC;
+	_header.capacity = _capacity;
+	_header.first = _first;
+	_header.count = _count;
+	_header.pages = pages;
+	_header.active = _active;
+
+	for (;;)
+	{
+		// Switch blocks when this one is full, leaving the last checkpoint
+		// in place until the new one is complete
+		if (_checkpointNext + pages > _pagesPerBlock)
+		{
+			while (!eraseBlock(_checkpoint[1]))
+			{
+				_checkpoint[1] = leastWorn();
+
+				if (_checkpoint[1] == NO_BLOCK)
+					return false;
+
+				_state[_checkpoint[1]] = BLOCK_CHECKPOINT;
+				_freeCount--;
+			}
+
+			uint16_t b = _checkpoint[0];
+
+			_checkpoint[0] = _checkpoint[1];
+			_checkpoint[1] = b;
+			_checkpointNext = 0;
+		}
+
+		Record_t r = { TYPE_CHECKPOINT, 0, _seq, _erases[_checkpoint[0]] };
+		ParallelNandStatus_t status = PARALLEL_NAND_OK;
+
+		for (uint16_t i = 0; (i < pages) && (status == PARALLEL_NAND_OK); i++)
+		{
+			memset(_buffer, 0xFF, _pageSize);
+			checkpointData((uint32_t)i * _pageSize, _buffer, _pageSize, true);
+			r.page = i;
+			status = programPage(_checkpoint[0], _checkpointNext++, r, _buffer);
+		}
+
+		if (status == PARALLEL_NAND_OK)
+			break;
+
+		if (status != PARALLEL_NAND_FAIL)
+			return false;
+
+		// The block went bad: start again in a free block, keeping the other
+		// one with the last checkpoint
+		_state[_checkpoint[0]] = BLOCK_BAD;
+		_checkpoint[0] = _checkpoint[1];
+		_checkpoint[1] = leastWorn();
+
+		if (_checkpoint[1] == NO_BLOCK)
+			return false;
+
+		_state[_checkpoint[1]] = BLOCK_CHECKPOINT;
+		_freeCount--;
+		_checkpointNext = _pagesPerBlock;
+	}
+
+	_seq++;
+	_sinceCheckpoint = 0;
+	return true;
+}
+
+uint32_t ParallelFtl::minErases()
+{
+	uint32_t n = 0xFFFFFFFF;
+
+	for (uint16_t b = 0; b < _count; b++)
+	{
+		if ((_state[b] != BLOCK_BAD) && (_erases[b] < n))
+			n = _erases[b];
+	}
+
+	return n;
+}
+
+uint32_t ParallelFtl::maxErases()
+{
+	uint32_t n = 0;
+
+	for (uint16_t b = 0; b < _count; b++)
+	{
+		if ((_state[b] != BLOCK_BAD) && (_erases[b] > n))
+			n = _erases[b];
+	}
+
+	return n;
+}
@@ -0,0 +1,210 @@
+/*
+  ParallelFtl.h
+
+  Flash translation layer for ParallelNand: logical pages that can be
+  rewritten in any order, on top of NAND blocks that can only be erased
+  whole.  Writes are appended to a log (one active block at a time) and an
+  SRAM map gives the current copy of each logical page, so a random small
+  write costs one page program instead of a block erase and rewrite.
+
+    ParallelFtl ftl(nand);
+
+    if (!ftl.begin(16, 240))
+      ftl.format(16, 240);
+
+    ftl.write(42, page);
+    ...
+    ftl.collect();		// from loop()
+
+  Old copies are reclaimed by garbage collection: a victim block's live
+  pages are moved to the log and the block is freed.  collect() does a few
+  pages of that at a time, so a logger calling it between samples keeps a
+  supply of free blocks and write() only collects itself (at most one
+  block's worth of pages) when the supply runs out.  The victim is the
+  block with the fewest live pages, except when the erase counts drift more
+  than PARALLEL_FTL_WEAR_LIMIT apart, when the least worn block's (cold)
+  data is moved so the block goes back into use.  Free blocks are taken
+  least worn first.
+
+  Every page's spare area records its logical page and a sequence number.
+  The map and erase counts are checkpointed to two blocks that take turns,
+  every PARALLEL_FTL_CHECKPOINT_PAGES writes (from collect()) or on
+  checkpoint().  begin() loads the last complete checkpoint and replays the
+  pages written since, so a power loss costs at most the write in progress.
+
+  The blocks given to the FTL must not be used through ParallelNand
+  directly.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PARALLEL_FTL_H
+#define PARALLEL_FTL_H
+
+#include "ParallelNand.h"
+
+// Logical pages (2 bytes of SRAM each) and blocks (7 bytes each) covered
+#ifndef PARALLEL_FTL_MAX_PAGES
+#define PARALLEL_FTL_MAX_PAGES		8192
+#endif
+
+#ifndef PARALLEL_FTL_MAX_BLOCKS
+#define PARALLEL_FTL_MAX_BLOCKS		256
+#endif
+
+// Largest NAND page, for the buffer used to move pages
+#ifndef PARALLEL_FTL_MAX_PAGE_SIZE
+#define PARALLEL_FTL_MAX_PAGE_SIZE	2048
+#endif
+
+// Blocks held back from the capacity, for garbage collection headroom and
+// blocks that go bad later
+#ifndef PARALLEL_FTL_RESERVE_BLOCKS
+#define PARALLEL_FTL_RESERVE_BLOCKS	6
+#endif
+
+// collect() works while there are fewer free blocks than the target,
+// write() only once there are PARALLEL_FTL_GC_BLOCKS or fewer
+#ifndef PARALLEL_FTL_GC_TARGET
+#define PARALLEL_FTL_GC_TARGET		4
+#endif
+
+#ifndef PARALLEL_FTL_GC_BLOCKS
+#define PARALLEL_FTL_GC_BLOCKS		2
+#endif
+
+// Erase count spread that has collect() move cold data
+#ifndef PARALLEL_FTL_WEAR_LIMIT
+#define PARALLEL_FTL_WEAR_LIMIT		32
+#endif
+
+// Pages written between automatic checkpoints
+#ifndef PARALLEL_FTL_CHECKPOINT_PAGES
+#define PARALLEL_FTL_CHECKPOINT_PAGES	1024
+#endif
+
+class ParallelFtl {
+public:
+  ParallelFtl(ParallelNand &nand);
+
+  // Mounts blocks first .. first + count - 1, which must have been
+  // formatted with the same range.  Returns false if no checkpoint is found.
+  bool begin(uint16_t first, uint16_t count);
+
+  // Erases the range and starts with every logical page unwritten
+  bool format(uint16_t first, uint16_t count);
+
+  // Unwritten pages read as 0xFF.  Both take a whole NAND page.
+  ParallelNandStatus_t read(uint32_t page, uint8_t *data);
+  ParallelNandStatus_t write(uint32_t page, const uint8_t *data);
+
+  // Background work: moves up to maxPages pages for garbage collection or
+  // wear leveling, or writes a checkpoint when one is due.  Returns true
+  // while there is more to do.
+  bool collect(uint16_t maxPages = 4);
+  bool checkpoint();
+
+  // Logical pages
+  uint32_t capacity() { return _capacity; }
+  uint16_t freeBlocks() { return _freeCount; }
+
+  // Pages written by the caller and programmed on the flash (including
+  // garbage collection and checkpoints); their ratio is the write
+  // amplification
+  uint32_t hostWrites() { return _hostWrites; }
+  uint32_t flashWrites() { return _flashWrites; }
+  uint32_t erases() { return _eraseTotal; }
+  uint32_t minErases();
+  uint32_t maxErases();
+
+private:
+  typedef enum
+  {
+    BLOCK_FREE,
+    BLOCK_DATA,
+    BLOCK_ACTIVE,
+    BLOCK_CHECKPOINT,
+    BLOCK_RETIRED,		// program failed, live pages still to move
+    BLOCK_BAD
+  } BlockState_t;
+
+  // Spare area record, packed into the caller's spare bytes
+  typedef struct
+  {
+    uint8_t type;
+    uint16_t page;		// logical page, or index within a checkpoint
+    uint32_t seq;
+    uint32_t erases;	// of the block the page is in
+  } Record_t;
+
+  typedef struct
+  {
+    uint32_t magic;
+    uint32_t capacity;
+    uint16_t first;
+    uint16_t count;
+    uint16_t pages;		// pages in this checkpoint
+    uint16_t active;	// block being filled, with pages still to replay
+  } Header_t;
+
+  uint32_t nandPage(uint16_t block, uint16_t page)
+  {
+    return (uint32_t)(_first + block) * _pagesPerBlock + page;
+  }
+
+  bool setup(uint16_t first, uint16_t count);
+  bool readRecord(uint16_t block, uint16_t page, Record_t &record);
+  ParallelNandStatus_t programPage(uint16_t block, uint16_t page,
+                                   const Record_t &record, const uint8_t *data);
+  ParallelNandStatus_t program(uint16_t page, const uint8_t *data);
+  uint16_t leastWorn();
+  bool allocate();
+  bool eraseBlock(uint16_t block);
+  void release(uint16_t block);
+  uint16_t pickVictim(bool background);
+  bool moveLive(uint16_t maxPages);
+  uint32_t checkpointBytes();
+  void checkpointData(uint32_t offset, uint8_t *page, uint32_t n, bool save);
+  bool loadCheckpoint(uint16_t block, uint16_t start);
+  void replay(uint32_t *firstSeq, uint32_t checkpointSeq);
+
+  ParallelNand &_nand;
+  uint16_t _first;
+  uint16_t _count;
+  uint16_t _pagesPerBlock;
+  uint16_t _pageSize;
+  uint32_t _capacity;
+  uint32_t _seq;
+  uint16_t _active;
+  uint16_t _next;
+  uint16_t _victim;
+  uint16_t _victimPage;
+  uint16_t _checkpoint[2];	// current checkpoint block and the other one
+  uint16_t _checkpointNext;
+  uint32_t _sinceCheckpoint;
+  uint16_t _freeCount;
+  uint32_t _hostWrites;
+  uint32_t _flashWrites;
+  uint32_t _eraseTotal;
+  uint32_t _wearCheck;
+  Header_t _header;
+  uint8_t _state[PARALLEL_FTL_MAX_BLOCKS];
+  uint16_t _live[PARALLEL_FTL_MAX_BLOCKS];
+  uint32_t _erases[PARALLEL_FTL_MAX_BLOCKS];
+  uint16_t _map[PARALLEL_FTL_MAX_PAGES];
+  uint8_t _buffer[PARALLEL_FTL_MAX_PAGE_SIZE];
+};
+
+#endif
@@ -0,0 +1,130 @@
+/*
+  ParallelMemory.cpp
+
+  External SRAM region and allocators.  See ParallelMemory.h for usage.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ParallelMemory.h"
+
+ParallelMemory::ParallelMemory(ParallelClass &bus, uint32_t size, uint32_t start)
+	: _bus(bus), _start(start), _size(size), _reserved(0)
+{
+}
+
+uint32_t ParallelMemory::reserve(uint32_t n, uint32_t align)
+{
+	uint32_t address = alignUp(_reserved, align);
+
+	if ((address > _size) || (n > _size - address))
+		return PARALLEL_MEMORY_NULL;
+
+	_reserved = address + n;
+	return address;
+}
+
+ParallelPool::ParallelPool()
+	: _memory(NULL), _base(0), _blockSize(0), _count(0), _available(0),
+	  _freeList(PARALLEL_MEMORY_NULL), _fresh(0)
+{
+}
+
+bool ParallelPool::begin(ParallelMemory &memory, uint32_t blockSize, uint32_t count)
+{
+	blockSize = (blockSize + 3) & ~3u;
+
+	if ((blockSize == 0) || (count > 0xFFFFFFFFu / blockSize))
+		return false;
+
+	uint32_t base = memory.reserve(blockSize * count, 4);
+	if (base == PARALLEL_MEMORY_NULL)
+		return false;
+
+	_memory = &memory;
+	_base = base;
+	_blockSize = blockSize;
+	_count = count;
+	_available = count;
+	_freeList = PARALLEL_MEMORY_NULL;
+	_fresh = 0;
+	return true;
+}
+
+uint32_t ParallelPool::allocate(void)
+{
+	uint32_t address;
+
+	if (_freeList != PARALLEL_MEMORY_NULL)
+	{
+		address = _freeList;
+		_freeList = _memory->load<uint32_t>(address);
+	}
+	else if (_fresh < _count)
+	{
+		address = _base + _fresh * _blockSize;
+		_fresh++;
+	}
+	else
+	{
+		return PARALLEL_MEMORY_NULL;
+	}
+
+	_available--;
+	return address;
+}
+
+void ParallelPool::release(uint32_t address)
+{
+	if (address == PARALLEL_MEMORY_NULL)
+		return;
+
+	_memory->store<uint32_t>(address, _freeList);
+	_freeList = address;
+	_available++;
+}
+
+ParallelArena::ParallelArena()
+	: _memory(NULL), _base(0), _size(0), _used(0)
+{
+}
+
+bool ParallelArena::begin(ParallelMemory &memory, uint32_t size)
+{
+	uint32_t base = memory.reserve(size, 4);
+	if (base == PARALLEL_MEMORY_NULL)
+		return false;
+
+	_memory = &memory;
+	_base = base;
+	_size = size;
+	_used = 0;
+	return true;
+}
+
+uint32_t ParallelArena::allocate(uint32_t n, uint32_t align)
+{
+	if (_memory == NULL)
+		return PARALLEL_MEMORY_NULL;
+
+	uint32_t address = _memory->alignUp(_base + _used, align);
+	uint32_t offset = address - _base;
+
+	if ((offset > _size) || (n > _size - offset))
+		return PARALLEL_MEMORY_NULL;
+
+	_used = offset + n;
+	return address;
+}
@@ -0,0 +1,164 @@
+/*
+  ParallelMemory.h
+
+  External SRAM on a chip select, managed as a memory region so large
+  buffers (framebuffers, sample logs, ...) can live off the DUE's 96 KB of
+  internal SRAM.  Memory is handed out as region addresses (byte offsets
+  from the start of the region) and accessed with read()/write() or the
+  typed load()/store().
+
+  ParallelMemory is the region itself.  reserve() carves out permanent
+  pieces of it, which is how the two allocators get their storage:
+
+    - ParallelPool: fixed size blocks, allocate() and release() are O(1) and
+      cost at most one 32-bit bus access (the free list is kept in the free
+      blocks themselves, so it uses no internal RAM)
+    - ParallelArena: bump allocation with mark()/release(), for buffers that
+      are freed all together (e.g. per frame or per capture)
+
+    ParallelMemory sram(Parallel, 512 * 1024UL);
+    ParallelPool blocks;
+    ParallelArena scratch;
+
+    blocks.begin(sram, 64, 1024);
+    scratch.begin(sram, 128 * 1024UL);
+
+    uint32_t block = blocks.allocate();
+    sram.store<uint32_t>(block, 1234);
+
+  Neither allocator locks; use each from one context only.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PARALLEL_MEMORY_H
+#define PARALLEL_MEMORY_H
+
+#include "Parallel.h"
+
+// Returned when an allocation can't be satisfied
+#define PARALLEL_MEMORY_NULL	0xFFFFFFFFu
+
+class ParallelMemory {
+public:
+  // Region of size bytes starting at bus offset start on the device's chip
+  // select.  The bus must have been started with begin().
+  ParallelMemory(ParallelClass &bus, uint32_t size, uint32_t start = 0);
+
+  // Permanently sets aside n bytes at the given alignment (a power of two).
+  // Returns the region address or PARALLEL_MEMORY_NULL.
+  uint32_t reserve(uint32_t n, uint32_t align = 4);
+
+  uint32_t size() { return _size; }
+  uint32_t available() { return _size - _reserved; }
+
+  void read(uint32_t address, void *dst, size_t n)
+  {
+    _bus.readMemory(_start + address, dst, n);
+  }
+  void write(uint32_t address, const void *src, size_t n)
+  {
+    _bus.writeMemory(_start + address, src, n);
+  }
+
+  template <typename T> T load(uint32_t address)
+  {
+    T value;
+    read(address, &value, sizeof(T));
+    return value;
+  }
+  template <typename T> void store(uint32_t address, const T &value)
+  {
+    write(address, &value, sizeof(T));
+  }
+
+#ifndef PARALLEL_HOST_SIM
+  // The SMC window is also directly addressable by the CPU
+  void *pointer(uint32_t address)
+  {
+    return (void *)(_bus.getAddress() + _start + address);
+  }
+#endif
+
+private:
+  friend class ParallelArena;
+
+  // Rounds a region address up so the bus address is aligned
+  uint32_t alignUp(uint32_t address, uint32_t align)
+  {
+    return ((_start + address + align - 1) & ~(align - 1)) - _start;
+  }
+
+  ParallelClass &_bus;
+  uint32_t _start;
+  uint32_t _size;
+  uint32_t _reserved;
+};
+
+class ParallelPool {
+public:
+  ParallelPool();
+
+  // Takes count blocks of blockSize bytes (rounded up to a multiple of 4)
+  // from the region.  Returns false if there isn't room.
+  bool begin(ParallelMemory &memory, uint32_t blockSize, uint32_t count);
+
+  // Returns a block's region address, or PARALLEL_MEMORY_NULL when empty
+  uint32_t allocate();
+  void release(uint32_t address);
+
+  uint32_t blockSize() { return _blockSize; }
+  uint32_t available() { return _available; }
+
+private:
+  ParallelMemory *_memory;
+  uint32_t _base;
+  uint32_t _blockSize;
+  uint32_t _count;
+  uint32_t _available;
+
+  // Released blocks form a list through their first word.  Blocks that have
+  // never been handed out are taken from _fresh onwards instead, so begin()
+  // doesn't have to write the whole pool.
+  uint32_t _freeList;
+  uint32_t _fresh;
+};
+
+class ParallelArena {
+public:
+  ParallelArena();
+
+  // Takes size bytes from the region.  Returns false if there isn't room.
+  bool begin(ParallelMemory &memory, uint32_t size);
+
+  // Returns the region address of n bytes, or PARALLEL_MEMORY_NULL
+  uint32_t allocate(uint32_t n, uint32_t align = 4);
+
+  // release(mark()) frees everything allocated after the mark was taken
+  uint32_t mark() { return _used; }
+  void release(uint32_t mark) { if (mark < _used) _used = mark; }
+  void reset() { _used = 0; }
+
+  uint32_t used() { return _used; }
+  uint32_t available() { return _size - _used; }
+
+private:
+  ParallelMemory *_memory;
+  uint32_t _base;
+  uint32_t _size;
+  uint32_t _used;
+};
+
+#endif
@@ -0,0 +1,475 @@
+/*
+  ParallelNand.cpp
+
+  Raw NAND flash through the NFC.  See ParallelNand.h for usage.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ParallelNand.h"
+
+// The NFC SRAM takes one 4 KB page or two 2 KB pages with their spare
+// areas.  Bank n starts n pages (main + spare) in.
+#define NFC_SRAM_SIZE	4224
+#define MAX_SPARE		128
+#define ECC_SECTOR		512
+
+// NANDALE/NANDCLE share PD8/PD9 with A21/A22
+static const PinDescription NandPins[] =
+{
+	{ PIOC, PIO_PC19A_NANDOE,     ID_PIOC, PIO_PERIPH_A, PIO_PULLUP, PIN_ATTR_DIGITAL,                  NO_ADC, NO_ADC, NOT_ON_PWM,  NOT_ON_TIMER }, // PIN 44
+	{ PIOC, PIO_PC20A_NANDWE,     ID_PIOC, PIO_PERIPH_A, PIO_PULLUP, PIN_ATTR_DIGITAL,                  NO_ADC, NO_ADC, NOT_ON_PWM,  NOT_ON_TIMER }, // N/C
+	{ PIOD, PIO_PD8A_NANDALE,     ID_PIOD, PIO_PERIPH_A, PIO_PULLUP, PIN_ATTR_DIGITAL,                  NO_ADC, NO_ADC, NOT_ON_PWM,  NOT_ON_TIMER }, // PWM12
+	{ PIOD, PIO_PD9A_NANDCLE,     ID_PIOD, PIO_PERIPH_A, PIO_PULLUP, PIN_ATTR_DIGITAL,                  NO_ADC, NO_ADC, NOT_ON_PWM,  NOT_ON_TIMER }, // PIN 30
+	{ PIOA, PIO_PA2B_NANDRDY,     ID_PIOA, PIO_PERIPH_B, PIO_PULLUP, PIN_ATTR_DIGITAL,                  NO_ADC, NO_ADC, NOT_ON_PWM,  NOT_ON_TIMER }  // AD7
+};
+
+static const uint32_t addressCycleFlags[] =
+{
+	NFCADDR_CMD_ACYCLE_NONE,
+	NFCADDR_CMD_ACYCLE_ONE,
+	NFCADDR_CMD_ACYCLE_TWO,
+	NFCADDR_CMD_ACYCLE_THREE,
+	NFCADDR_CMD_ACYCLE_FOUR,
+	NFCADDR_CMD_ACYCLE_FIVE
+};
+
+// The ECC unit's parity for 512 bytes is 24 bits: the XOR of the bit
+// numbers (byte << 3 | bit) of every set bit, and in the top 12 bits the
+// XOR of their complements.  A single flipped bit changes the two halves
+// by its bit number and its complement; a single bit flipped in the stored
+// parity changes just that bit.
+static ParallelNandStatus_t correctSector(uint8_t *sector, uint32_t stored,
+                                          uint32_t computed)
+{
+	uint32_t diff = (stored ^ computed) & 0xFFFFFF;
+	uint32_t bit = diff & 0xFFF;
+
+	if (diff == 0)
+		return PARALLEL_NAND_OK;
+
+	if ((bit ^ (diff >> 12)) == 0xFFF)
+	{
+		sector[bit >> 3] ^= 1 << (bit & 7);
+		return PARALLEL_NAND_CORRECTED;
+	}
+
+	if ((diff & (diff - 1)) == 0)
+		return PARALLEL_NAND_CORRECTED;
+
+	return PARALLEL_NAND_ECC_ERROR;
+}
+
+ParallelNand::ParallelNand(ParallelClass &bus)
+	: _bus(bus), _csid(0), _pageSize(0), _spareSize(0), _pagesPerBlock(0),
+	  _blocks(0), _rowCycles(2), _eccBytes(0), _banks(1), _badCount(0),
+	  _corrected(0), _eccErrors(0), _timeouts(0)
+{
+	memset(_bad, 0, sizeof(_bad));
+}
+
+bool ParallelNand::begin(const ParallelNandGeometry_t &geometry)
+{
+	uint32_t cfgPageSize;
+	uint32_t eccPageSize;
+
+	switch (geometry.pageSize)
+	{
+	case 1024:
+		cfgPageSize = SMC_CFG_PAGESIZE_PS1024_32;
+		eccPageSize = SMC_ECC_MD_ECC_PAGESIZE_PS1024_32;
+		break;
+	case 2048:
+		cfgPageSize = SMC_CFG_PAGESIZE_PS2048_64;
+		eccPageSize = SMC_ECC_MD_ECC_PAGESIZE_PS2048_64;
+		break;
+	case 4096:
+		cfgPageSize = SMC_CFG_PAGESIZE_PS4096_128;
+		eccPageSize = SMC_ECC_MD_ECC_PAGESIZE_PS4096_128;
+		break;
+	default:
+		return false;
+	}
+
+	_pageSize = geometry.pageSize;
+	_spareSize = geometry.spareSize;
+	_pagesPerBlock = geometry.pagesPerBlock;
+	_blocks = geometry.blocks;
+	_eccBytes = (_pageSize / ECC_SECTOR) * 3;
+
+	if ((_spareSize > MAX_SPARE) || (_spareSize < _eccBytes + 2)
+		|| (_blocks > PARALLEL_NAND_MAX_BLOCKS)
+		|| (_bus.getChipSelect() >= PARALLEL_CS_NONE))
+		return false;
+
+	_rowCycles = ((uint32_t)_pagesPerBlock * _blocks > 0x10000) ? 3 : 2;
+	_banks = (2 * (_pageSize + _spareSize) <= NFC_SRAM_SIZE) ? 2 : 1;
+	_csid = NFCADDR_CMD_CSID(_bus.getChipSelect());
+
+	for (size_t i = 0; i < sizeof(NandPins) / sizeof(NandPins[0]); i++)
+	{
+		PIO_Configure(NandPins[i].pPort,
+			NandPins[i].ulPinType,
+			NandPins[i].ulPin,
+			NandPins[i].ulPinConfiguration);
+	}
+
+	smc_set_nand_timing(SMC, _bus.getChipSelect(), PARALLEL_NAND_TIMINGS
+		| SMC_TIMINGS_RBNSEL(0)
+		| SMC_TIMINGS_NFSEL);
+
+	// Reads bring the spare area into the NFC SRAM with the page; it is
+	// written over the bus instead, once the ECC for the page is known.
+	smc_nfc_init(SMC, cfgPageSize
+		| SMC_CFG_RSPARE
+		| SMC_CFG_RBEDGE
+		| SMC_CFG_DTOCYC(0xF)
+		| SMC_CFG_DTOMUL_X1048576);
+	smc_ecc_init(SMC, SMC_ECC_MD_TYPCORREC_C512B, eccPageSize);
+	smc_nfc_enable(SMC);
+
+	if (!reset())
+		return false;
+
+	// Factory bad blocks have a marker other than 0xFF in the first or
+	// second page
+	memset(_bad, 0, sizeof(_bad));
+	_badCount = 0;
+
+	for (uint16_t block = 0; block < _blocks; block++)
+	{
+		uint32_t page = (uint32_t)block * _pagesPerBlock;
+
+		if ((readSpareByte(page) != 0xFF) || (readSpareByte(page + 1) != 0xFF))
+		{
+			_bad[block >> 3] |= 1 << (block & 7);
+			_badCount++;
+		}
+	}
+
+	return true;
+}
+
+bool ParallelNand::reset(void)
+{
+	command(NAND_CMD_RESET, 0, 0, 0, 0, 0);
+	return waitReady() == PARALLEL_NAND_OK;
+}
+
+void ParallelNand::readId(uint8_t *id, uint8_t n)
+{
+	command(NAND_CMD_READ_ID, 0, 0, 0, 1, 0);
+	_bus.readBlock(0, id, n);
+}
+
+// Address cycles go out column first, then row.  Erase only sends the row.
+void ParallelNand::command(uint8_t cmd1, uint8_t cmd2, uint32_t page,
+                           uint16_t column, uint8_t addressCycles, uint32_t flags)
+{
+	uint8_t address[5] =
+	{
+		(uint8_t)column, (uint8_t)(column >> 8),
+		(uint8_t)page, (uint8_t)(page >> 8), (uint8_t)(page >> 16)
+	};
+	const uint8_t *a = (addressCycles == _rowCycles) ? address + 2 : address;
+	uint32_t cycles = 0;
+
+	for (uint8_t i = 1; i < addressCycles; i++)
+		cycles |= (uint32_t)a[i] << (8 * (i - 1));
+
+	uint32_t cmd = NFCADDR_CMD_NFCCMD
+		| _csid
+		| addressCycleFlags[addressCycles]
+		| flags
+		| ((uint32_t)cmd1 << 2);
+
+	if (cmd2 != 0)
+		cmd |= NFCADDR_CMD_VCMD2 | ((uint32_t)cmd2 << 10);
+
+	smc_nfc_send_command(SMC, cmd, cycles, (addressCycles > 0) ? a[0] : 0);
+}
+
+uint8_t *ParallelNand::bank(uint8_t n)
+{
+	return (uint8_t *)NFC_RAM_ADDR + n * (_pageSize + _spareSize);
+}
+
+// XFRDONE is cleared by reading the status register, which the command
+// routine polls, so also take an idle NFC as the end of the transfer.
+bool ParallelNand::waitTransfer(void)
+{
+	uint32_t start = micros();
+	uint32_t sr;
+
+	while (((sr = SMC->SMC_SR) & (SMC_SR_XFRDONE | SMC_SR_NFCBUSY)) == SMC_SR_NFCBUSY)
+	{
+		if (micros() - start > PARALLEL_NAND_TIMEOUT_US)
+		{
+			_timeouts++;
+			return false;
+		}
+	}
+
+	if (sr & SMC_SR_DTOE)
+	{
+		_timeouts++;
+		return false;
+	}
+
+	return true;
+}
+
+ParallelNandStatus_t ParallelNand::waitReady(void)
+{
+	uint32_t start = micros();
+	uint8_t status;
+
+	command(NAND_CMD_STATUS, 0, 0, 0, 0, 0);
+
+	while (((status = _bus.read(0)) & NAND_STATUS_READY) == 0)
+	{
+		if (micros() - start > PARALLEL_NAND_TIMEOUT_US)
+		{
+			_timeouts++;
+			return PARALLEL_NAND_TIMEOUT;
+		}
+	}
+
+	return (status & NAND_STATUS_FAIL) ? PARALLEL_NAND_FAIL : PARALLEL_NAND_OK;
+}
+
+uint8_t ParallelNand::readSpareByte(uint32_t page)
+{
+	command(NAND_CMD_READ, NAND_CMD_READ_CONFIRM, page, _pageSize, _rowCycles + 2, 0);
+
+	if (waitReady() != PARALLEL_NAND_OK)
+		return 0x00;
+
+	// back to data output after the status reads
+	command(NAND_CMD_READ, 0, 0, 0, 0, 0);
+	return _bus.read(0);
+}
+
+// The spare area isn't covered by the ECC
+ParallelNandStatus_t ParallelNand::readSpare(uint32_t page, uint8_t *spare)
+{
+	if (page / _pagesPerBlock >= _blocks)
+		return PARALLEL_NAND_BAD_BLOCK;
+
+	command(NAND_CMD_READ, NAND_CMD_READ_CONFIRM, page, _pageSize + 2, _rowCycles + 2, 0);
+
+	ParallelNandStatus_t status = waitReady();
+
+	if (status != PARALLEL_NAND_OK)
+		return status;
+
+	command(NAND_CMD_READ, 0, 0, 0, 0, 0);
+	_bus.readBlock(0, spare, spareBytes());
+	return PARALLEL_NAND_OK;
+}
+
+void ParallelNand::markBad(uint16_t block)
+{
+	if (block >= _blocks)
+		return;
+
+	if ((_bad[block >> 3] & (1 << (block & 7))) == 0)
+	{
+		_bad[block >> 3] |= 1 << (block & 7);
+		_badCount++;
+	}
+
+	command(NAND_CMD_PROGRAM, 0, (uint32_t)block * _pagesPerBlock, _pageSize,
+		_rowCycles + 2, 0);
+	_bus.write(0, 0x00);
+	command(NAND_CMD_PROGRAM_CONFIRM, 0, 0, 0, 0, 0);
+	waitReady();
+}
+
+ParallelNandStatus_t ParallelNand::eraseBlock(uint16_t block)
+{
+	if (isBad(block))
+		return PARALLEL_NAND_BAD_BLOCK;
+
+	command(NAND_CMD_ERASE, NAND_CMD_ERASE_CONFIRM, (uint32_t)block * _pagesPerBlock,
+		0, _rowCycles, 0);
+
+	ParallelNandStatus_t status = waitReady();
+
+	if (status == PARALLEL_NAND_FAIL)
+		markBad(block);
+
+	return status;
+}
+
+void ParallelNand::startRead(uint32_t page, uint8_t n)
+{
+	smc_nfc_set_bank(SMC, n);
+	SMC->SMC_ECC_CTRL = SMC_ECC_CTRL_RST;
+	command(NAND_CMD_READ, NAND_CMD_READ_CONFIRM, page, 0, _rowCycles + 2,
+		NFCADDR_CMD_NFCEN | NFCADDR_CMD_NFC_READ);
+}
+
+ParallelNandStatus_t ParallelNand::finishRead(uint8_t n, const uint32_t *parity,
+                                              uint8_t *data, uint8_t *spare)
+{
+	const uint8_t *src = bank(n);
+	const uint8_t *ecc = src + _pageSize + _spareSize - _eccBytes;
+	ParallelNandStatus_t result = PARALLEL_NAND_OK;
+	bool erased = true;
+
+	memcpy(data, src, _pageSize);
+
+	if (spare)
+		memcpy(spare, src + _pageSize + 2, spareBytes());
+
+	// An erased page has no ECC stored
+	for (uint8_t i = 0; i < _eccBytes; i++)
+		erased = erased && (ecc[i] == 0xFF);
+
+	if (erased)
+		return PARALLEL_NAND_OK;
+
+	for (uint8_t s = 0; s < _pageSize / ECC_SECTOR; s++)
+	{
+		uint32_t stored = ecc[3 * s]
+			| ((uint32_t)ecc[3 * s + 1] << 8)
+			| ((uint32_t)ecc[3 * s + 2] << 16);
+		ParallelNandStatus_t status = correctSector(data + s * ECC_SECTOR, stored, parity[s]);
+
+		if (status == PARALLEL_NAND_CORRECTED)
+			_corrected++;
+		else if (status == PARALLEL_NAND_ECC_ERROR)
+			_eccErrors++;
+
+		if (status > result)
+			result = status;
+	}
+
+	return result;
+}
+
+// With two banks the NFC reads the next page while this one is copied out
+// and checked.  The parity has to be collected before the next transfer
+// resets the ECC unit.
+ParallelNandStatus_t ParallelNand::readPages(uint32_t page, uint16_t count,
+                                             uint8_t *data, uint8_t *spare)
+{
+	ParallelNandStatus_t result = PARALLEL_NAND_OK;
+	uint8_t n = 0;
+
+	if (count == 0)
+		return PARALLEL_NAND_OK;
+
+	// Blocks that went bad can still be read, to move their data off
+	if (page / _pagesPerBlock >= _blocks)
+		return PARALLEL_NAND_BAD_BLOCK;
+
+	startRead(page, n);
+
+	for (uint16_t i = 0; i < count; i++)
+	{
+		uint32_t parity[16];
+		uint8_t next = (n + 1) % _banks;
+		bool ahead = (next != n) && (i + 1 < count);
+
+		if (!waitTransfer())
+			return PARALLEL_NAND_TIMEOUT;
+
+		smc_ecc_get_value(SMC, parity);
+
+		if (ahead)
+			startRead(page + i + 1, next);
+
+		ParallelNandStatus_t status = finishRead(n, parity, data + (size_t)i * _pageSize,
+			spare ? spare + (size_t)i * spareBytes() : NULL);
+
+		if (status > result)
+			result = status;
+
+		if (!ahead && (i + 1 < count))
+			startRead(page + i + 1, next);
+
+		n = next;
+	}
+
+	return result;
+}
+
+// The NFC sends the main area from its SRAM, then the spare area with the
+// parity for the page goes out over the bus before the program command.
+// The next page is copied into the NFC SRAM while this one programs.
+ParallelNandStatus_t ParallelNand::writePages(uint32_t page, uint16_t count,
+                                              const uint8_t *data, const uint8_t *spare)
+{
+	uint16_t block = page / _pagesPerBlock;
+	uint8_t n = 0;
+
+	if (count == 0)
+		return PARALLEL_NAND_OK;
+
+	if (isBad(block))
+		return PARALLEL_NAND_BAD_BLOCK;
+
+	memcpy(bank(n), data, _pageSize);
+
+	for (uint16_t i = 0; i < count; i++)
+	{
+		uint32_t parity[16];
+		uint8_t tail[MAX_SPARE];
+		uint8_t *ecc = tail + _spareSize - _eccBytes;
+
+		smc_nfc_set_bank(SMC, n);
+		SMC->SMC_ECC_CTRL = SMC_ECC_CTRL_RST;
+		command(NAND_CMD_PROGRAM, 0, page + i, 0, _rowCycles + 2,
+			NFCADDR_CMD_NFCEN | NFCADDR_CMD_NFC_WIRTE);
+
+		if (!waitTransfer())
+			return PARALLEL_NAND_TIMEOUT;
+
+		smc_ecc_get_value(SMC, parity);
+
+		memset(tail, 0xFF, _spareSize);
+		if (spare)
+			memcpy(tail + 2, spare + (size_t)i * spareBytes(), spareBytes());
+
+		for (uint8_t s = 0; s < _pageSize / ECC_SECTOR; s++)
+		{
+			ecc[3 * s] = (uint8_t)parity[s];
+			ecc[3 * s + 1] = (uint8_t)(parity[s] >> 8);
+			ecc[3 * s + 2] = (uint8_t)(parity[s] >> 16);
+		}
+
+		_bus.writeBlock(0, tail, _spareSize);
+		command(NAND_CMD_PROGRAM_CONFIRM, 0, 0, 0, 0, 0);
+
+		if (i + 1 < count)
+		{
+			n = (n + 1) % _banks;
+			memcpy(bank(n), data + (size_t)(i + 1) * _pageSize, _pageSize);
+		}
+
+		ParallelNandStatus_t status = waitReady();
+
+		if (status != PARALLEL_NAND_OK)
+		{
+			if (status == PARALLEL_NAND_FAIL)
+				markBad(block);
+			return status;
+		}
+	}
+
+	return PARALLEL_NAND_OK;
+}
@@ -0,0 +1,189 @@
+/*
+  ParallelNand.h
+
+  Raw NAND flash through the SAM3X NAND Flash Controller (NFC).  The NFC
+  sends the command and address cycles itself and moves whole pages
+  between the flash and its own SRAM, so the core only copies pages in and
+  out of that SRAM.  The SMC's ECC unit computes parity over each 512 bytes
+  as they go by; it is stored in the spare area when a page is written and
+  compared on reads, where a single bit error per 512 bytes is corrected.
+
+  Large page (1, 2 or 4 KB) 8-bit parts are supported.  The flash goes on a
+  chip select, with CLE on NANDCLE (A22), ALE on NANDALE (A21), its strobes
+  on NANDOE/NANDWE and R/B on NANDRDY.  NANDWE (PC20) doesn't reach the DUE
+  headers, so this needs a board that breaks it out.
+
+    static const ParallelNandGeometry_t geometry = { 2048, 64, 64, 1024 };
+    ParallelClass nandBus;
+    ParallelNand nand(nandBus);
+
+    nandBus.begin(PARALLEL_BUS_WIDTH_8, PARALLEL_CS_1, 0, 0, 0);
+    nand.begin(geometry);
+    nand.eraseBlock(1);
+    nand.writePage(64, data);
+
+  The NFC SRAM holds two pages of up to 2 KB, used as two banks:
+  readPages() has the NFC fetch the next page into one bank while the
+  previous one is copied out and checked, and writePages() fills the next
+  page while the flash programs the previous one.
+
+  Factory bad blocks are found when begin() scans the part and are kept in
+  a table in SRAM.  Blocks that fail a program or erase are added to it
+  (and marked on the flash) as they turn up.
+
+  Spare area layout: bytes 0-1 are the bad block marker, the ECC (3 bytes
+  per 512) is at the end and the spareBytes() bytes between them are free
+  for the caller.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PARALLEL_NAND_H
+#define PARALLEL_NAND_H
+
+#include "Parallel.h"
+
+// Largest number of blocks the bad block table covers
+#ifndef PARALLEL_NAND_MAX_BLOCKS
+#define PARALLEL_NAND_MAX_BLOCKS	4096
+#endif
+
+// Microseconds to wait for the flash or the NFC before giving up
+#ifndef PARALLEL_NAND_TIMEOUT_US
+#define PARALLEL_NAND_TIMEOUT_US	20000
+#endif
+
+// NFC timings for the chip select (SMC_TIMINGS): CLE to RE, ALE to data,
+// ALE to RE, ready to RE and WE to busy, in MCK cycles.  These suit most
+// parts at 84 MHz.
+#ifndef PARALLEL_NAND_TIMINGS
+#define PARALLEL_NAND_TIMINGS	(SMC_TIMINGS_TCLR(2) | SMC_TIMINGS_TADL(7) \
+	| SMC_TIMINGS_TAR(2) | SMC_TIMINGS_TRR(3) | SMC_TIMINGS_TWB(7))
+#endif
+
+// Commands
+#define NAND_CMD_READ			0x00
+#define NAND_CMD_READ_CONFIRM	0x30
+#define NAND_CMD_PROGRAM		0x80
+#define NAND_CMD_PROGRAM_CONFIRM	0x10
+#define NAND_CMD_ERASE			0x60
+#define NAND_CMD_ERASE_CONFIRM	0xD0
+#define NAND_CMD_STATUS			0x70
+#define NAND_CMD_READ_ID		0x90
+#define NAND_CMD_RESET			0xFF
+
+// Status register bits
+#define NAND_STATUS_FAIL		0x01
+#define NAND_STATUS_READY		0x40
+
+// Later values are worse, so the result of several pages is the largest
+typedef enum
+{
+	PARALLEL_NAND_OK,
+	PARALLEL_NAND_CORRECTED,	// read fine after fixing single bit errors
+	PARALLEL_NAND_ECC_ERROR,	// more errors than the ECC can fix
+	PARALLEL_NAND_BAD_BLOCK,	// block is in the bad block table
+	PARALLEL_NAND_FAIL,			// program/erase failed, block now marked bad
+	PARALLEL_NAND_TIMEOUT
+} ParallelNandStatus_t;
+
+typedef struct
+{
+	uint16_t pageSize;		// main area bytes: 1024, 2048 or 4096
+	uint16_t spareSize;		// spare area bytes per page
+	uint16_t pagesPerBlock;
+	uint16_t blocks;
+} ParallelNandGeometry_t;
+
+class ParallelNand {
+public:
+  ParallelNand(ParallelClass &bus);
+
+  // Sets up the NFC and ECC for the part on the bus's chip select, resets
+  // it and scans for bad blocks.  Returns false for unsupported geometries
+  // or if the part doesn't respond.
+  bool begin(const ParallelNandGeometry_t &geometry);
+
+  bool reset();
+  void readId(uint8_t *id, uint8_t n);
+
+  // Page numbers count from the first page of block 0.  spare, if given,
+  // holds spareBytes() bytes per page.
+  ParallelNandStatus_t readPage(uint32_t page, uint8_t *data, uint8_t *spare = NULL)
+  {
+    return readPages(page, 1, data, spare);
+  }
+  ParallelNandStatus_t writePage(uint32_t page, const uint8_t *data,
+                                 const uint8_t *spare = NULL)
+  {
+    return writePages(page, 1, data, spare);
+  }
+  ParallelNandStatus_t eraseBlock(uint16_t block);
+
+  // Just the caller's spare bytes of a page, without the ECC check
+  ParallelNandStatus_t readSpare(uint32_t page, uint8_t *spare);
+
+  // count consecutive pages, which must not cross into another block.
+  // Writes to bad blocks are refused, reads aren't.
+  ParallelNandStatus_t readPages(uint32_t page, uint16_t count, uint8_t *data,
+                                 uint8_t *spare = NULL);
+  ParallelNandStatus_t writePages(uint32_t page, uint16_t count, const uint8_t *data,
+                                  const uint8_t *spare = NULL);
+
+  bool isBad(uint16_t block)
+  {
+    return (block >= _blocks) || (_bad[block >> 3] & (1 << (block & 7)));
+  }
+  void markBad(uint16_t block);
+  uint16_t badBlocks() { return _badCount; }
+
+  uint16_t pageSize() { return _pageSize; }
+  uint16_t spareBytes() { return _spareSize - 2 - _eccBytes; }
+  uint16_t pagesPerBlock() { return _pagesPerBlock; }
+  uint16_t blocks() { return _blocks; }
+
+  // Sectors fixed by the ECC, reads it couldn't fix, and waits that gave up
+  uint32_t corrected() { return _corrected; }
+  uint32_t eccErrors() { return _eccErrors; }
+  uint32_t timeouts() { return _timeouts; }
+
+private:
+  void command(uint8_t cmd1, uint8_t cmd2, uint32_t page, uint16_t column,
+               uint8_t addressCycles, uint32_t flags);
+  uint8_t *bank(uint8_t n);
+  void startRead(uint32_t page, uint8_t n);
+  ParallelNandStatus_t finishRead(uint8_t n, const uint32_t *parity,
+                                  uint8_t *data, uint8_t *spare);
+  bool waitTransfer();
+  ParallelNandStatus_t waitReady();
+  uint8_t readSpareByte(uint32_t page);
+
+  ParallelClass &_bus;
+  uint32_t _csid;
+  uint16_t _pageSize;
+  uint16_t _spareSize;
+  uint16_t _pagesPerBlock;
+  uint16_t _blocks;
+  uint8_t _rowCycles;
+  uint8_t _eccBytes;
+  uint8_t _banks;
+  uint16_t _badCount;
+  uint32_t _corrected;
+  uint32_t _eccErrors;
+  uint32_t _timeouts;
+  uint8_t _bad[(PARALLEL_NAND_MAX_BLOCKS + 7) / 8];
+};
+
+#endif
@@ -0,0 +1,127 @@
+/*
+  ParallelProfile.cpp
+
+  Bus profiles stored in internal flash.  See ParallelProfile.h for usage.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ParallelProfile.h"
+
+#if (PARALLEL_PROFILE_SLOTS < 1) || (PARALLEL_PROFILE_SLOTS > 15)
+#error "PARALLEL_PROFILE_SLOTS must be 1 to 15"
+#endif
+
+#define PROFILE_MAGIC	0x464F5250		// "PROF"
+#define PROFILE_VERSION	1
+
+ParallelProfileStore::ParallelProfileStore(uint32_t page)
+	: _page(page)
+{
+	clear();
+}
+
+void ParallelProfileStore::clear()
+{
+	memset(&_image, 0, sizeof(_image));
+	_image.magic = PROFILE_MAGIC;
+	_image.version = PROFILE_VERSION;
+}
+
+const ParallelProfileStore::Image_t *ParallelProfileStore::stored()
+{
+	return (const Image_t *)(IFLASH1_ADDR + _page * IFLASH1_PAGE_SIZE);
+}
+
+uint16_t ParallelProfileStore::crc(const Image_t &image)
+{
+	return parallelCrc16((const uint8_t *)&image, offsetof(Image_t, crc));
+}
+
+bool ParallelProfileStore::load()
+{
+	if (_page >= IFLASH1_NB_OF_PAGES)
+	{
+		clear();
+		return false;
+	}
+
+	const Image_t *image = stored();
+
+	if ((image->magic != PROFILE_MAGIC) || (image->version != PROFILE_VERSION)
+		|| (image->crc != crc(*image)))
+	{
+		clear();
+		return false;
+	}
+
+	memcpy(&_image, image, sizeof(_image));
+	_image.used &= (1u << PARALLEL_PROFILE_SLOTS) - 1;
+	return true;
+}
+
+bool ParallelProfileStore::save()
+{
+	if (_page >= IFLASH1_NB_OF_PAGES)
+		return false;
+
+	_image.crc = crc(_image);
+
+	// nothing to do, and a flash cycle saved
+	if (memcmp(stored(), &_image, sizeof(_image)) == 0)
+		return true;
+
+	// Writes to the page go to the EEFC's page buffer, which the command
+	// then programs.  The rest of the page is left erased.
+	volatile uint32_t *latch = (volatile uint32_t *)stored();
+	const uint32_t *words = (const uint32_t *)&_image;
+
+	for (uint32_t i = 0; i < IFLASH1_PAGE_SIZE / 4; i++)
+		latch[i] = (i < sizeof(_image) / 4) ? words[i] : 0xFFFFFFFF;
+
+	__DSB();
+	if (efc_perform_command(EFC1, EFC_FCMD_EWP, _page) != EFC_RC_OK)
+		return false;
+
+	return memcmp(stored(), &_image, sizeof(_image)) == 0;
+}
+
+bool ParallelProfileStore::get(uint8_t slot, ParallelBusProfile_t &profile)
+{
+	if ((slot >= PARALLEL_PROFILE_SLOTS) || !(_image.used & (1u << slot)))
+		return false;
+
+	profile = _image.profiles[slot];
+	return true;
+}
+
+bool ParallelProfileStore::set(uint8_t slot, const ParallelBusProfile_t &profile)
+{
+	if (slot >= PARALLEL_PROFILE_SLOTS)
+		return false;
+
+	_image.profiles[slot] = profile;
+	_image.used |= (uint16_t)(1u << slot);
+	return true;
+}
+
+void ParallelProfileStore::erase(uint8_t slot)
+{
+	if (slot >= PARALLEL_PROFILE_SLOTS)
+		return;
+
+	memset(&_image.profiles[slot], 0, sizeof(_image.profiles[slot]));
+	_image.used &= (uint16_t)~(1u << slot);
+}
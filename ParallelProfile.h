@@ -0,0 +1,106 @@
+/*
+  ParallelProfile.h
+
+  Bus profiles kept in the SAM3X's own flash, so a board boots straight
+  into the timings tuned for it instead of tuning (or running at the data
+  sheet's worst case) every time.  A profile is the chip select's SETUP,
+  PULSE, CYCLE and MODE register images (ParallelBusProfile_t in
+  Parallel.h), which setProfile() loads in one short burst, so the same
+  chip select can also be switched between, say, a slow profile for
+  initialising a controller and a fast one for streaming to it:
+
+    ParallelProfileStore store;
+    ParallelBusProfile_t slow, fast;
+
+    Parallel.getProfile(slow);
+    if (!store.load() || !store.get(1, fast))
+    {
+      tuner.tune(datasheet, 0x1000, 256);	// see ParallelTuner.h
+      Parallel.getProfile(fast);
+      store.set(0, slow);
+      store.set(1, fast);
+      store.save();
+    }
+
+    Parallel.setProfile(slow);
+    ... initialise ...
+    Parallel.setProfile(fast);
+
+  The store holds PARALLEL_PROFILE_SLOTS profiles in one flash page, with a
+  magic number, version and CRC so a blank or stale page is ignored.  The
+  page is the last one of flash bank 1 by default, well clear of any
+  sketch that fits in bank 0.  Uploading a sketch erases the whole flash,
+  stored profiles included.
+
+  save() erases and writes the page, which takes a few milliseconds and
+  wears the flash (about 10,000 cycles), so it only writes when the
+  profiles have changed.  Code running from bank 1 (a sketch over 256KB)
+  stalls while it writes.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PARALLEL_PROFILE_H
+#define PARALLEL_PROFILE_H
+
+#include "Parallel.h"
+
+// Profiles per store.  At most 15, to fit one flash page.
+#ifndef PARALLEL_PROFILE_SLOTS
+#define PARALLEL_PROFILE_SLOTS	4
+#endif
+
+// Page of flash bank 1 the store lives in
+#ifndef PARALLEL_PROFILE_PAGE
+#define PARALLEL_PROFILE_PAGE	(IFLASH1_NB_OF_PAGES - 1)
+#endif
+
+class ParallelProfileStore {
+public:
+  ParallelProfileStore(uint32_t page = PARALLEL_PROFILE_PAGE);
+
+  // Reads the page.  Returns false, with every slot empty, if it doesn't
+  // hold a valid store.
+  bool load();
+
+  // Writes the profiles to the page if they differ from what is there, and
+  // reads them back.  Returns false if the write or the check failed.
+  bool save();
+
+  // A slot's profile.  get() returns false if the slot is empty.
+  bool get(uint8_t slot, ParallelBusProfile_t &profile);
+  bool set(uint8_t slot, const ParallelBusProfile_t &profile);
+  void erase(uint8_t slot);
+  void clear();
+
+private:
+  typedef struct
+  {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t used;		// bit per slot
+    ParallelBusProfile_t profiles[PARALLEL_PROFILE_SLOTS];
+    uint16_t reserved;
+    uint16_t crc;		// parallelCrc16() of everything above
+  } Image_t;
+
+  const Image_t *stored();
+  static uint16_t crc(const Image_t &image);
+
+  uint32_t _page;
+  Image_t _image;
+};
+
+#endif
@@ -0,0 +1,115 @@
+/*
+  ParallelQueue.cpp
+
+  Write combining command queue for the parallel bus.  See ParallelQueue.h 
+  for usage.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ParallelQueue.h"
+
+#define QUEUE_MASK	(PARALLEL_QUEUE_SIZE - 1)
+
+#if (PARALLEL_QUEUE_SIZE & QUEUE_MASK) != 0
+#error "PARALLEL_QUEUE_SIZE must be a power of two"
+#endif
+
+ParallelWriteQueue::ParallelWriteQueue(ParallelClass &bus, uint16_t threshold)
+	: _bus(bus), _threshold(threshold), _head(0), _tail(0), _flushing(false)
+{
+}
+
+void ParallelWriteQueue::write(uint32_t offset, uint8_t value)
+{
+	while (pending() >= PARALLEL_QUEUE_SIZE)
+	{
+		// an interrupt may be flushing already, in which case just wait
+		flush();
+	}
+	
+	uint16_t i = _head & QUEUE_MASK;
+	_offsets[i] = offset;
+	_values[i] = value;
+	
+	// publish the entry only once it has been filled in
+	__DMB();
+	_head = _head + 1;
+	
+	if ((_threshold > 0) && (pending() >= _threshold))
+		flush();
+}
+
+void ParallelWriteQueue::write(uint32_t offset, const uint8_t *src, size_t n)
+{
+	while (n--)
+	{
+		write(offset, *src++);
+	}
+}
+
+// Only one flush may run at a time; the claim is a short masked test-and-set
+bool ParallelWriteQueue::claim(void)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	
+	bool claimed = !_flushing;
+	if (claimed)
+		_flushing = true;
+	
+	__set_PRIMASK(primask);
+	return claimed;
+}
+
+uint16_t ParallelWriteQueue::flush(void)
+{
+	if (!claim())
+		return 0;
+	
+	uint16_t tail = _tail;
+	uint16_t head = _head;
+	uint16_t sent = 0;
+	
+	while (tail != head)
+	{
+		uint16_t start = tail & QUEUE_MASK;
+		uint32_t offset = _offsets[start];
+		uint16_t run = 1;
+		
+		// extend the run while the offset matches, stopping at the end of 
+		// the arrays so the values stay contiguous
+		while ((uint16_t)(tail + run) != head 
+			&& (start + run) < PARALLEL_QUEUE_SIZE
+			&& _offsets[start + run] == offset)
+		{
+			run++;
+		}
+		
+		if (run == 1)
+			_bus.write(offset, _values[start]);
+		else
+			_bus.writeBlock(offset, &_values[start], run);
+		
+		tail += run;
+		sent += run;
+		
+		// hand the space back as we go so the producer isn't held up
+		_tail = tail;
+	}
+	
+	_flushing = false;
+	return sent;
+}
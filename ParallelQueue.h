@@ -0,0 +1,82 @@
+/*
+  ParallelQueue.h
+
+  Write combining command queue for the parallel bus.  Register writes from 
+  all over a sketch are collected in a ring buffer and sent later in one go,
+  so drawing code never waits on the bus.  On flush, runs of consecutive 
+  writes to the same offset (e.g. pixel data to an LCD data register) are 
+  merged and sent with a single writeBlock().  The bus sees exactly the same 
+  sequence of writes as it would without the queue.
+
+  flush() can be called from the main loop, when the queue reaches its 
+  threshold, or from a timer interrupt.  Only one flush runs at a time; a
+  flush attempted while another is in progress returns straight away.
+
+    ParallelWriteQueue queue(Parallel, 192);
+    queue.write(0x01, 0x42);
+    queue.write(0x00, pixels, 40);
+    ...
+    queue.flush();
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PARALLEL_QUEUE_H
+#define PARALLEL_QUEUE_H
+
+#include "Parallel.h"
+
+// Number of queued writes.  Must be a power of two.
+#ifndef PARALLEL_QUEUE_SIZE
+#define PARALLEL_QUEUE_SIZE	256
+#endif
+
+class ParallelWriteQueue {
+public:
+  // A threshold of 0 means only flush when asked to (or when full)
+  ParallelWriteQueue(ParallelClass &bus, uint16_t threshold = 0);
+  
+  // Queue writes.  If the queue is full it is flushed first, which is the 
+  // only time these touch the bus.  Call from one context only.
+  void write(uint32_t offset, uint8_t value);
+  void write(uint32_t offset, const uint8_t *src, size_t n);
+  
+  // Send everything queued so far.  Returns the number of bytes written, or
+  // 0 if another flush was already in progress.
+  uint16_t flush();
+  
+  uint16_t pending() { return (uint16_t)(_head - _tail); }
+  bool isEmpty() { return _head == _tail; }
+  
+  void setThreshold(uint16_t threshold) { _threshold = threshold; }
+
+private:
+  bool claim();
+
+  ParallelClass &_bus;
+  uint16_t _threshold;
+  
+  // Offsets and values are kept in separate arrays so a run of values to 
+  // one offset is contiguous and can be handed straight to writeBlock().
+  uint32_t _offsets[PARALLEL_QUEUE_SIZE];
+  uint8_t _values[PARALLEL_QUEUE_SIZE];
+  
+  // free running indices, the producer owns _head and the consumer _tail
+  volatile uint16_t _head;
+  volatile uint16_t _tail;
+  volatile bool _flushing;
+};
+
+#endif
@@ -0,0 +1,410 @@
+/*
+  ParallelS1D13700.cpp
+
+  Driver for the EPSON S1D13700 LCD controller.  See ParallelS1D13700.h.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ParallelS1D13700.h"
+
+ParallelS1D13700::ParallelS1D13700(ParallelClass &bus)
+	: ParallelIndexedDevice(bus, 0x01, 0x00, 0x00), _shadow(NULL)
+{
+	setReadOffset(0x01);
+	setLayout(0x0000, 0x0960, 40, 320, 240, 240);
+}
+
+// 320x240 panel with 8x8 characters, as used on the CFAG320240
+static const uint8_t defaultInit[] = {
+	S1D13700_SYSTEM_SET, 8,
+		0x30,			// no origin compensation, single panel, internal CGROM
+		0x87,			// 8 pixel character width
+		0x07,			// 8 pixel character height
+		0x27,			// 40 bytes per display line
+		0x39,			// total line length incl. blanking
+		0xEF,			// 240 lines
+		0x28, 0x00,		// 40 bytes virtual screen width
+	S1D13700_SCROLL, 10,
+		0x00, 0x00, 0xEF,	// block 1 (text) at 0x0000, 240 lines
+		0x60, 0x09, 0xEF,	// block 2 (graphics) at 0x0960, 240 lines
+		0x00, 0x00,			// block 3
+		0x00, 0x00,			// block 4
+	S1D13700_HDOT_SCR, 1, 0x00,
+	S1D13700_OVLAY, 1, 0x01,		// two layers, XOR
+	S1D13700_CSRFORM, 2, 0x07, 0x87,
+	S1D13700_CSRDIR + S1D13700_CURSOR_RIGHT, 0,
+	S1D13700_DISP_OFF, 1, 0x00,
+};
+
+void ParallelS1D13700::begin(void)
+{
+	initialize(defaultInit, sizeof(defaultInit));
+}
+
+void ParallelS1D13700::setLayout(uint16_t textAddress, uint16_t graphicsAddress,
+                                 uint8_t stride, uint16_t width, uint16_t height,
+                                 uint16_t lines)
+{
+	_text = textAddress;
+	_graphics = graphicsAddress;
+	_stride = stride;
+	_width = width;
+	_height = height;
+	_lines = lines;
+}
+
+// Reads display memory from the shadow copy if there is one, otherwise from
+// the controller.  down means the bytes are a column, and the cursor must 
+// already be moving down.
+void ParallelS1D13700::readBack(uint16_t address, uint8_t *dst, uint16_t n, bool down)
+{
+	if (_shadow)
+	{
+		const uint8_t *p = &_shadow[address - _graphics];
+		uint16_t step = down ? _stride : 1;
+
+		while (n--)
+		{
+			*dst++ = *p;
+			p += step;
+		}
+		return;
+	}
+
+	setCursor(address);
+	command(S1D13700_MREAD);
+	readData(dst, n);
+}
+
+void ParallelS1D13700::writeRow(uint16_t address, const uint8_t *row, uint16_t n)
+{
+	setCursor(address);
+	command(S1D13700_MWRITE);
+	writeData(row, n);
+
+	if (_shadow)
+		memcpy(&_shadow[address - _graphics], row, n);
+}
+
+void ParallelS1D13700::drawText(uint8_t column, uint8_t row, const char *text)
+{
+	size_t n = strlen(text);
+
+	if (column >= _stride)
+		return;
+	if (n > (size_t)(_stride - column))
+		n = _stride - column;
+
+	setCursor(_text + row * _stride + column);
+	memoryWrite((const uint8_t *)text, n);
+}
+
+void ParallelS1D13700::clearText(void)
+{
+	setCursor(_text);
+	memoryFill(' ', (size_t)_stride * (_lines / 8));
+}
+
+void ParallelS1D13700::clear(bool on)
+{
+	uint8_t value = on ? 0xFF : 0x00;
+
+	setCursor(_graphics);
+	memoryFill(value, (size_t)_stride * _height);
+
+	if (_shadow)
+		memset(_shadow, value, (size_t)_stride * _height);
+}
+
+void ParallelS1D13700::setPixel(uint16_t x, uint16_t y, bool on)
+{
+	fillRect(x, y, 1, 1, on);
+}
+
+void ParallelS1D13700::fillRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, bool on)
+{
+	if ((x >= _width) || (y >= _height) || (w == 0) || (h == 0))
+		return;
+	if (w > _width - x)
+		w = _width - x;
+	if (h > _height - y)
+		h = _height - y;
+
+	uint16_t first = x >> 3;
+	uint16_t last = (x + w - 1) >> 3;
+	uint8_t leftMask = 0xFF >> (x & 7);
+	uint8_t rightMask = 0xFF << (7 - ((x + w - 1) & 7));
+	uint8_t value = on ? 0xFF : 0x00;
+	uint16_t columns = last - first + 1;
+
+	// Whole rows are contiguous in display memory: one run does it all
+	if ((columns == _stride) && (leftMask == 0xFF) && (rightMask == 0xFF))
+	{
+		setCursor(graphicsAddress(0, y));
+		memoryFill(value, (size_t)columns * h);
+		if (_shadow)
+			memset(&_shadow[graphicsAddress(0, y) - _graphics], value, (size_t)columns * h);
+		return;
+	}
+
+	// Each run costs a cursor set and MWRITE (4 bytes), so go down the 
+	// columns when there are fewer of them than rows
+	if (4 * columns + 2 < 4 * h)
+		fillColumns(first, last, leftMask, rightMask, y, h, value);
+	else
+		fillRows(first, last, leftMask, rightMask, y, h, value);
+}
+
+void ParallelS1D13700::fillRows(uint16_t first, uint16_t last, uint8_t leftMask,
+                                uint8_t rightMask, uint16_t y, uint16_t h, uint8_t value)
+{
+	uint16_t columns = last - first + 1;
+
+	if (columns == 1)
+		leftMask = rightMask = leftMask & rightMask;
+
+	for (uint16_t row = y; row < y + h; row++)
+	{
+		uint16_t address = _graphics + row * _stride + first;
+		uint8_t left = value;
+		uint8_t right = value;
+
+		if (leftMask != 0xFF)
+		{
+			readBack(address, &left, 1, false);
+			left = (left & ~leftMask) | (value & leftMask);
+		}
+		if ((columns > 1) && (rightMask != 0xFF))
+		{
+			readBack(address + columns - 1, &right, 1, false);
+			right = (right & ~rightMask) | (value & rightMask);
+		}
+
+		setCursor(address);
+		command(S1D13700_MWRITE);
+		writeData(left);
+		if (columns > 1)
+		{
+			fillData(value, columns - 2);
+			writeData(right);
+		}
+
+		if (_shadow)
+		{
+			uint8_t *p = &_shadow[address - _graphics];
+			p[0] = left;
+			if (columns > 1)
+			{
+				memset(p + 1, value, columns - 2);
+				p[columns - 1] = right;
+			}
+		}
+	}
+}
+
+void ParallelS1D13700::fillColumns(uint16_t first, uint16_t last, uint8_t leftMask,
+                                   uint8_t rightMask, uint16_t y, uint16_t h, uint8_t value)
+{
+	uint8_t buffer[64];
+
+	setCursorDirection(S1D13700_CURSOR_DOWN);
+
+	for (uint16_t column = first; column <= last; column++)
+	{
+		uint8_t mask = 0xFF;
+
+		if (column == first)
+			mask &= leftMask;
+		if (column == last)
+			mask &= rightMask;
+
+		uint16_t address = _graphics + y * _stride + column;
+
+		if (mask == 0xFF)
+		{
+			setCursor(address);
+			memoryFill(value, h);
+
+			if (_shadow)
+			{
+				for (uint16_t i = 0; i < h; i++)
+					_shadow[address - _graphics + i * _stride] = value;
+			}
+			continue;
+		}
+
+		// Partial column: read it back a chunk at a time and merge
+		for (uint16_t done = 0; done < h; )
+		{
+			uint16_t n = h - done;
+			if (n > sizeof(buffer))
+				n = sizeof(buffer);
+
+			uint16_t chunk = address + done * _stride;
+			readBack(chunk, buffer, n, true);
+
+			for (uint16_t i = 0; i < n; i++)
+				buffer[i] = (buffer[i] & ~mask) | (value & mask);
+
+			setCursor(chunk);
+			memoryWrite(buffer, n);
+
+			if (_shadow)
+			{
+				for (uint16_t i = 0; i < n; i++)
+					_shadow[chunk - _graphics + i * _stride] = buffer[i];
+			}
+			done += n;
+		}
+	}
+
+	setCursorDirection(S1D13700_CURSOR_RIGHT);
+}
+
+// Bresenham, with each straight run sent as one fill
+void ParallelS1D13700::drawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, bool on)
+{
+	int32_t dx = (x1 > x0) ? x1 - x0 : x0 - x1;
+	int32_t dy = (y1 > y0) ? y1 - y0 : y0 - y1;
+	int32_t sx = (x0 < x1) ? 1 : -1;
+	int32_t sy = (y0 < y1) ? 1 : -1;
+	int32_t err = dx - dy;
+	bool shallow = dx >= dy;
+
+	int32_t x = x0;
+	int32_t y = y0;
+	int32_t runX = x;
+	int32_t runY = y;
+
+	for (;;)
+	{
+		bool end = (x == x1) && (y == y1);
+		int32_t nx = x;
+		int32_t ny = y;
+
+		if (!end)
+		{
+			int32_t e2 = 2 * err;
+			if (e2 > -dy)
+			{
+				err -= dy;
+				nx += sx;
+			}
+			if (e2 < dx)
+			{
+				err += dx;
+				ny += sy;
+			}
+		}
+
+		if (shallow && (end || (ny != y)))
+		{
+			uint16_t left = (runX < x) ? runX : x;
+			fillRect(left, y, (uint16_t)(((runX < x) ? x - runX : runX - x) + 1), 1, on);
+			runX = nx;
+		}
+		else if (!shallow && (end || (nx != x)))
+		{
+			uint16_t top = (runY < y) ? runY : y;
+			fillRect(x, top, 1, (uint16_t)(((runY < y) ? y - runY : runY - y) + 1), on);
+			runY = ny;
+		}
+
+		if (end)
+			break;
+
+		x = nx;
+		y = ny;
+	}
+}
+
+void ParallelS1D13700::drawRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, bool on)
+{
+	if ((w == 0) || (h == 0))
+		return;
+
+	fillRect(x, y, w, 1, on);
+	if (h > 1)
+		fillRect(x, y + h - 1, w, 1, on);
+	if (h > 2)
+	{
+		fillRect(x, y + 1, 1, h - 2, on);
+		fillRect(x + w - 1, y + 1, 1, h - 2, on);
+	}
+}
+
+void ParallelS1D13700::blit(uint16_t x, uint16_t y, const uint8_t *src, uint16_t w,
+                            uint16_t h, uint16_t srcStride)
+{
+	if ((x >= _width) || (y >= _height) || (w == 0) || (h == 0))
+		return;
+	if (w > _width - x)
+		w = _width - x;
+	if (h > _height - y)
+		h = _height - y;
+
+	uint16_t first = x >> 3;
+	uint16_t columns = ((x + w - 1) >> 3) - first + 1;
+	uint16_t srcBytes = (w + 7) >> 3;
+	uint8_t shift = x & 7;
+	uint8_t leftMask = 0xFF >> shift;
+	uint8_t rightMask = 0xFF << (7 - ((x + w - 1) & 7));
+	uint8_t row[PARALLEL_S1D13700_MAX_ROW];
+
+	if (columns > sizeof(row))
+		return;
+	if (columns == 1)
+		leftMask = rightMask = leftMask & rightMask;
+
+	for (uint16_t r = 0; r < h; r++, src += srcStride)
+	{
+		uint16_t address = graphicsAddress(x, y + r);
+
+		// shift the source bits into place
+		for (uint16_t i = 0; i < columns; i++)
+		{
+			uint8_t hi = (i > 0) ? src[i - 1] : 0;
+			uint8_t lo = (i < srcBytes) ? src[i] : 0;
+			row[i] = (uint8_t)((hi << (8 - shift)) | (lo >> shift));
+		}
+
+		if (leftMask != 0xFF)
+		{
+			uint8_t cur;
+			readBack(address, &cur, 1, false);
+			row[0] = (cur & ~leftMask) | (row[0] & leftMask);
+		}
+		if ((columns > 1) && (rightMask != 0xFF))
+		{
+			uint8_t cur;
+			readBack(address + columns - 1, &cur, 1, false);
+			row[columns - 1] = (cur & ~rightMask) | (row[columns - 1] & rightMask);
+		}
+
+		writeRow(address, row, columns);
+	}
+}
+
+// Moves screen block 2 (graphics) to x, y of the virtual screen.  Whole
+// bytes come from the start address, the last 0-7 pixels from HDOT SCR.
+void ParallelS1D13700::setScroll(uint16_t x, uint16_t y)
+{
+	uint16_t start = graphicsAddress(x, y);
+	uint8_t lines = (uint8_t)(_lines - 1);
+
+	command(S1D13700_SCROLL, _text, _text >> 8, lines, start, start >> 8, lines);
+	command(S1D13700_HDOT_SCR, x & 7);
+}
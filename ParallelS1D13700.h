@@ -0,0 +1,190 @@
+/*
+  ParallelS1D13700.h
+
+  Driver for the EPSON S1D13700 LCD controller (e.g. the CrystalFontz
+  CFAG320240 family) on the parallel bus in 8080 mode, with A0 on the
+  first address line: A0 high selects the command register, A0 low the
+  parameter/data register.  Reads with A0 high return display memory and
+  with A0 low the status flag.
+
+    ParallelS1D13700 lcd(Parallel);
+    lcd.begin();
+    lcd.clear();
+    lcd.drawText(0, 0, "Hello");
+    lcd.fillRect(10, 20, 100, 50, true);
+    lcd.displayOn();
+
+  The drawing functions keep bus traffic down by letting the controller do
+  the addressing: the cursor auto-increments along a run (or down a column
+  of bytes when that is shorter), solid runs go out as fill()s and only
+  the partial bytes at the ends of a span are merged.  Merging needs the
+  bytes already on the panel, which are read back from the controller
+  unless a shadow copy of the graphics layer is given with setShadow().
+
+  Scrolling moves the start address of the graphics screen block (and the
+  HDOT SCR fine scroll for sub-byte horizontal offsets), so no pixel data
+  is rewritten.  Drawing coordinates are in the virtual screen set by 
+  setLayout(); rows past the visible 240 are shown by scrolling down.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PARALLEL_S1D13700_H
+#define PARALLEL_S1D13700_H
+
+#include "ParallelDevice.h"
+
+// Command codes
+#define S1D13700_SYSTEM_SET		0x40
+#define S1D13700_POWER_SAVE		0x53
+#define S1D13700_DISP_OFF		0x58
+#define S1D13700_DISP_ON		0x59
+#define S1D13700_SCROLL			0x44
+#define S1D13700_CSRFORM		0x5D
+#define S1D13700_CSRDIR			0x4C	// + direction
+#define S1D13700_OVLAY			0x5B
+#define S1D13700_CGRAM_ADR		0x5C
+#define S1D13700_HDOT_SCR		0x5A
+#define S1D13700_CSRW			0x46
+#define S1D13700_CSRR			0x47
+#define S1D13700_GRAYSCALE		0x60
+#define S1D13700_MWRITE			0x42
+#define S1D13700_MREAD			0x43
+
+// Cursor auto-increment directions for setCursorDirection()
+typedef enum
+{
+	S1D13700_CURSOR_RIGHT = 0,
+	S1D13700_CURSOR_LEFT = 1,
+	S1D13700_CURSOR_UP = 2,
+	S1D13700_CURSOR_DOWN = 3
+} S1D13700CursorDirection_t;
+
+// How the text and graphics layers are combined (OVLAY MX bits)
+typedef enum
+{
+	S1D13700_OVERLAY_OR = 0,
+	S1D13700_OVERLAY_XOR = 1,
+	S1D13700_OVERLAY_AND = 2,
+	S1D13700_OVERLAY_PRIORITY_OR = 3
+} S1D13700Overlay_t;
+
+// Longest row, in bytes, that blit() handles
+#ifndef PARALLEL_S1D13700_MAX_ROW
+#define PARALLEL_S1D13700_MAX_ROW	80
+#endif
+
+class ParallelS1D13700 : public ParallelIndexedDevice {
+public:
+  ParallelS1D13700(ParallelClass &bus);
+
+  // Sets up a 320x240 panel: text layer at 0x0000, graphics at 0x0960,
+  // display off.  Pass a table to use a different configuration, and 
+  // describe it with setLayout().
+  void begin();
+  void begin(const uint8_t *table, size_t length) { initialize(table, length); }
+
+  // Display memory layout: text and graphics layer addresses, bytes per row
+  // (the AP parameter of SYSTEM SET), graphics width and virtual height in
+  // pixels, and the number of lines on the panel.  Text uses 8x8 characters.
+  void setLayout(uint16_t textAddress, uint16_t graphicsAddress, uint8_t stride,
+                 uint16_t width, uint16_t height, uint16_t lines);
+
+  // Optional copy of the graphics layer in SRAM, stride * height bytes,
+  // used instead of reading the panel back.  Call clear() after setting it,
+  // or fill it with what the panel shows.
+  void setShadow(uint8_t *shadow) { _shadow = shadow; }
+
+  void setCursor(uint16_t address)
+  {
+    command(S1D13700_CSRW, address, address >> 8);
+  }
+  void setCursorDirection(S1D13700CursorDirection_t direction)
+  {
+    command(S1D13700_CSRDIR + direction);
+  }
+
+  // Display memory access from the cursor onwards
+  void memoryWrite(const uint8_t *src, size_t n)
+  {
+    command(S1D13700_MWRITE);
+    writeData(src, n);
+  }
+  void memoryFill(uint8_t value, size_t n)
+  {
+    command(S1D13700_MWRITE);
+    fillData(value, n);
+  }
+  void memoryRead(uint8_t *dst, size_t n)
+  {
+    command(S1D13700_MREAD);
+    readData(dst, n);
+  }
+
+  // attributes: layer enables and flash rates (FP bits of DISP ON)
+  void displayOn(uint8_t attributes = 0x16) { command(S1D13700_DISP_ON, attributes); }
+  void displayOff() { command(S1D13700_DISP_OFF, 0x00); }
+
+  // Turns the text and graphics layers on or off
+  void setLayers(bool text, bool graphics)
+  {
+    displayOn((text ? 0x04 : 0x00) | (graphics ? 0x10 : 0x00));
+  }
+  void setOverlay(S1D13700Overlay_t mode) { command(S1D13700_OVLAY, mode); }
+
+  // Text layer, using the internal character generator
+  void drawText(uint8_t column, uint8_t row, const char *text);
+  void clearText();
+
+  // Graphics layer
+  void clear(bool on = false);
+  void setPixel(uint16_t x, uint16_t y, bool on);
+  void fillRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, bool on);
+  void drawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, bool on);
+  void drawRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, bool on);
+
+  // Copies a w x h 1bpp image (MSB is the leftmost pixel, rows srcStride 
+  // bytes apart) to x, y
+  void blit(uint16_t x, uint16_t y, const uint8_t *src, uint16_t w, uint16_t h,
+            uint16_t srcStride);
+
+  // Shows the graphics layer from x, y of the virtual screen
+  void setScroll(uint16_t x, uint16_t y);
+
+  // Busy flag (D6 of the status read), for use with setBusyPoll()
+  static bool busy(uint8_t status) { return (status & 0x40) != 0; }
+
+private:
+  uint16_t graphicsAddress(uint16_t x, uint16_t y)
+  {
+    return _graphics + y * _stride + (x >> 3);
+  }
+  void readBack(uint16_t address, uint8_t *dst, uint16_t n, bool down);
+  void writeRow(uint16_t address, const uint8_t *row, uint16_t n);
+  void fillRows(uint16_t first, uint16_t last, uint8_t leftMask, uint8_t rightMask,
+                uint16_t y, uint16_t h, uint8_t value);
+  void fillColumns(uint16_t first, uint16_t last, uint8_t leftMask, uint8_t rightMask,
+                   uint16_t y, uint16_t h, uint8_t value);
+
+  uint16_t _text;
+  uint16_t _graphics;
+  uint8_t _stride;
+  uint16_t _width;
+  uint16_t _height;
+  uint16_t _lines;
+  uint8_t *_shadow;
+};
+
+#endif
@@ -0,0 +1,138 @@
+/*
+  ParallelSequence.cpp
+
+  Builds a sequence of bus writes into a linked list of DMA descriptors.  See
+  ParallelSequence.h for usage.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ParallelSequence.h"
+
+#if PARALLEL_SEQUENCE_MAX_SEGMENTS > 255
+#error "PARALLEL_SEQUENCE_MAX_SEGMENTS must be 255 or less"
+#endif
+
+// Every segment copies from SRAM into a fixed SMC address, fetching the next
+// descriptor from memory when done.
+#define SEQUENCE_CTRLB	(DMAC_CTRLB_SRC_DSCR_FETCH_FROM_MEM \
+		| DMAC_CTRLB_DST_DSCR_FETCH_FROM_MEM \
+		| DMAC_CTRLB_FC_MEM2MEM_DMA_FC \
+		| DMAC_CTRLB_SRC_INCR_INCREMENTING \
+		| DMAC_CTRLB_DST_INCR_FIXED)
+
+ParallelSequence::ParallelSequence(ParallelClass &bus) : _bus(bus)
+{
+	clear();
+}
+
+void ParallelSequence::clear(void)
+{
+	_count = 0;
+	_bytes.clear();
+}
+
+bool ParallelSequence::add(uint32_t offset, uint8_t value)
+{
+	return _bytes.add(*this, offset, value);
+}
+
+// Grows the previous segment if it ends right where the byte at p was 
+// stored and targets the same register.
+bool ParallelSequence::extendRun(uint32_t offset, const uint8_t *p)
+{
+	uint32_t dest = _bus.getAddress() + (offset&0x00FFFFFF);
+	
+	if (_count == 0)
+		return false;
+	
+	ParallelDmaDescriptor_t *last = &_desc[_count-1];
+	uint32_t len = last->ctrlA & 0xFFFF;
+	
+	if ((last->destAddr != dest) 
+		|| (last->sourceAddr + len != PARALLEL_DMA_ADDR(p))
+		|| (len >= PARALLEL_DMA_MAX_BLOCK))
+		return false;
+	
+	last->ctrlA++;
+	return true;
+}
+
+bool ParallelSequence::add(uint32_t offset, const uint8_t *src, size_t n)
+{
+	uint32_t dest = _bus.getAddress() + (offset&0x00FFFFFF);
+	uint8_t saved = _count;
+	
+	while (n > 0)
+	{
+		size_t chunk = (n > PARALLEL_DMA_MAX_BLOCK) ? PARALLEL_DMA_MAX_BLOCK : n;
+		
+		if (!addSegment(dest, src, chunk))
+		{
+			// don't leave half a buffer in the sequence
+			_count = saved;
+			return false;
+		}
+		
+		src += chunk;
+		n -= chunk;
+	}
+	
+	return true;
+}
+
+bool ParallelSequence::addSegment(uint32_t dest, const uint8_t *src, size_t n)
+{
+	if (_count >= PARALLEL_SEQUENCE_MAX_SEGMENTS)
+		return false;
+	
+	ParallelDmaDescriptor_t *d = &_desc[_count];
+	
+	d->sourceAddr = PARALLEL_DMA_ADDR(src);
+	d->destAddr = dest;
+	d->ctrlA = DMAC_CTRLA_BTSIZE(n)
+		| DMAC_CTRLA_SRC_WIDTH_BYTE
+		| DMAC_CTRLA_DST_WIDTH_BYTE;
+	d->ctrlB = SEQUENCE_CTRLB;
+	d->nextDescriptor = 0;
+	
+	if (_count > 0)
+		_desc[_count-1].nextDescriptor = PARALLEL_DMA_ADDR(d);
+	
+	_count++;
+	return true;
+}
+
+uint32_t ParallelSequence::byteCount(void)
+{
+	uint32_t total = 0;
+	
+	for (int i=0; i < _count; i++)
+	{
+		total += _desc[i].ctrlA & 0xFFFF;
+	}
+	
+	return total;
+}
+
+const ParallelDmaDescriptor_t *ParallelSequence::descriptors(void)
+{
+	if (_count == 0)
+		return NULL;
+	
+	// the chain might have been cut short by a failed add()
+	_desc[_count-1].nextDescriptor = 0;
+	return &_desc[0];
+}
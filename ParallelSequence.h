@@ -0,0 +1,97 @@
+/*
+  ParallelSequence.h
+
+  Builds a sequence of bus writes (e.g. "command, parameters, command, pixel 
+  data" for an index addressed LCD controller) into a linked list of DMA 
+  descriptors so that the whole sequence runs as a single DMA job.  Each 
+  segment of the sequence has its own destination offset and length.
+
+    ParallelSequence seq(Parallel);
+    seq.add(0x01, 0x46);                 // CSRW
+    seq.add(0x00, 0x60);                 // cursor low
+    seq.add(0x00, 0x09);                 // cursor high (merged with above)
+    seq.add(0x01, 0x42);                 // MWRITE
+    seq.add(0x00, pixels, sizeof(pixels));
+    Parallel.writeAsync(seq);
+
+  Single bytes are copied into the sequence object, buffers are referenced
+  and must stay valid until the transfer completes.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PARALLEL_SEQUENCE_H
+#define PARALLEL_SEQUENCE_H
+
+#include "Parallel.h"
+
+// Maximum number of DMA descriptors (segments) in one sequence.  Buffers 
+// longer than PARALLEL_DMA_MAX_BLOCK take more than one descriptor.
+#ifndef PARALLEL_SEQUENCE_MAX_SEGMENTS
+#define PARALLEL_SEQUENCE_MAX_SEGMENTS	16
+#endif
+
+// Storage for single byte writes (commands and their parameters)
+#ifndef PARALLEL_SEQUENCE_MAX_BYTES
+#define PARALLEL_SEQUENCE_MAX_BYTES		32
+#endif
+
+// Linked list item as read by the DMAC.  Layout is fixed by the hardware.
+typedef struct
+{
+	ParallelDmaAddr_t sourceAddr;
+	ParallelDmaAddr_t destAddr;
+	uint32_t ctrlA;
+	uint32_t ctrlB;
+	ParallelDmaAddr_t nextDescriptor;
+} ParallelDmaDescriptor_t;
+
+class ParallelSequence {
+public:
+  ParallelSequence(ParallelClass &bus);
+  
+  // Empties the sequence so it can be built again
+  void clear();
+  
+  // Appends a single byte write.  Consecutive bytes to the same offset are 
+  // merged into one segment.  Returns false if the sequence is full.
+  bool add(uint32_t offset, uint8_t value);
+  
+  // Appends a buffer write to a single offset.  Returns false if full.
+  bool add(uint32_t offset, const uint8_t *src, size_t n);
+  
+  // Number of DMA descriptors the sequence currently uses
+  uint8_t segmentCount() { return _count; }
+  
+  // Total number of bytes the sequence puts on the bus
+  uint32_t byteCount();
+  
+  // First descriptor of the chain (NULL if empty).  Terminates the chain, 
+  // used by ParallelClass::writeAsync().
+  const ParallelDmaDescriptor_t *descriptors();
+
+private:
+  template <size_t> friend class ParallelByteStore;
+
+  bool extendRun(uint32_t offset, const uint8_t *p);
+  bool addSegment(uint32_t dest, const uint8_t *src, size_t n);
+
+  ParallelClass &_bus;
+  ParallelDmaDescriptor_t _desc[PARALLEL_SEQUENCE_MAX_SEGMENTS] __attribute__((aligned(4)));
+  ParallelByteStore<PARALLEL_SEQUENCE_MAX_BYTES> _bytes;
+  uint8_t _count;
+};
+
+#endif
@@ -0,0 +1,932 @@
+/*
+  ParallelSim.cpp
+
+  Host (Linux) model of the SAM3X static memory controller, its DMA
+  controller, the timer counters and the bits of the Arduino core the
+  library calls.  Only
+  compiled when PARALLEL_HOST_SIM is defined, see ParallelSim.h.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifdef PARALLEL_HOST_SIM
+
+#include "ParallelSim.h"
+#include "ParallelSequence.h"
+
+// Chip select windows on the external bus
+#define SIM_BUS_BASE	0x60000000u
+#define SIM_BUS_END		0x64000000u
+
+Smc parallelSimSmc;
+Dmac parallelSimDmac;
+Pio parallelSimPio[4];
+DWT_Type parallelSimDwt;
+Tc parallelSimTc[3];
+Efc parallelSimEfc[2];
+CoreDebug_Type parallelSimCoreDebug;
+uint8_t parallelSimNfcRam[4224];
+uint8_t parallelSimFlash1[256 * 1024];
+
+ParallelSimSerial Serial;
+ParallelSimClass ParallelSim;
+
+// Arduino core ----------------------------------------------------------------
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+	size_t n = 0;
+
+	while (size--)
+		n += write(*buffer++);
+	return n;
+}
+
+size_t Print::print(const char *s)
+{
+	return write((const uint8_t *)s, strlen(s));
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+	char buf[8 * sizeof(long) + 1];
+	char *p = &buf[sizeof(buf) - 1];
+
+	if (base < 2)
+		base = 10;
+
+	*p = '\0';
+	do
+	{
+		unsigned long digit = n % base;
+		*--p = (char)((digit < 10) ? '0' + digit : 'A' + digit - 10);
+		n /= base;
+	} while (n);
+
+	return print(p);
+}
+
+size_t Print::print(long n, int base)
+{
+	if ((n < 0) && (base == DEC))
+		return print("-") + print((unsigned long)-n, base);
+	return print((unsigned long)n, base);
+}
+
+size_t Print::print(double n, int digits)
+{
+	char buf[32];
+
+	snprintf(buf, sizeof(buf), "%.*f", digits, n);
+	return print(buf);
+}
+
+size_t Print::println(void)
+{
+	return print("\r\n");
+}
+
+uint32_t PIO_Configure(Pio *pPio, const EPioType dwType, const uint32_t dwMask,
+                       const uint32_t dwAttribute)
+{
+	(void)pPio;
+	(void)dwType;
+	(void)dwMask;
+	(void)dwAttribute;
+	return 1;
+}
+
+uint32_t pmc_enable_periph_clk(uint32_t ul_id)
+{
+	(void)ul_id;
+	return 0;
+}
+
+// Time only moves with the model clock
+uint32_t micros(void)
+{
+	return (uint32_t)(ParallelSim.cycles() / (VARIANT_MCK / 1000000));
+}
+
+uint32_t millis(void)
+{
+	return (uint32_t)(ParallelSim.cycles() / (VARIANT_MCK / 1000));
+}
+
+void delay(uint32_t ms)
+{
+	ParallelSim.advance((uint64_t)ms * (VARIANT_MCK / 1000));
+}
+
+void delayMicroseconds(uint32_t us)
+{
+	ParallelSim.advance((uint64_t)us * (VARIANT_MCK / 1000000));
+}
+
+// Timer channels are numbered 0-8 across TC0-TC2
+static uint8_t simTimerIndex(Tc *pTc, uint32_t dwChannel)
+{
+	return (uint8_t)((pTc - parallelSimTc) * 3 + dwChannel);
+}
+
+void TC_Configure(Tc *pTc, uint32_t dwChannel, uint32_t dwMode)
+{
+	TcChannel &c = pTc->TC_CHANNEL[dwChannel];
+
+	ParallelSim.timerStop(simTimerIndex(pTc, dwChannel));
+	c.TC_IER = 0;
+	c.TC_IDR = 0;
+	c.TC_IMR = 0;
+	c.TC_SR = 0;
+	c.TC_CMR = dwMode;
+}
+
+void TC_Start(Tc *pTc, uint32_t dwChannel)
+{
+	ParallelSim.timerStart(simTimerIndex(pTc, dwChannel));
+}
+
+void TC_Stop(Tc *pTc, uint32_t dwChannel)
+{
+	ParallelSim.timerStop(simTimerIndex(pTc, dwChannel));
+}
+
+void TC_SetRC(Tc *pTc, uint32_t dwChannel, uint32_t dwValue)
+{
+	pTc->TC_CHANNEL[dwChannel].TC_RC = dwValue;
+}
+
+// Reading the status clears the compare flag
+uint32_t TC_GetStatus(Tc *pTc, uint32_t dwChannel)
+{
+	uint32_t status = pTc->TC_CHANNEL[dwChannel].TC_SR;
+
+	pTc->TC_CHANNEL[dwChannel].TC_SR = status & ~TC_SR_CPCS;
+	return status;
+}
+
+// Erase and write page takes a few milliseconds on the SAM3X
+uint32_t efc_perform_command(Efc *p_efc, uint32_t ul_command, uint32_t ul_argument)
+{
+	if ((p_efc != EFC1) || (ul_command != EFC_FCMD_EWP)
+		|| (ul_argument >= IFLASH1_NB_OF_PAGES))
+		return EFC_RC_ERROR;
+
+	p_efc->EEFC_FCR = ul_command | (ul_argument << 8);
+	ParallelSim.advance(4 * (VARIANT_MCK / 1000));
+	return EFC_RC_OK;
+}
+
+// Handlers the program doesn't define
+extern "C" __attribute__((weak)) void TC0_Handler(void) {}
+extern "C" __attribute__((weak)) void TC1_Handler(void) {}
+extern "C" __attribute__((weak)) void TC2_Handler(void) {}
+extern "C" __attribute__((weak)) void TC3_Handler(void) {}
+extern "C" __attribute__((weak)) void TC4_Handler(void) {}
+extern "C" __attribute__((weak)) void TC5_Handler(void) {}
+extern "C" __attribute__((weak)) void TC6_Handler(void) {}
+extern "C" __attribute__((weak)) void TC7_Handler(void) {}
+extern "C" __attribute__((weak)) void TC8_Handler(void) {}
+
+// Devices ---------------------------------------------------------------------
+
+uint16_t ParallelSimMemory::read(uint32_t offset, uint8_t width)
+{
+	uint16_t value = 0;
+
+	for (uint8_t i = 0; i < width; i++)
+	{
+		if (offset + i < data.size())
+			value |= (uint16_t)data[offset + i] << (8 * i);
+	}
+	return value;
+}
+
+void ParallelSimMemory::write(uint32_t offset, uint16_t value, uint8_t width)
+{
+	if (offset + width > data.size())
+		data.resize(offset + width, 0);
+
+	for (uint8_t i = 0; i < width; i++)
+		data[offset + i] = (uint8_t)(value >> (8 * i));
+}
+
+ParallelSimTimedMemory::ParallelSimTimedMemory(uint32_t setup, uint32_t pulse,
+	uint32_t access, uint32_t hold, uint32_t cycle) :
+	minSetup(setup), minPulse(pulse), minAccess(access), minHold(hold), 
+	minCycle(cycle), violations(0), _ok(true), _bus(0)
+{
+}
+
+void ParallelSimTimedMemory::timing(const ParallelSimAccess_t &a)
+{
+	uint32_t pulse = a.strobeRise - a.strobeFall;
+
+	_ok = (a.strobeFall >= minSetup)
+		&& (pulse >= (a.read ? minAccess : minPulse))
+		&& ((uint32_t)(a.cycle - a.strobeRise) >= minHold)
+		&& (a.cycle >= minCycle);
+
+	if (!_ok)
+		violations++;
+}
+
+uint16_t ParallelSimTimedMemory::read(uint32_t offset, uint8_t width)
+{
+	if (_ok)
+		_bus = ParallelSimMemory::read(offset, width);
+
+	return _bus;
+}
+
+void ParallelSimTimedMemory::write(uint32_t offset, uint16_t value, uint8_t width)
+{
+	if (_ok)
+		ParallelSimMemory::write(offset, value, width);
+
+	_bus = value;
+}
+
+ParallelSimNand::ParallelSimNand(uint16_t pageSize, uint16_t spareSize,
+                                 uint16_t pagesPerBlock, uint16_t blocks) :
+	readTime(25 * (VARIANT_MCK / 1000000)),
+	programTime(200 * (VARIANT_MCK / 1000000)),
+	eraseTime(2000 * (VARIANT_MCK / 1000000)),
+	reads(0), programs(0), erases(0),
+	data((size_t)(pageSize + spareSize) * pagesPerBlock * blocks, 0xFF),
+	failing(blocks, false),
+	_pageSize(pageSize), _spareSize(spareSize), _pagesPerBlock(pagesPerBlock),
+	_blocks(blocks), _state(IDLE), _lastCommand(0), _addressCount(0), _column(0),
+	_status(0x80), _readyAt(0), _powerFail(0xFFFFFFFF), _off(false),
+	_register(pageSize + spareSize, 0xFF)
+{
+	_rowCycles = ((uint32_t)pagesPerBlock * blocks > 0x10000) ? 3 : 2;
+	memset(_address, 0, sizeof(_address));
+}
+
+uint32_t ParallelSimNand::busyCycles()
+{
+	uint64_t now = ParallelSim.cycles();
+	return (_readyAt > now) ? (uint32_t)(_readyAt - now) : 0;
+}
+
+void ParallelSimNand::busy(uint32_t cycles)
+{
+	_readyAt = ParallelSim.cycles() + cycles;
+}
+
+// Erase only takes row address cycles, everything else has the column first
+uint32_t ParallelSimNand::row()
+{
+	const uint8_t *a = (_lastCommand == 0x60) ? _address : _address + 2;
+	uint32_t r = 0;
+
+	for (uint8_t i = 0; i < _rowCycles; i++)
+		r |= (uint32_t)a[i] << (8 * i);
+	return r;
+}
+
+void ParallelSimNand::command(uint8_t cmd)
+{
+	uint32_t pages = (uint32_t)_pagesPerBlock * _blocks;
+	size_t size = _pageSize + _spareSize;
+
+	if (_off)
+		return;
+
+	switch (cmd)
+	{
+	case 0xFF:		// reset
+		_state = IDLE;
+		_status = 0x80;
+		busy(5 * (VARIANT_MCK / 1000000));
+		break;
+
+	case 0x90:		// read ID
+	case 0x60:		// erase setup
+		_lastCommand = cmd;
+		_addressCount = 0;
+		_column = 0;
+		_state = (cmd == 0x90) ? ID : ADDRESS;
+		break;
+
+	case 0x70:		// read status
+		_state = STATUS;
+		break;
+
+	case 0x00:		// read setup, or back to data output after a status read
+		_lastCommand = cmd;
+		_addressCount = 0;
+		_state = DATA_OUT;
+		break;
+
+	case 0x30:		// read confirm
+		if (row() < pages)
+		{
+			memcpy(&_register[0], page(row()), size);
+			reads++;
+		}
+		busy(readTime);
+		_state = DATA_OUT;
+		break;
+
+	case 0x80:		// program setup
+		_lastCommand = cmd;
+		_register.assign(size, 0xFF);
+		_addressCount = 0;
+		_column = 0;
+		_state = DATA_IN;
+		break;
+
+	case 0x10:		// program confirm: bits can only be cleared
+		_status = 0x80;
+		if (row() < pages)
+		{
+			if (failing[row() / _pagesPerBlock])
+				_status |= 0x01;
+			else
+			{
+				uint8_t *p = page(row());
+				size_t n = (_powerFail == 0) ? size / 2 : size;
+
+				for (size_t i = 0; i < n; i++)
+					p[i] &= _register[i];
+			}
+			programs++;
+		}
+		busy(programTime);
+		_state = IDLE;
+		powerCountdown();
+		break;
+
+	case 0xD0:		// erase confirm
+		_status = 0x80;
+		if (row() < pages)
+		{
+			uint16_t block = row() / _pagesPerBlock;
+
+			if (failing[block])
+				_status |= 0x01;
+			else if (_powerFail == 0)
+				memset(page((uint32_t)block * _pagesPerBlock), 0xFF, size * _pagesPerBlock / 2);
+			else
+				memset(page((uint32_t)block * _pagesPerBlock), 0xFF, size * _pagesPerBlock);
+			erases++;
+		}
+		busy(eraseTime);
+		_state = IDLE;
+		powerCountdown();
+		break;
+	}
+}
+
+void ParallelSimNand::powerCountdown()
+{
+	if (_powerFail == 0)
+		_off = true;
+	else if (_powerFail != 0xFFFFFFFF)
+		_powerFail--;
+}
+
+uint16_t ParallelSimNand::read(uint32_t offset, uint8_t width)
+{
+	static const uint8_t id[] = { 0x2C, 0xDA, 0x90, 0x95, 0x06 };
+
+	(void)offset;
+	(void)width;
+
+	if (_off)
+		return 0x00;
+
+	switch (_state)
+	{
+	case STATUS:
+		return _status | (busyCycles() ? 0x00 : 0x40);
+	case ID:
+		return (_column < sizeof(id)) ? id[_column++] : 0x00;
+	case DATA_OUT:
+		if (_column < _register.size())
+			return _register[_column++];
+		break;
+	default:
+		break;
+	}
+	return 0xFF;
+}
+
+void ParallelSimNand::write(uint32_t offset, uint16_t value, uint8_t width)
+{
+	uint8_t v = (uint8_t)value;
+
+	(void)width;
+
+	if (offset & PARALLEL_SIM_NAND_CLE)
+	{
+		command(v);
+	}
+	else if (offset & PARALLEL_SIM_NAND_ALE)
+	{
+		if (_addressCount < sizeof(_address))
+			_address[_addressCount++] = v;
+
+		if ((_addressCount == 2) && (_lastCommand != 0x60))
+			_column = _address[0] | ((uint32_t)_address[1] << 8);
+	}
+	else if ((_state == DATA_IN) && (_column < _register.size()))
+	{
+		_register[_column++] = v;
+	}
+}
+
+void ParallelSimNand::flipBit(uint32_t n, uint32_t column, uint8_t bit)
+{
+	page(n)[column] ^= (uint8_t)(1 << bit);
+}
+
+void ParallelSimNand::setFactoryBad(uint16_t block)
+{
+	page((uint32_t)block * _pagesPerBlock)[_pageSize] = 0x00;
+}
+
+void ParallelSimNand::failBlock(uint16_t block)
+{
+	failing[block] = true;
+}
+
+// Bus model -------------------------------------------------------------------
+
+ParallelSimClass::ParallelSimClass() :
+	_cycles(0), _tracing(false), _traceLimit(0), _dmaActive(false), _dmaPending(0),
+	_timerActive(false)
+{
+	for (int i = 0; i < 4; i++)
+		_devices[i] = &_memories[i];
+
+	// erased, and left alone by reset()
+	memset(parallelSimFlash1, 0xFF, sizeof(parallelSimFlash1));
+	reset();
+}
+
+void ParallelSimClass::reset()
+{
+	memset((void *)&parallelSimSmc, 0, sizeof(parallelSimSmc));
+	memset((void *)&parallelSimDmac, 0, sizeof(parallelSimDmac));
+	memset((void *)parallelSimPio, 0, sizeof(parallelSimPio));
+	memset((void *)&parallelSimDwt, 0, sizeof(parallelSimDwt));
+	memset((void *)parallelSimTc, 0, sizeof(parallelSimTc));
+
+	// SMC reset values
+	for (int cs = 0; cs < 8; cs++)
+	{
+		SMC->SMC_CS_NUMBER[cs].SMC_SETUP = 0x01010101;
+		SMC->SMC_CS_NUMBER[cs].SMC_PULSE = 0x01010101;
+		SMC->SMC_CS_NUMBER[cs].SMC_CYCLE = 0x00030003;
+		SMC->SMC_CS_NUMBER[cs].SMC_MODE = 0x10000003;
+	}
+
+	PIOA->PIO_PDSR = PIO_PA4B_NWAIT;
+
+	for (int cs = 0; cs < 8; cs++)
+		_page[cs] = 0xFFFFFFFF;
+
+	_cycles = 0;
+	_trace.clear();
+
+	for (int i = 0; i < 4; i++)
+		_memories[i].data.clear();
+}
+
+void ParallelSimClass::attach(uint8_t cs, ParallelSimDevice *device)
+{
+	if (cs < 4)
+		_devices[cs] = device ? device : &_memories[cs];
+}
+
+void ParallelSimClass::advance(uint64_t cycles)
+{
+	_cycles += cycles;
+
+	if (DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)
+		DWT->CYCCNT += (uint32_t)cycles;
+
+	runTimers();
+}
+
+void ParallelSimClass::setWait(bool asserted)
+{
+	if (asserted)
+		PIOA->PIO_PDSR &= ~PIO_PA4B_NWAIT;
+	else
+		PIOA->PIO_PDSR |= PIO_PA4B_NWAIT;
+}
+
+void ParallelSimClass::setTrace(bool enable, size_t limit)
+{
+	_tracing = enable;
+	_traceLimit = limit;
+}
+
+void ParallelSimClass::dumpTrace(FILE *out)
+{
+	for (size_t i = 0; i < _trace.size(); i++)
+	{
+		const ParallelSimAccess_t &a = _trace[i];
+
+		fprintf(out, "%10llu CS%u %c %06X %0*X  ncs %u-%u %s %u-%u cycle %u\n",
+			(unsigned long long)a.start, a.cs, a.read ? 'R' : 'W',
+			(unsigned)(a.address & 0x00FFFFFF), a.width * 2, a.data,
+			a.ncsFall, a.ncsRise, a.read ? "nrd" : "nwe",
+			a.strobeFall, a.strobeRise, a.cycle);
+	}
+}
+
+uint16_t ParallelSimClass::read(uint32_t address, uint8_t width)
+{
+	return (uint16_t)access(address, true, 0, width);
+}
+
+void ParallelSimClass::write(uint32_t address, uint16_t data, uint8_t width)
+{
+	access(address, false, data, width);
+}
+
+// One access: the edges come from the chip select's SETUP/PULSE/CYCLE
+// registers and the clock advances by the cycle length, which the SMC
+// stretches when it is shorter than the strobe or NCS pulse.
+uint32_t ParallelSimClass::access(uint32_t address, bool read, uint16_t data, uint8_t width)
+{
+	uint8_t cs = (uint8_t)((address - SIM_BUS_BASE) >> 24) & 0x07;
+	uint32_t offset = address & 0x00FFFFFF;
+	const SmcCs_number &r = SMC->SMC_CS_NUMBER[cs];
+
+	uint32_t shift = read ? 16 : 0;
+	uint32_t setup = decodeSetup((r.SMC_SETUP >> shift) & 0x3F);
+	uint32_t ncsSetup = decodeSetup((r.SMC_SETUP >> (shift + 8)) & 0x3F);
+	uint32_t pulse = decodePulse((r.SMC_PULSE >> shift) & 0x7F);
+	uint32_t ncsPulse = decodePulse((r.SMC_PULSE >> (shift + 8)) & 0x7F);
+	uint32_t cycle = decodeCycle((r.SMC_CYCLE >> shift) & 0x1FF);
+
+	// Page mode reads take NCS_RD_PULSE for the first access to a page and
+	// NRD_PULSE for the rest, with no setup.  Any other access ends the run.
+	if (read && (r.SMC_MODE & SMC_MODE_PMEN))
+	{
+		uint32_t pageSize = 4u << ((r.SMC_MODE & SMC_MODE_PS_Msk) >> 28);
+		uint32_t page = offset & ~(pageSize - 1);
+
+		if (page != _page[cs])
+			pulse = ncsPulse;
+
+		_page[cs] = page;
+		setup = 0;
+		ncsSetup = 0;
+		ncsPulse = pulse;
+		cycle = pulse;
+	}
+	else
+	{
+		_page[cs] = 0xFFFFFFFF;
+	}
+
+	if (cycle < setup + pulse)
+		cycle = setup + pulse;
+	if (cycle < ncsSetup + ncsPulse)
+		cycle = ncsSetup + ncsPulse;
+	if (cycle == 0)
+		cycle = 1;
+
+	ParallelSimDevice *device = (cs < 4) ? _devices[cs] : &_memories[0];
+
+	if ((r.SMC_MODE & SMC_MODE_EXNW_MODE_Msk) != SMC_MODE_EXNW_MODE_DISABLED)
+	{
+		uint32_t wait = device->waitCycles(offset, read);
+
+		pulse += wait;
+		ncsPulse += wait;
+		cycle += wait;
+	}
+
+	ParallelSimAccess_t a;
+
+	a.start = _cycles;
+	a.address = address;
+	a.data = 0;
+	a.cs = cs;
+	a.width = width;
+	a.read = read;
+	a.ncsFall = (uint16_t)ncsSetup;
+	a.ncsRise = (uint16_t)(ncsSetup + ncsPulse);
+	a.strobeFall = (uint16_t)setup;
+	a.strobeRise = (uint16_t)(setup + pulse);
+	a.cycle = (uint16_t)cycle;
+	device->timing(a);
+
+	if (read)
+		data = device->read(offset, width);
+	else
+		device->write(offset, data, width);
+
+	if (_tracing && (_trace.size() < _traceLimit))
+	{
+		a.data = data;
+		_trace.push_back(a);
+	}
+
+	advance(cycle);
+	return data;
+}
+
+// DMA model -------------------------------------------------------------------
+
+static bool simIsBus(uintptr_t address)
+{
+	return (address >= SIM_BUS_BASE) && (address < SIM_BUS_END);
+}
+
+void ParallelSimClass::dmaBlock(uintptr_t src, uintptr_t dst, uint32_t ctrlA, uint32_t ctrlB)
+{
+	uint32_t srcWidth = 1u << ((ctrlA & DMAC_CTRLA_SRC_WIDTH_Msk) >> 24);
+	uint32_t dstWidth = 1u << ((ctrlA & DMAC_CTRLA_DST_WIDTH_Msk) >> 28);
+	uint32_t bytes = (ctrlA & DMAC_CTRLA_BTSIZE_Msk) * srcWidth;
+	bool srcFixed = (ctrlB & DMAC_CTRLB_SRC_INCR_Msk) == DMAC_CTRLB_SRC_INCR_FIXED;
+	bool dstFixed = (ctrlB & DMAC_CTRLB_DST_INCR_Msk) == DMAC_CTRLB_DST_INCR_FIXED;
+
+	// The bus sees destination width accesses, 1 or 2 bytes here
+	uint8_t unit = (dstWidth >= 2) ? 2 : 1;
+
+	for (uint32_t i = 0; i < bytes; i += unit)
+	{
+		uint16_t value;
+		uintptr_t s = src + (srcFixed ? 0 : i);
+		uintptr_t d = dst + (dstFixed ? 0 : i);
+
+		if (simIsBus(s))
+			value = (uint16_t)access((uint32_t)s, true, 0, unit);
+		else
+			value = (unit == 2) ? *(const uint16_t *)s : *(const uint8_t *)s;
+
+		if (simIsBus(d))
+			access((uint32_t)d, false, value, unit);
+		else if (unit == 2)
+			*(uint16_t *)d = value;
+		else
+			*(uint8_t *)d = (uint8_t)value;
+	}
+}
+
+// Runs the transfer programmed on a channel to completion, then raises its
+// interrupt.  A handler that starts the channel again (the next chunk of a
+// long buffer) is picked up by the loop instead of recursing.  A transfer
+// started from a timer handler runs once the handler returns, so timer 
+// interrupts carry on while it moves data, as they would on the board.
+void ParallelSimClass::runDma(uint8_t channel)
+{
+	_dmaPending |= 1u << channel;
+
+	if (_dmaActive || _timerActive)
+		return;
+
+	_dmaActive = true;
+
+	while (_dmaPending)
+	{
+		uint8_t ch = (uint8_t)__builtin_ctz(_dmaPending);
+		_dmaPending &= ~(1u << ch);
+
+		if (!(DMAC->DMAC_EN & DMAC_EN_ENABLE))
+			continue;
+
+		DmacCh_num &c = DMAC->DMAC_CH_NUM[ch];
+		uint32_t status;
+
+		if (c.DMAC_CTRLB & DMAC_CTRLB_SRC_DSCR)
+		{
+			dmaBlock(c.DMAC_SADDR, c.DMAC_DADDR, c.DMAC_CTRLA, c.DMAC_CTRLB);
+			status = DMAC_EBCISR_BTC0 << ch;
+		}
+		else
+		{
+			const ParallelDmaDescriptor_t *d = (const ParallelDmaDescriptor_t *)c.DMAC_DSCR;
+
+			for ( ; d != NULL; d = (const ParallelDmaDescriptor_t *)d->nextDescriptor)
+			{
+				c.DMAC_SADDR = d->sourceAddr;
+				c.DMAC_DADDR = d->destAddr;
+				c.DMAC_CTRLA = d->ctrlA;
+				c.DMAC_CTRLB = d->ctrlB;
+				dmaBlock(d->sourceAddr, d->destAddr, d->ctrlA, d->ctrlB);
+			}
+			status = (DMAC_EBCISR_BTC0 | DMAC_EBCISR_CBTC0) << ch;
+		}
+
+		DMAC->DMAC_EBCISR |= status;
+		DMAC_Handler();
+		DMAC->DMAC_EBCISR &= ~status;
+	}
+
+	_dmaActive = false;
+}
+
+// Timer model -----------------------------------------------------------------
+
+// MCK cycles between RC compares, 0 if the channel can't interrupt
+static uint64_t simTimerPeriod(TcChannel &c)
+{
+	static const uint8_t shift[4] = { 1, 3, 5, 7 };		// MCK/2 .. MCK/128
+	uint32_t clock = c.TC_CMR & TC_CMR_TCCLKS_Msk;
+
+	if ((clock > 3) || !(c.TC_CMR & TC_CMR_WAVE) || (c.TC_RC == 0))
+		return 0;
+
+	return (uint64_t)c.TC_RC << shift[clock];
+}
+
+// IER/IDR writes are applied to IMR when the model looks at the channel
+static void simTimerUpdateMask(TcChannel &c)
+{
+	c.TC_IMR = (c.TC_IMR | c.TC_IER) & ~c.TC_IDR;
+	c.TC_IER = 0;
+	c.TC_IDR = 0;
+}
+
+void ParallelSimClass::timerStart(uint8_t channel)
+{
+	TcChannel &c = parallelSimTc[channel / 3].TC_CHANNEL[channel % 3];
+
+	c.TC_SR |= TC_SR_CLKSTA;
+	_timerNext[channel] = _cycles + simTimerPeriod(c);
+}
+
+void ParallelSimClass::timerStop(uint8_t channel)
+{
+	parallelSimTc[channel / 3].TC_CHANNEL[channel % 3].TC_SR &= ~TC_SR_CLKSTA;
+}
+
+// Called as the clock advances, with a handler call for each compare that
+// has gone by.  Handlers run with further timer interrupts held off; of the
+// compares that go by while one runs only one is kept, as the NVIC only
+// holds a single interrupt pending.
+void ParallelSimClass::runTimers()
+{
+	static void (*const handlers[9])(void) = {
+		TC0_Handler, TC1_Handler, TC2_Handler,
+		TC3_Handler, TC4_Handler, TC5_Handler,
+		TC6_Handler, TC7_Handler, TC8_Handler
+	};
+
+	if (_timerActive)
+		return;
+
+	_timerActive = true;
+
+	for (uint8_t i = 0; i < 9; i++)
+	{
+		TcChannel &c = parallelSimTc[i / 3].TC_CHANNEL[i % 3];
+
+		while ((c.TC_SR & TC_SR_CLKSTA) && (_cycles >= _timerNext[i]))
+		{
+			uint64_t period = simTimerPeriod(c);
+			uint64_t entry = _cycles;
+
+			if (period == 0)
+				break;
+
+			_timerNext[i] += period;
+			c.TC_SR |= TC_SR_CPCS;
+			simTimerUpdateMask(c);
+
+			if (c.TC_IMR & TC_IER_CPCS)
+				handlers[i]();
+
+			while ((_timerNext[i] > entry) && (_timerNext[i] + period <= _cycles))
+				_timerNext[i] += period;
+		}
+	}
+
+	_timerActive = false;
+
+	if (_dmaPending && !_dmaActive)
+		runDma((uint8_t)__builtin_ctz(_dmaPending));
+}
+
+// NFC model -------------------------------------------------------------------
+
+void parallelSimNfcCommand(uint32_t cmd, uint32_t addressCycles, uint32_t cycle0)
+{
+	ParallelSim.nfcCommand(cmd, addressCycles, cycle0);
+}
+
+// Parity as the ECC unit computes it for each 256/512 byte sector: the XOR
+// of the bit numbers of the set bits, with the XOR of their complements in
+// bits 12-23.
+void ParallelSimClass::nfcParity(const uint8_t *data, uint32_t size)
+{
+	volatile uint32_t *pr[16] =
+	{
+		&SMC->SMC_ECC_PR0, &SMC->SMC_ECC_PR1, &SMC->SMC_ECC_PR2, &SMC->SMC_ECC_PR3,
+		&SMC->SMC_ECC_PR4, &SMC->SMC_ECC_PR5, &SMC->SMC_ECC_PR6, &SMC->SMC_ECC_PR7,
+		&SMC->SMC_ECC_PR8, &SMC->SMC_ECC_PR9, &SMC->SMC_ECC_PR10, &SMC->SMC_ECC_PR11,
+		&SMC->SMC_ECC_PR12, &SMC->SMC_ECC_PR13, &SMC->SMC_ECC_PR14, &SMC->SMC_ECC_PR15
+	};
+	uint32_t mode = SMC->SMC_ECC_MD & SMC_ECC_MD_TYPCORREC_Msk;
+	uint32_t sector = (mode == SMC_ECC_MD_TYPCORREC_C512B) ? 512 :
+		(mode == SMC_ECC_MD_TYPCORREC_C256B) ? 256 : 0;
+
+	for (int i = 0; i < 16; i++)
+		*pr[i] = 0;
+
+	// one parity for the whole page isn't modelled
+	if (sector == 0)
+		return;
+
+	for (uint32_t s = 0; (s < size / sector) && (s < 16); s++)
+	{
+		uint32_t p = 0;
+		uint32_t np = 0;
+
+		for (uint32_t i = 0; i < sector * 8; i++)
+		{
+			if (data[s * sector + (i >> 3)] & (1 << (i & 7)))
+			{
+				p ^= i;
+				np ^= ~i & 0xFFF;
+			}
+		}
+		*pr[s] = p | (np << 12);
+	}
+}
+
+// Command and address cycles go to the device with CLE/ALE set.  Page
+// transfers move the main area (and the spare area when enabled in 
+// SMC_CFG) between the device and the selected NFC SRAM bank: after the
+// address for writes, and after the second command and the device going
+// ready for reads.
+void ParallelSimClass::nfcCommand(uint32_t cmd, uint32_t addressCycles, uint32_t cycle0)
+{
+	uint8_t cs = (uint8_t)((cmd & NFCADDR_CMD_CSID_Msk) >> NFCADDR_CMD_CSID_Pos);
+	uint32_t base = SIM_BUS_BASE + ((uint32_t)cs << 24);
+	ParallelSimDevice *device = (cs < 4) ? _devices[cs] : &_memories[0];
+	uint32_t cycles = (cmd & NFCADDR_CMD_ACYCLE) >> 19;
+	bool transfer = (cmd & NFCADDR_CMD_NFCEN) != 0;
+	bool writing = (cmd & NFCADDR_CMD_NFC_WIRTE) != 0;
+	uint32_t pageSize = SMC->SMC_CFG & SMC_CFG_PAGESIZE_Msk;
+	uint32_t main = 512u << pageSize;
+	uint32_t spare = 16u << pageSize;
+	uint32_t bankOffset = (SMC->SMC_BANK & 0x7) * (main + spare);
+	uint8_t *ram;
+
+	if (bankOffset + main + spare > sizeof(parallelSimNfcRam))
+		bankOffset = 0;
+	ram = parallelSimNfcRam + bankOffset;
+
+	SMC->SMC_SR &= ~(SMC_SR_XFRDONE | SMC_SR_CMDDONE | SMC_SR_RB_EDGE0);
+
+	access(base | PARALLEL_SIM_NAND_CLE, false, (cmd & NFCADDR_CMD_CMD1) >> 2, 1);
+
+	for (uint32_t i = 0; i < cycles; i++)
+	{
+		uint8_t a = (i == 0) ? cycle0 : (uint8_t)(addressCycles >> (8 * (i - 1)));
+		access(base | PARALLEL_SIM_NAND_ALE, false, a, 1);
+	}
+
+	if (transfer && writing)
+	{
+		uint32_t n = main + ((SMC->SMC_CFG & SMC_CFG_WSPARE) ? spare : 0);
+
+		for (uint32_t i = 0; i < n; i++)
+			access(base, false, ram[i], 1);
+		nfcParity(ram, main);
+	}
+
+	if (cmd & NFCADDR_CMD_VCMD2)
+		access(base | PARALLEL_SIM_NAND_CLE, false, (cmd & NFCADDR_CMD_CMD2) >> 10, 1);
+
+	if (transfer && !writing)
+	{
+		uint32_t n = main + ((SMC->SMC_CFG & SMC_CFG_RSPARE) ? spare : 0);
+
+		advance(device->busyCycles());
+		SMC->SMC_SR |= SMC_SR_RB_EDGE0;
+
+		for (uint32_t i = 0; i < n; i++)
+			ram[i] = (uint8_t)access(base, true, 0, 1);
+		nfcParity(ram, main);
+	}
+
+	if (transfer)
+		SMC->SMC_SR |= SMC_SR_XFRDONE;
+	SMC->SMC_SR |= SMC_SR_CMDDONE;
+}
+
+#endif
@@ -0,0 +1,802 @@
+/*
+  ParallelSim.h
+
+  Host (Linux) backend for the Parallel library.  Building with 
+  PARALLEL_HOST_SIM defined swaps the Arduino/SAM3X headers for this file, 
+  which supplies the handful of SAM3X definitions the library uses and a
+  cycle approximate model of the external bus:
+
+    - the SMC register file (SETUP/PULSE/CYCLE/MODE for each chip select), 
+      decoded with the same non-linear field encodings as the hardware
+    - accesses to the chip select windows at 0x60000000-0x63FFFFFF, which 
+      advance a model clock by the programmed cycle time and can be recorded
+      in a trace with the NCS/NRD/NWE edge times, address and data
+    - the DMA controller channel used by the library, which runs transfers
+      (single block or descriptor chains) straight away through the same bus
+      model and then calls DMAC_Handler()
+    - the timer counters' RC compare in waveform mode, which calls the
+      TCx_Handler() of a started channel each time the model clock passes
+      a compare
+    - flash bank 1 and its EEFC, whose contents survive reset() the way the
+      real flash survives a reboot
+
+  Each chip select is backed by a simple RAM by default; attach a 
+  ParallelSimDevice to model something else.  A sketch style program builds
+  with, for example:
+
+    g++ -std=gnu++11 -DPARALLEL_HOST_SIM -I. *.cpp -x c smc.c -x none main.cpp
+
+  Everything in ParallelSim.cpp is compiled out for the real board.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PARALLEL_SIM_H
+#define PARALLEL_SIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+
+// Mimic the parts of the SAM3X device headers used by the library
+#define SAM3XA_SERIES	1
+#define VARIANT_MCK		84000000
+
+// Read-only registers are writable here so the model can update them
+#define __I		volatile
+#define __O		volatile
+#define __IO	volatile
+
+// Registers that the DMA controller reads addresses from are pointer sized 
+// here so host buffers can be handed to the simulated DMAC.
+typedef uintptr_t ParallelSimAddrReg_t;
+
+typedef struct {
+	__IO uint32_t SMC_SETUP;
+	__IO uint32_t SMC_PULSE;
+	__IO uint32_t SMC_CYCLE;
+	__IO uint32_t SMC_TIMINGS;
+	__IO uint32_t SMC_MODE;
+} SmcCs_number;
+
+typedef struct {
+	__IO uint32_t SMC_CFG;
+	__O  uint32_t SMC_CTRL;
+	__I  uint32_t SMC_SR;
+	__O  uint32_t SMC_IER;
+	__O  uint32_t SMC_IDR;
+	__I  uint32_t SMC_IMR;
+	__IO uint32_t SMC_ADDR;
+	__IO uint32_t SMC_BANK;
+	__O  uint32_t SMC_ECC_CTRL;
+	__IO uint32_t SMC_ECC_MD;
+	__I  uint32_t SMC_ECC_SR1;
+	__I  uint32_t SMC_ECC_PR0;
+	__I  uint32_t SMC_ECC_PR1;
+	__I  uint32_t SMC_ECC_SR2;
+	__I  uint32_t SMC_ECC_PR2;
+	__I  uint32_t SMC_ECC_PR3;
+	__I  uint32_t SMC_ECC_PR4;
+	__I  uint32_t SMC_ECC_PR5;
+	__I  uint32_t SMC_ECC_PR6;
+	__I  uint32_t SMC_ECC_PR7;
+	__I  uint32_t SMC_ECC_PR8;
+	__I  uint32_t SMC_ECC_PR9;
+	__I  uint32_t SMC_ECC_PR10;
+	__I  uint32_t SMC_ECC_PR11;
+	__I  uint32_t SMC_ECC_PR12;
+	__I  uint32_t SMC_ECC_PR13;
+	__I  uint32_t SMC_ECC_PR14;
+	__I  uint32_t SMC_ECC_PR15;
+	SmcCs_number SMC_CS_NUMBER[8];
+	__IO uint32_t SMC_OCMS;
+	__O  uint32_t SMC_KEY1;
+	__O  uint32_t SMC_KEY2;
+	__O  uint32_t SMC_WPCR;
+	__I  uint32_t SMC_WPSR;
+} Smc;
+
+typedef struct {
+	__IO ParallelSimAddrReg_t DMAC_SADDR;
+	__IO ParallelSimAddrReg_t DMAC_DADDR;
+	__IO ParallelSimAddrReg_t DMAC_DSCR;
+	__IO uint32_t DMAC_CTRLA;
+	__IO uint32_t DMAC_CTRLB;
+	__IO uint32_t DMAC_CFG;
+	__IO uint32_t DMAC_SPIP;
+	__IO uint32_t DMAC_DPIP;
+} DmacCh_num;
+
+typedef struct {
+	__IO uint32_t DMAC_GCFG;
+	__IO uint32_t DMAC_EN;
+	__IO uint32_t DMAC_SREQ;
+	__IO uint32_t DMAC_CREQ;
+	__IO uint32_t DMAC_LAST;
+	__O  uint32_t DMAC_EBCIER;
+	__O  uint32_t DMAC_EBCIDR;
+	__I  uint32_t DMAC_EBCIMR;
+	__I  uint32_t DMAC_EBCISR;
+	__O  uint32_t DMAC_CHER;
+	__O  uint32_t DMAC_CHDR;
+	__I  uint32_t DMAC_CHSR;
+	DmacCh_num DMAC_CH_NUM[6];
+} Dmac;
+
+typedef struct {
+	__O  uint32_t PIO_PER;
+	__O  uint32_t PIO_PDR;
+	__I  uint32_t PIO_PSR;
+	__I  uint32_t PIO_PDSR;
+	__IO uint32_t PIO_ODSR;
+} Pio;
+
+typedef struct {
+	__O  uint32_t TC_CCR;
+	__IO uint32_t TC_CMR;
+	__IO uint32_t TC_SMMR;
+	__I  uint32_t Reserved1[1];
+	__I  uint32_t TC_CV;
+	__IO uint32_t TC_RA;
+	__IO uint32_t TC_RB;
+	__IO uint32_t TC_RC;
+	__I  uint32_t TC_SR;
+	__O  uint32_t TC_IER;
+	__O  uint32_t TC_IDR;
+	__I  uint32_t TC_IMR;
+	__I  uint32_t Reserved2[4];
+} TcChannel;
+
+typedef struct {
+	TcChannel TC_CHANNEL[3];
+} Tc;
+
+typedef struct {
+	__IO uint32_t EEFC_FMR;
+	__O  uint32_t EEFC_FCR;
+	__I  uint32_t EEFC_FSR;
+	__I  uint32_t EEFC_FRR;
+} Efc;
+
+typedef struct {
+	__IO uint32_t CTRL;
+	__IO uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct {
+	__IO uint32_t DEMCR;
+} CoreDebug_Type;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern Smc parallelSimSmc;
+extern Dmac parallelSimDmac;
+extern Pio parallelSimPio[4];
+extern DWT_Type parallelSimDwt;
+extern Tc parallelSimTc[3];
+extern Efc parallelSimEfc[2];
+extern CoreDebug_Type parallelSimCoreDebug;
+
+// NFC SRAM, and the NFC command space that smc_nfc_send_command() writes
+extern uint8_t parallelSimNfcRam[4224];
+void parallelSimNfcCommand(uint32_t cmd, uint32_t addressCycles, uint32_t cycle0);
+
+// Flash bank 1 (bank 0 holds the program)
+extern uint8_t parallelSimFlash1[256 * 1024];
+
+#ifdef __cplusplus
+}
+#endif
+
+#define NFC_RAM_ADDR	((uintptr_t)parallelSimNfcRam)
+#define IFLASH1_ADDR	((uintptr_t)parallelSimFlash1)
+#define IFLASH1_PAGE_SIZE	256
+#define IFLASH1_NB_OF_PAGES	1024
+
+#define SMC			(&parallelSimSmc)
+#define DMAC		(&parallelSimDmac)
+#define PIOA		(&parallelSimPio[0])
+#define PIOB		(&parallelSimPio[1])
+#define PIOC		(&parallelSimPio[2])
+#define PIOD		(&parallelSimPio[3])
+#define DWT			(&parallelSimDwt)
+#define TC0			(&parallelSimTc[0])
+#define TC1			(&parallelSimTc[1])
+#define TC2			(&parallelSimTc[2])
+#define EFC0		(&parallelSimEfc[0])
+#define EFC1		(&parallelSimEfc[1])
+#define CoreDebug	(&parallelSimCoreDebug)
+
+#define ID_SMC		9
+#define ID_PIOA		11
+#define ID_PIOB		12
+#define ID_PIOC		13
+#define ID_PIOD		14
+#define ID_TC0		27
+#define ID_TC1		28
+#define ID_TC2		29
+#define ID_TC3		30
+#define ID_TC4		31
+#define ID_TC5		32
+#define ID_TC6		33
+#define ID_TC7		34
+#define ID_TC8		35
+#define ID_DMAC		39
+
+typedef int IRQn_Type;
+#define SMC_IRQn	9
+#define TC0_IRQn	27
+#define TC1_IRQn	28
+#define TC2_IRQn	29
+#define TC3_IRQn	30
+#define TC4_IRQn	31
+#define TC5_IRQn	32
+#define TC6_IRQn	33
+#define TC7_IRQn	34
+#define TC8_IRQn	35
+#define DMAC_IRQn	39
+
+#define DWT_CTRL_CYCCNTENA_Msk			(1u << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk		(1u << 24)
+
+// SMC register fields
+#define SMC_SETUP_NWE_SETUP(value)		((0x3fu & (value)) << 0)
+#define SMC_SETUP_NCS_WR_SETUP(value)	((0x3fu & (value)) << 8)
+#define SMC_SETUP_NRD_SETUP(value)		((0x3fu & (value)) << 16)
+#define SMC_SETUP_NCS_RD_SETUP(value)	((0x3fu & (value)) << 24)
+#define SMC_PULSE_NWE_PULSE(value)		((0x7fu & (value)) << 0)
+#define SMC_PULSE_NCS_WR_PULSE(value)	((0x7fu & (value)) << 8)
+#define SMC_PULSE_NRD_PULSE_Msk			(0x7fu << 16)
+#define SMC_PULSE_NRD_PULSE(value)		((0x7fu & (value)) << 16)
+#define SMC_PULSE_NCS_RD_PULSE_Msk		(0x7fu << 24)
+#define SMC_PULSE_NCS_RD_PULSE(value)	((0x7fu & (value)) << 24)
+#define SMC_CYCLE_NWE_CYCLE(value)		((0x1ffu & (value)) << 0)
+#define SMC_CYCLE_NRD_CYCLE(value)		((0x1ffu & (value)) << 16)
+
+#define SMC_MODE_READ_MODE				(0x1u << 0)
+#define SMC_MODE_READ_MODE_NCS_CTRL		(0x0u << 0)
+#define SMC_MODE_READ_MODE_NRD_CTRL		(0x1u << 0)
+#define SMC_MODE_WRITE_MODE				(0x1u << 1)
+#define SMC_MODE_WRITE_MODE_NCS_CTRL	(0x0u << 1)
+#define SMC_MODE_WRITE_MODE_NWE_CTRL	(0x1u << 1)
+#define SMC_MODE_EXNW_MODE_Msk			(0x3u << 4)
+#define SMC_MODE_EXNW_MODE_DISABLED		(0x0u << 4)
+#define SMC_MODE_EXNW_MODE_FROZEN		(0x2u << 4)
+#define SMC_MODE_EXNW_MODE_READY		(0x3u << 4)
+#define SMC_MODE_BAT					(0x1u << 8)
+#define SMC_MODE_BAT_BYTE_SELECT		(0x0u << 8)
+#define SMC_MODE_BAT_BYTE_WRITE			(0x1u << 8)
+#define SMC_MODE_DBW					(0x1u << 12)
+#define SMC_MODE_DBW_BIT_8				(0x0u << 12)
+#define SMC_MODE_DBW_BIT_16				(0x1u << 12)
+#define SMC_MODE_TDF_CYCLES_Msk			(0xfu << 16)
+#define SMC_MODE_TDF_CYCLES(value)		((0xfu & (value)) << 16)
+#define SMC_MODE_TDF_MODE				(0x1u << 20)
+#define SMC_MODE_PMEN					(0x1u << 24)
+#define SMC_MODE_PS_Msk					(0x3u << 28)
+#define SMC_MODE_PS_4_BYTE				(0x0u << 28)
+#define SMC_MODE_PS_8_BYTE				(0x1u << 28)
+#define SMC_MODE_PS_16_BYTE				(0x2u << 28)
+#define SMC_MODE_PS_32_BYTE				(0x3u << 28)
+
+#define SMC_CFG_PAGESIZE_Msk			(0x3u << 0)
+#define SMC_CFG_PAGESIZE_PS512_16		(0x0u << 0)
+#define SMC_CFG_PAGESIZE_PS1024_32		(0x1u << 0)
+#define SMC_CFG_PAGESIZE_PS2048_64		(0x2u << 0)
+#define SMC_CFG_PAGESIZE_PS4096_128		(0x3u << 0)
+#define SMC_CFG_WSPARE					(0x1u << 8)
+#define SMC_CFG_RSPARE					(0x1u << 9)
+#define SMC_CFG_EDGECTRL				(0x1u << 12)
+#define SMC_CFG_RBEDGE					(0x1u << 13)
+#define SMC_CFG_DTOCYC(value)			((0xfu & (value)) << 16)
+#define SMC_CFG_DTOMUL_X1048576			(0x7u << 20)
+#define SMC_CTRL_NFCEN					(0x1u << 0)
+#define SMC_CTRL_NFCDIS					(0x1u << 1)
+#define SMC_SR_NFCBUSY					(0x1u << 8)
+#define SMC_SR_XFRDONE					(0x1u << 16)
+#define SMC_SR_CMDDONE					(0x1u << 17)
+#define SMC_SR_DTOE						(0x1u << 20)
+#define SMC_SR_RB_EDGE0					(0x1u << 24)
+#define SMC_BANK_BANK(value)			((0x7u & (value)) << 0)
+#define SMC_ECC_CTRL_RST				(0x1u << 0)
+#define SMC_ECC_CTRL_SWRST				(0x1u << 1)
+#define SMC_ECC_MD_ECC_PAGESIZE_Msk		(0x3u << 0)
+#define SMC_ECC_MD_ECC_PAGESIZE_PS512_16	(0x0u << 0)
+#define SMC_ECC_MD_ECC_PAGESIZE_PS1024_32	(0x1u << 0)
+#define SMC_ECC_MD_ECC_PAGESIZE_PS2048_64	(0x2u << 0)
+#define SMC_ECC_MD_ECC_PAGESIZE_PS4096_128	(0x3u << 0)
+#define SMC_ECC_MD_TYPCORREC_Msk		(0x3u << 4)
+#define SMC_ECC_MD_TYPCORREC_CPAGE		(0x0u << 4)
+#define SMC_ECC_MD_TYPCORREC_C256B		(0x1u << 4)
+#define SMC_ECC_MD_TYPCORREC_C512B		(0x2u << 4)
+#define SMC_TIMINGS_TCLR(value)			((0xfu & (value)) << 0)
+#define SMC_TIMINGS_TADL(value)			((0xfu & (value)) << 4)
+#define SMC_TIMINGS_TAR(value)			((0xfu & (value)) << 8)
+#define SMC_TIMINGS_OCMS				(0x1u << 12)
+#define SMC_TIMINGS_TRR(value)			((0xfu & (value)) << 16)
+#define SMC_TIMINGS_TWB(value)			((0xfu & (value)) << 24)
+#define SMC_TIMINGS_RBNSEL(value)		((0x7u & (value)) << 28)
+#define SMC_TIMINGS_NFSEL				(0x1u << 31)
+#define SMC_WPCR_WP_EN					(0x1u << 0)
+#define SMC_WPCR_WP_KEY(value)			((0xffffffu & (value)) << 8)
+
+// DMAC register fields
+#define DMAC_GCFG_ARB_CFG_FIXED			(0x0u << 4)
+#define DMAC_GCFG_ARB_CFG_ROUND_ROBIN	(0x1u << 4)
+#define DMAC_EN_ENABLE					(0x1u << 0)
+#define DMAC_EBCIER_BTC0				(0x1u << 0)
+#define DMAC_EBCIER_CBTC0				(0x1u << 8)
+#define DMAC_EBCIER_ERR0				(0x1u << 16)
+#define DMAC_EBCISR_BTC0				(0x1u << 0)
+#define DMAC_EBCISR_CBTC0				(0x1u << 8)
+#define DMAC_EBCISR_ERR0				(0x1u << 16)
+#define DMAC_CHER_ENA0					(0x1u << 0)
+#define DMAC_CHDR_DIS0					(0x1u << 0)
+#define DMAC_CHSR_ENA0					(0x1u << 0)
+#define DMAC_CTRLA_BTSIZE_Msk			(0xffffu << 0)
+#define DMAC_CTRLA_BTSIZE(value)		((0xffffu & (value)) << 0)
+#define DMAC_CTRLA_SRC_WIDTH_Msk		(0x3u << 24)
+#define DMAC_CTRLA_SRC_WIDTH_BYTE		(0x0u << 24)
+#define DMAC_CTRLA_SRC_WIDTH_HALF_WORD	(0x1u << 24)
+#define DMAC_CTRLA_SRC_WIDTH_WORD		(0x2u << 24)
+#define DMAC_CTRLA_DST_WIDTH_Msk		(0x3u << 28)
+#define DMAC_CTRLA_DST_WIDTH_BYTE		(0x0u << 28)
+#define DMAC_CTRLA_DST_WIDTH_HALF_WORD	(0x1u << 28)
+#define DMAC_CTRLA_DST_WIDTH_WORD		(0x2u << 28)
+#define DMAC_CTRLA_DONE					(0x1u << 31)
+#define DMAC_CTRLB_SRC_DSCR				(0x1u << 16)
+#define DMAC_CTRLB_SRC_DSCR_FETCH_FROM_MEM	(0x0u << 16)
+#define DMAC_CTRLB_SRC_DSCR_FETCH_DISABLE	(0x1u << 16)
+#define DMAC_CTRLB_DST_DSCR				(0x1u << 20)
+#define DMAC_CTRLB_DST_DSCR_FETCH_FROM_MEM	(0x0u << 20)
+#define DMAC_CTRLB_DST_DSCR_FETCH_DISABLE	(0x1u << 20)
+#define DMAC_CTRLB_FC_MEM2MEM_DMA_FC	(0x0u << 21)
+#define DMAC_CTRLB_SRC_INCR_Msk			(0x3u << 24)
+#define DMAC_CTRLB_SRC_INCR_INCREMENTING	(0x0u << 24)
+#define DMAC_CTRLB_SRC_INCR_FIXED		(0x2u << 24)
+#define DMAC_CTRLB_DST_INCR_Msk			(0x3u << 28)
+#define DMAC_CTRLB_DST_INCR_INCREMENTING	(0x0u << 28)
+#define DMAC_CTRLB_DST_INCR_FIXED		(0x2u << 28)
+#define DMAC_CTRLB_IEN					(0x1u << 30)
+#define DMAC_CFG_SOD_ENABLE				(0x1u << 16)
+#define DMAC_CFG_AHB_PROT(value)		((0x7u & (value)) << 24)
+#define DMAC_CFG_FIFOCFG_ALAP_CFG		(0x0u << 28)
+#define DMAC_CFG_FIFOCFG_ASAP_CFG		(0x2u << 28)
+
+// TC register fields
+#define TC_CCR_CLKEN					(0x1u << 0)
+#define TC_CCR_CLKDIS					(0x1u << 1)
+#define TC_CCR_SWTRG					(0x1u << 2)
+#define TC_CMR_TCCLKS_Msk				(0x7u << 0)
+#define TC_CMR_TCCLKS_TIMER_CLOCK1		(0x0u << 0)
+#define TC_CMR_TCCLKS_TIMER_CLOCK2		(0x1u << 0)
+#define TC_CMR_TCCLKS_TIMER_CLOCK3		(0x2u << 0)
+#define TC_CMR_TCCLKS_TIMER_CLOCK4		(0x3u << 0)
+#define TC_CMR_WAVSEL_UP_RC				(0x2u << 13)
+#define TC_CMR_WAVE						(0x1u << 15)
+#define TC_SR_CPCS						(0x1u << 4)
+#define TC_SR_CLKSTA					(0x1u << 16)
+#define TC_IER_CPCS						(0x1u << 4)
+#define TC_IDR_CPCS						(0x1u << 4)
+
+// EEFC commands and results (efc.h in the Arduino core)
+#define EFC_FCMD_EWP	0x03
+#define EFC_RC_OK		0
+#define EFC_RC_ERROR	1
+
+// External bus pins, only the bit positions matter to the model
+#define PIO_PC2A_D0	(1u << 2)
+#define PIO_PC3A_D1	(1u << 3)
+#define PIO_PC4A_D2	(1u << 4)
+#define PIO_PC5A_D3	(1u << 5)
+#define PIO_PC6A_D4	(1u << 6)
+#define PIO_PC7A_D5	(1u << 7)
+#define PIO_PC8A_D6	(1u << 8)
+#define PIO_PC9A_D7	(1u << 9)
+#define PIO_PC10A_D8	(1u << 10)
+#define PIO_PC11A_D9	(1u << 11)
+#define PIO_PC12A_D10	(1u << 12)
+#define PIO_PC13A_D11	(1u << 13)
+#define PIO_PC14A_D12	(1u << 14)
+#define PIO_PC15A_D13	(1u << 15)
+#define PIO_PC16A_D14	(1u << 16)
+#define PIO_PC17A_D15	(1u << 17)
+#define PIO_PC21A_A0	(1u << 21)
+#define PIO_PC22A_A1	(1u << 22)
+#define PIO_PC23A_A2	(1u << 23)
+#define PIO_PC24A_A3	(1u << 24)
+#define PIO_PC25A_A4	(1u << 25)
+#define PIO_PC26A_A5	(1u << 26)
+#define PIO_PC27A_A6	(1u << 27)
+#define PIO_PC28A_A7	(1u << 28)
+#define PIO_PC29A_A8	(1u << 29)
+#define PIO_PC30A_A9	(1u << 30)
+#define PIO_PD0A_A10	(1u << 0)
+#define PIO_PD1A_A11	(1u << 1)
+#define PIO_PD2A_A12	(1u << 2)
+#define PIO_PD3A_A13	(1u << 3)
+#define PIO_PD4A_A14	(1u << 4)
+#define PIO_PD5A_A15	(1u << 5)
+#define PIO_PD6A_A16	(1u << 6)
+#define PIO_PD7A_A17	(1u << 7)
+#define PIO_PA25B_A18	(1u << 25)
+#define PIO_PA26B_A19	(1u << 26)
+#define PIO_PA27B_A20	(1u << 27)
+#define PIO_PD8A_A21	(1u << 8)
+#define PIO_PD9A_A22	(1u << 9)
+#define PIO_PA29B_NRD	(1u << 29)
+#define PIO_PC18A_NWE	(1u << 18)
+#define PIO_PA4B_NWAIT	(1u << 4)
+#define PIO_PA6B_NCS0	(1u << 6)
+#define PIO_PA7B_NCS1	(1u << 7)
+#define PIO_PB24B_NCS2	(1u << 24)
+#define PIO_PB27A_NCS3	(1u << 27)
+#define PIO_PC19A_NANDOE	(1u << 19)
+#define PIO_PC20A_NANDWE	(1u << 20)
+#define PIO_PD8A_NANDALE	(1u << 8)
+#define PIO_PD9A_NANDCLE	(1u << 9)
+#define PIO_PA2B_NANDRDY	(1u << 2)
+
+#ifdef __cplusplus
+
+#include <vector>
+
+// Arduino core stand-ins
+typedef enum 
+{
+	PIO_NOT_A_PIN,
+	PIO_PERIPH_A,
+	PIO_PERIPH_B,
+	PIO_INPUT,
+	PIO_OUTPUT_0,
+	PIO_OUTPUT_1
+} EPioType;
+
+#define PIO_DEFAULT			(0u << 0)
+#define PIO_PULLUP			(1u << 0)
+#define PIN_ATTR_DIGITAL	(1u << 2)
+#define NO_ADC				0xFF
+#define NOT_ON_PWM			0xFF
+#define NOT_ON_TIMER		0xFF
+
+typedef struct
+{
+	Pio *pPort;
+	uint32_t ulPin;
+	uint32_t ulPeripheralId;
+	EPioType ulPinType;
+	uint32_t ulPinConfiguration;
+	uint32_t ulPinAttribute;
+	uint32_t ulAnalogChannel;
+	uint32_t ulADCChannelNumber;
+	uint32_t ulPWMChannel;
+	uint32_t ulTCChannel;
+} PinDescription;
+
+#define HEX	16
+#define DEC	10
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  size_t print(const char *s);
+  size_t print(unsigned long n, int base = DEC);
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+  size_t print(int n, int base = DEC) { return print((long)n, base); }
+  size_t print(double n, int digits = 2);
+  size_t println(void);
+  size_t println(const char *s) { return print(s) + println(); }
+  size_t println(unsigned long n, int base = DEC) { return print(n, base) + println(); }
+  size_t println(long n, int base = DEC) { return print(n, base) + println(); }
+  size_t println(double n, int digits = 2) { return print(n, digits) + println(); }
+};
+
+// Serial prints to stdout
+class ParallelSimSerial : public Print {
+public:
+  using Print::write;
+  void begin(unsigned long baud) { (void)baud; }
+  virtual size_t write(uint8_t c) { return fputc(c, stdout) == EOF ? 0 : 1; }
+};
+
+extern ParallelSimSerial Serial;
+
+uint32_t PIO_Configure(Pio *pPio, const EPioType dwType, const uint32_t dwMask, 
+                       const uint32_t dwAttribute);
+uint32_t pmc_enable_periph_clk(uint32_t ul_id);
+uint32_t millis(void);
+uint32_t micros(void);
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+static inline void NVIC_EnableIRQ(IRQn_Type) {}
+static inline void NVIC_DisableIRQ(IRQn_Type) {}
+static inline void NVIC_ClearPendingIRQ(IRQn_Type) {}
+static inline void NVIC_SetPriority(IRQn_Type, uint32_t) {}
+static inline uint32_t __get_PRIMASK(void) { return 0; }
+static inline void __set_PRIMASK(uint32_t) {}
+static inline void __disable_irq(void) {}
+static inline void __enable_irq(void) {}
+static inline void __DMB(void) { __sync_synchronize(); }
+static inline void __DSB(void) { __sync_synchronize(); }
+
+// Timer counter driver (tc.h in the Arduino core)
+void TC_Configure(Tc *pTc, uint32_t dwChannel, uint32_t dwMode);
+void TC_Start(Tc *pTc, uint32_t dwChannel);
+void TC_Stop(Tc *pTc, uint32_t dwChannel);
+void TC_SetRC(Tc *pTc, uint32_t dwChannel, uint32_t dwValue);
+uint32_t TC_GetStatus(Tc *pTc, uint32_t dwChannel);
+
+// Flash command, only erase and write page (EWP) on bank 1.  The page 
+// buffer is the flash itself here, so the command just takes the time.
+uint32_t efc_perform_command(Efc *p_efc, uint32_t ul_command, uint32_t ul_argument);
+
+extern "C" void DMAC_Handler(void);
+extern "C" void TC0_Handler(void);
+extern "C" void TC1_Handler(void);
+extern "C" void TC2_Handler(void);
+extern "C" void TC3_Handler(void);
+extern "C" void TC4_Handler(void);
+extern "C" void TC5_Handler(void);
+extern "C" void TC6_Handler(void);
+extern "C" void TC7_Handler(void);
+extern "C" void TC8_Handler(void);
+
+// One recorded bus access.  Edge times are in MCK cycles from the start of
+// the access; start is the model clock when it began.
+typedef struct
+{
+	uint64_t start;
+	uint32_t address;		// full bus address (chip select window + offset)
+	uint16_t data;
+	uint8_t cs;
+	uint8_t width;			// bytes, 1 or 2
+	bool read;
+	uint16_t ncsFall;
+	uint16_t strobeFall;	// NRD or NWE
+	uint16_t strobeRise;
+	uint16_t ncsRise;
+	uint16_t cycle;
+} ParallelSimAccess_t;
+
+// Something connected to a chip select
+class ParallelSimDevice {
+public:
+  virtual ~ParallelSimDevice() {}
+  virtual uint16_t read(uint32_t offset, uint8_t width) = 0;
+  virtual void write(uint32_t offset, uint16_t data, uint8_t width) = 0;
+  
+  // Called with the edges of each access (data not yet filled in) just
+  // before its read() or write()
+  virtual void timing(const ParallelSimAccess_t &access) { (void)access; }
+  
+  // Cycles the device holds NWAIT low in an access.  They lengthen the
+  // strobe and the cycle when the chip select has a wait mode set.
+  virtual uint32_t waitCycles(uint32_t offset, bool read) 
+  { 
+    (void)offset; 
+    (void)read; 
+    return 0; 
+  }
+  
+  // Cycles until the device's ready/busy output goes high, for the NFC
+  virtual uint32_t busyCycles() { return 0; }
+};
+
+// Default device: plain RAM that grows to fit the offsets used
+class ParallelSimMemory : public ParallelSimDevice {
+public:
+  virtual uint16_t read(uint32_t offset, uint8_t width);
+  virtual void write(uint32_t offset, uint16_t data, uint8_t width);
+  std::vector<uint8_t> data;
+};
+
+// RAM with minimum timings in MCK cycles, as a data sheet gives them: 
+// address setup before the strobe, write pulse, read access (NRD low to 
+// data valid), hold after the strobe and cycle time.  An access that breaks
+// one fails the way marginal timing tends to on a real bus: a write doesn't
+// take, and a read gets whatever was last on the data lines.
+class ParallelSimTimedMemory : public ParallelSimMemory {
+public:
+  ParallelSimTimedMemory(uint32_t setup, uint32_t pulse, uint32_t access,
+                         uint32_t hold, uint32_t cycle);
+  virtual uint16_t read(uint32_t offset, uint8_t width);
+  virtual void write(uint32_t offset, uint16_t data, uint8_t width);
+  virtual void timing(const ParallelSimAccess_t &access);
+
+  uint32_t minSetup;
+  uint32_t minPulse;
+  uint32_t minAccess;
+  uint32_t minHold;
+  uint32_t minCycle;
+  uint32_t violations;
+
+private:
+  bool _ok;
+  uint16_t _bus;
+};
+
+// Large page, 8-bit NAND flash with CLE on A22 and ALE on A21, as the NFC
+// drives them.  Storage starts out erased.  Array operations keep the part
+// busy for the given number of MCK cycles.  Faults can be injected to 
+// exercise error handling: bit flips in the stored data, factory bad 
+// block markers, and blocks whose programs and erases fail.
+#define PARALLEL_SIM_NAND_CLE	(1u << 22)
+#define PARALLEL_SIM_NAND_ALE	(1u << 21)
+
+class ParallelSimNand : public ParallelSimDevice {
+public:
+  ParallelSimNand(uint16_t pageSize, uint16_t spareSize, uint16_t pagesPerBlock,
+                  uint16_t blocks);
+  virtual uint16_t read(uint32_t offset, uint8_t width);
+  virtual void write(uint32_t offset, uint16_t data, uint8_t width);
+  virtual uint32_t busyCycles();
+
+  // column counts from the start of the page, spare area included
+  void flipBit(uint32_t page, uint32_t column, uint8_t bit);
+  void setFactoryBad(uint16_t block);
+  void failBlock(uint16_t block);
+
+  // Power loss after the given number of programs/erases: the next one is
+  // torn (only the first half of the page or block changes) and the part
+  // stops responding until powerOn().
+  void powerFail(uint32_t operations) { _powerFail = operations; }
+  void powerOn() { _off = false; _powerFail = 0xFFFFFFFF; _state = IDLE; }
+  bool powered() { return !_off; }
+
+  uint8_t *page(uint32_t n) { return &data[(size_t)n * (_pageSize + _spareSize)]; }
+
+  uint32_t readTime;
+  uint32_t programTime;
+  uint32_t eraseTime;
+  uint32_t reads;
+  uint32_t programs;
+  uint32_t erases;
+  std::vector<uint8_t> data;
+  std::vector<bool> failing;
+
+private:
+  typedef enum { IDLE, ADDRESS, DATA_OUT, DATA_IN, STATUS, ID } State_t;
+
+  void command(uint8_t cmd);
+  void busy(uint32_t cycles);
+  void powerCountdown();
+  uint32_t row();
+
+  uint16_t _pageSize;
+  uint16_t _spareSize;
+  uint16_t _pagesPerBlock;
+  uint16_t _blocks;
+  uint8_t _rowCycles;
+  State_t _state;
+  uint8_t _lastCommand;
+  uint8_t _address[5];
+  uint8_t _addressCount;
+  uint32_t _column;
+  uint8_t _status;
+  uint64_t _readyAt;
+  uint32_t _powerFail;
+  bool _off;
+  std::vector<uint8_t> _register;
+};
+
+class ParallelSimClass {
+public:
+  ParallelSimClass();
+  
+  // Clears the model clock, trace, registers and default memories
+  void reset();
+  
+  // Connect a device to a chip select (NULL restores the default RAM)
+  void attach(uint8_t cs, ParallelSimDevice *device);
+  
+  // Model clock in MCK cycles
+  uint64_t cycles() { return _cycles; }
+  void advance(uint64_t cycles);
+  
+  // Record accesses (at most limit of them)
+  void setTrace(bool enable, size_t limit = 1000000);
+  const std::vector<ParallelSimAccess_t> &trace() { return _trace; }
+  void clearTrace() { _trace.clear(); }
+  
+  // Prints the trace, one access per line
+  void dumpTrace(FILE *out);
+  
+  // Bus accesses, as made through ParallelPort
+  uint16_t read(uint32_t address, uint8_t width);
+  void write(uint32_t address, uint16_t data, uint8_t width);
+  
+  // Level of the NWAIT pin as read through PIOA (released after reset).
+  // Accesses aren't held up by it; devices stretch them with waitCycles().
+  void setWait(bool asserted);
+  
+  // Runs whatever the library has set up on a DMA channel
+  void runDma(uint8_t channel);
+  
+  // Timer channel 0-8 started or stopped (TC_Start()/TC_Stop())
+  void timerStart(uint8_t channel);
+  void timerStop(uint8_t channel);
+  
+  // One NFC command (see smc_nfc_send_command()).  Transfers to and from 
+  // the NFC SRAM run straight away, with the ECC unit's parity computed on
+  // the way (512 and 256 byte modes).
+  void nfcCommand(uint32_t cmd, uint32_t addressCycles, uint32_t cycle0);
+  
+  // Decoded SMC timings, in MCK cycles
+  static uint32_t decodeSetup(uint32_t field) { return ((field >> 5) & 1) * 128 + (field & 0x1F); }
+  static uint32_t decodePulse(uint32_t field) { return ((field >> 6) & 1) * 256 + (field & 0x3F); }
+  static uint32_t decodeCycle(uint32_t field) { return ((field >> 7) & 3) * 256 + (field & 0x7F); }
+
+private:
+  uint32_t access(uint32_t address, bool read, uint16_t data, uint8_t width);
+  uint8_t dmaRead(uintptr_t address, bool bus);
+  void dmaWrite(uintptr_t address, uint8_t data, bool bus);
+  void dmaBlock(uintptr_t src, uintptr_t dst, uint32_t ctrlA, uint32_t ctrlB);
+  void nfcParity(const uint8_t *data, uint32_t size);
+  void runTimers();
+
+  uint64_t _cycles;
+  bool _tracing;
+  size_t _traceLimit;
+  bool _dmaActive;
+  uint32_t _dmaPending;
+  bool _timerActive;
+  uint64_t _timerNext[9];	// next compare of each running channel
+  std::vector<ParallelSimAccess_t> _trace;
+  uint32_t _page[8];		// page of the last read per chip select, or ~0
+  ParallelSimDevice *_devices[4];
+  ParallelSimMemory _memories[4];
+};
+
+extern ParallelSimClass ParallelSim;
+
+// Pointer-like handle to a bus address.  Dereferencing gives a reference 
+// that turns reads and writes into ParallelSim bus accesses.
+template <typename T> class ParallelSimRef {
+public:
+  explicit ParallelSimRef(uint32_t address) : _address(address) {}
+  ParallelSimRef &operator=(T value) 
+  { 
+    ParallelSim.write(_address, value, sizeof(T)); 
+    return *this; 
+  }
+  operator T() const { return (T)ParallelSim.read(_address, sizeof(T)); }
+private:
+  uint32_t _address;
+};
+
+template <typename T> class ParallelSimPort {
+public:
+  ParallelSimPort() : _address(0) {}
+  explicit ParallelSimPort(uint32_t address) : _address(address) {}
+  ParallelSimRef<T> operator*() const { return ParallelSimRef<T>(_address); }
+  ParallelSimRef<T> operator[](uint32_t i) const { return ParallelSimRef<T>(_address + i * sizeof(T)); }
+  ParallelSimPort operator+(uint32_t i) const { return ParallelSimPort(_address + i * sizeof(T)); }
+  uint32_t address() const { return _address; }
+private:
+  uint32_t _address;
+};
+
+template <typename T> using ParallelPort = ParallelSimPort<T>;
+
+#endif	/* __cplusplus */
+
+#endif
@@ -0,0 +1,103 @@
+/*
+  ParallelStats.cpp
+
+  Optional instrumentation of the parallel bus.  See ParallelStats.h.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ParallelStats.h"
+
+#if PARALLEL_ENABLE_STATS
+
+// One set of counters per SMC chip select register set (0-3)
+static ParallelStats_t stats[4];
+
+void ParallelStatsClass::begin(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+void ParallelStatsClass::reset(void)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	memset(stats, 0, sizeof(stats));
+	__set_PRIMASK(primask);
+}
+
+const ParallelStats_t &ParallelStatsClass::get(ParallelChipSelect_t cs)
+{
+	return stats[(cs < PARALLEL_CS_NONE) ? cs : PARALLEL_CS_0];
+}
+
+void ParallelStatsClass::record(uint32_t cs, uint32_t bytes, uint32_t startCycles)
+{
+	ParallelStats_t *s = &stats[cs & 3];
+	uint32_t cycles = now() - startCycles;
+	uint32_t bucket = (cycles == 0) ? 0 : 32 - __builtin_clz(cycles);
+	
+	if (bucket >= PARALLEL_STATS_BUCKETS)
+		bucket = PARALLEL_STATS_BUCKETS - 1;
+	
+	// An interrupt recording in the middle of this would lose its update
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	s->bytes += bytes;
+	s->accesses++;
+	s->cycles += cycles;
+	s->histogram[bucket]++;
+	
+	if (bytes > s->peakBurst)
+		s->peakBurst = bytes;
+	__set_PRIMASK(primask);
+}
+
+void ParallelStatsClass::dump(Print &out)
+{
+	for (int cs=0; cs < 4; cs++)
+	{
+		ParallelStats_t *s = &stats[cs];
+		
+		if (s->accesses == 0)
+			continue;
+		
+		out.print("CS");
+		out.print((unsigned long)cs);
+		out.print(" bytes=");
+		out.print((unsigned long)s->bytes);
+		out.print(" accesses=");
+		out.print((unsigned long)s->accesses);
+		out.print(" peak=");
+		out.print((unsigned long)s->peakBurst);
+		out.print(" cycles=");
+		out.print((unsigned long)s->cycles);
+		out.print(" hist=");
+		
+		for (int i=0; i < PARALLEL_STATS_BUCKETS; i++)
+		{
+			if (i > 0)
+				out.print(",");
+			out.print((unsigned long)s->histogram[i]);
+		}
+		
+		out.println();
+	}
+}
+
+ParallelStatsClass ParallelStats;
+
+#endif
@@ -0,0 +1,98 @@
+/*
+  ParallelStats.h
+
+  Optional instrumentation of the parallel bus.  When PARALLEL_ENABLE_STATS
+  is set to 1 (in Parallel.h, or with -D on the compiler command line) every
+  ParallelClass read/write path records, per chip select:
+
+    - bytes moved and number of calls
+    - the longest single burst (block transfer) in bytes
+    - time spent on the bus, from the DWT cycle counter, as a total and as a
+      histogram of cycles per call in power of two buckets
+
+  The figures are available through ParallelStats.get() or printed with
+  ParallelStats.dump(Serial).  With PARALLEL_ENABLE_STATS at 0 (the default)
+  the hooks are empty macros and the read/write code is unchanged.
+
+  record() and reset() update the counters with interrupts masked, so
+  accesses from the main loop, from interrupt handlers (ParallelCapture's
+  tick(), ParallelArbiter::submit() in an ISR) and from DMA completion
+  callbacks can all be counted at once without losing any.  get() and
+  dump() read the counters as they stand, so a figure read while an
+  interrupt is recording can be one access behind the others.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PARALLEL_STATS_H
+#define PARALLEL_STATS_H
+
+#include "Parallel.h"
+
+#if PARALLEL_ENABLE_STATS
+
+// Histogram bucket n counts calls taking [2^(n-1), 2^n) cycles, the last 
+// bucket catches everything longer.
+#define PARALLEL_STATS_BUCKETS	20
+
+// Counters for one chip select
+typedef struct
+{
+	uint32_t bytes;
+	uint32_t accesses;
+	uint32_t peakBurst;
+	uint32_t cycles;
+	uint32_t histogram[PARALLEL_STATS_BUCKETS];
+} ParallelStats_t;
+
+class ParallelStatsClass {
+public:
+  // Starts the DWT cycle counter, called by ParallelClass::begin()
+  void begin();
+  
+  // Clears all counters
+  void reset();
+  
+  // Counters for one chip select (PARALLEL_CS_NONE shares NCS0's)
+  const ParallelStats_t &get(ParallelChipSelect_t cs);
+  
+  // Prints all chip selects that have seen traffic, one line each:
+  //   CS1 bytes=9640 accesses=12 peak=9600 cycles=1061340 hist=0,0,...
+  void dump(Print &out);
+  
+  // Called by the ParallelClass access functions
+  void record(uint32_t cs, uint32_t bytes, uint32_t startCycles);
+  
+  static inline uint32_t now() { return DWT->CYCCNT; }
+};
+
+extern ParallelStatsClass ParallelStats;
+
+// Bracket an access: BEGIN notes the byte count and start time, END (at the
+// single exit of the function) records them against the chip select.
+#define PARALLEL_STATS_BEGIN(bytes)	\
+	uint32_t parallelStatsStart = ParallelStatsClass::now();	\
+	uint32_t parallelStatsBytes = (bytes)
+#define PARALLEL_STATS_END(cs)	\
+	ParallelStats.record((cs), parallelStatsBytes, parallelStatsStart)
+
+#else
+
+#define PARALLEL_STATS_BEGIN(bytes)
+#define PARALLEL_STATS_END(cs)
+
+#endif
+
+#endif
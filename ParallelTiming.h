@@ -0,0 +1,213 @@
+/*
+  ParallelTiming.h
+
+  Works out SMC timing register values from the timing parameters found in a
+  device data sheet, so sketches don't have to hand compute cycle counts for
+  setAddressSetupTiming(), setPulseTiming() and setCycleTiming().
+
+  Times are given in nanoseconds.  The solver rounds each one up to whole MCK
+  cycles, then up again to the nearest value the SMC can actually encode (the
+  SETUP, PULSE and CYCLE fields are non-linear, see the SAM3X data sheet), and
+  returns the resulting register images.  Everything is constexpr so profiles
+  known at compile time cost nothing at run time:
+
+    const ParallelTimingProfile_t lcdProfile = { 10, 80, 10, 200, 0 };
+    constexpr ParallelSmcTiming_t lcdTiming = parallelSolveTiming(lcdProfile);
+    static_assert(lcdTiming.valid, "LCD timing out of SMC range");
+    ...
+    Parallel.setTiming(lcdTiming);
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PARALLEL_TIMING_H
+#define PARALLEL_TIMING_H
+
+#ifdef PARALLEL_HOST_SIM
+#include "ParallelSim.h"
+#else
+#include "Arduino.h"
+#endif
+
+// Master clock the SMC runs from
+#ifndef PARALLEL_MCK
+#define PARALLEL_MCK	VARIANT_MCK
+#endif
+
+// Returned for a cycle count the SMC can't encode
+#define PARALLEL_TIMING_INVALID	0xFFFFu
+
+// Device timing from the data sheet, all in nanoseconds.  Use 0 for
+// parameters the device doesn't specify.
+typedef struct
+{
+	uint16_t addressSetup;	// tAS: address/CS valid before NWE/NRD falls
+	uint16_t pulseWidth;	// tPW: minimum NWE/NRD low time
+	uint16_t hold;			// tAH: address/CS held after NWE/NRD rises
+	uint16_t cycle;			// tCYC: minimum time from one access to the next
+	uint16_t readAccess;	// tACC: NRD falling to read data valid
+} ParallelTimingProfile_t;
+
+// Solved SMC register images for one chip select
+typedef struct
+{
+	uint32_t setup;			// SMC_SETUP
+	uint32_t pulse;			// SMC_PULSE
+	uint32_t cycle;			// SMC_CYCLE
+	uint16_t writeCycles;	// MCK cycles per write access
+	uint16_t readCycles;	// MCK cycles per read access
+	bool valid;				// false if the device is too slow for the SMC
+} ParallelSmcTiming_t;
+
+constexpr uint32_t parallelMax(uint32_t a, uint32_t b)
+{
+	return (a > b) ? a : b;
+}
+
+// Nanoseconds to MCK cycles, rounded up
+constexpr uint32_t parallelNsToCycles(uint32_t ns, uint32_t mck)
+{
+	return (uint32_t)(((uint64_t)ns * mck + 999999999ull) / 1000000000ull);
+}
+
+// SETUP fields encode 128 * bit5 + bits[4:0] cycles
+constexpr uint32_t parallelLegalSetup(uint32_t c)
+{
+	return (c <= 31) ? c : (c <= 128) ? 128 : (c <= 159) ? c : PARALLEL_TIMING_INVALID;
+}
+
+constexpr uint32_t parallelEncodeSetup(uint32_t c)
+{
+	return (c <= 31) ? c : (0x20 | ((c - 128) & 0x1F));
+}
+
+// PULSE fields encode 256 * bit6 + bits[5:0] cycles
+constexpr uint32_t parallelLegalPulse(uint32_t c)
+{
+	return (c <= 63) ? c : (c <= 256) ? 256 : (c <= 319) ? c : PARALLEL_TIMING_INVALID;
+}
+
+constexpr uint32_t parallelEncodePulse(uint32_t c)
+{
+	return (c <= 63) ? c : (0x40 | ((c - 256) & 0x3F));
+}
+
+// CYCLE fields encode 256 * bits[8:7] + bits[6:0] cycles
+constexpr uint32_t parallelLegalCycle(uint32_t c)
+{
+	return (c > 895) ? PARALLEL_TIMING_INVALID 
+		: ((c & 0xFF) <= 127) ? c 
+		: ((c >> 8) + 1) << 8;
+}
+
+constexpr uint32_t parallelEncodeCycle(uint32_t c)
+{
+	return ((c >> 8) << 7) | (c & 0x7F);
+}
+
+constexpr uint32_t parallelDecodeCycle(uint32_t field)
+{
+	return ((field >> 7) & 0x3) * 256 + (field & 0x7F);
+}
+
+// Final step: everything has been legalized, build the register images.  The
+// NCS setups are 0 so chip select frames the whole NWE/NRD pulse plus hold.
+constexpr ParallelSmcTiming_t parallelBuildTiming(uint32_t setup, 
+		uint32_t writePulse, uint32_t readPulse, 
+		uint32_t ncsWritePulse, uint32_t ncsReadPulse,
+		uint32_t writeCycle, uint32_t readCycle)
+{
+	return {
+		SMC_SETUP_NWE_SETUP(parallelEncodeSetup(setup))
+			| SMC_SETUP_NCS_WR_SETUP(0)
+			| SMC_SETUP_NRD_SETUP(parallelEncodeSetup(setup))
+			| SMC_SETUP_NCS_RD_SETUP(0),
+		SMC_PULSE_NWE_PULSE(parallelEncodePulse(writePulse))
+			| SMC_PULSE_NCS_WR_PULSE(parallelEncodePulse(ncsWritePulse))
+			| SMC_PULSE_NRD_PULSE(parallelEncodePulse(readPulse))
+			| SMC_PULSE_NCS_RD_PULSE(parallelEncodePulse(ncsReadPulse)),
+		SMC_CYCLE_NWE_CYCLE(parallelEncodeCycle(writeCycle))
+			| SMC_CYCLE_NRD_CYCLE(parallelEncodeCycle(readCycle)),
+		(uint16_t)writeCycle,
+		(uint16_t)readCycle,
+		(setup != PARALLEL_TIMING_INVALID)
+			&& (writePulse != PARALLEL_TIMING_INVALID)
+			&& (readPulse != PARALLEL_TIMING_INVALID)
+			&& (ncsWritePulse != PARALLEL_TIMING_INVALID)
+			&& (ncsReadPulse != PARALLEL_TIMING_INVALID)
+			&& (writeCycle != PARALLEL_TIMING_INVALID)
+			&& (readCycle != PARALLEL_TIMING_INVALID)
+	};
+}
+
+// The cycle has to cover the NCS pulse and the device's own minimum
+constexpr ParallelSmcTiming_t parallelSolveCycles(uint32_t setup,
+		uint32_t writePulse, uint32_t readPulse,
+		uint32_t ncsWritePulse, uint32_t ncsReadPulse, uint32_t cycle)
+{
+	return parallelBuildTiming(setup, writePulse, readPulse, 
+		ncsWritePulse, ncsReadPulse,
+		parallelLegalCycle(parallelMax(ncsWritePulse, cycle)),
+		parallelLegalCycle(parallelMax(ncsReadPulse, cycle)));
+}
+
+// NCS stays low for setup + pulse + hold
+constexpr ParallelSmcTiming_t parallelSolvePulses(uint32_t setup,
+		uint32_t writePulse, uint32_t readPulse, uint32_t hold, uint32_t cycle)
+{
+	return parallelSolveCycles(setup, writePulse, readPulse,
+		parallelLegalPulse(setup + writePulse + hold),
+		parallelLegalPulse(setup + readPulse + hold),
+		cycle);
+}
+
+// Read data is latched on the rising edge of NRD, so the read pulse must 
+// also cover the access time.
+constexpr ParallelSmcTiming_t parallelSolveCyclesFromProfile(uint32_t setup, 
+		uint32_t pulse, uint32_t hold, uint32_t cycle, uint32_t access)
+{
+	return parallelSolvePulses(parallelLegalSetup(setup),
+		parallelLegalPulse(parallelMax(pulse, 1)),
+		parallelLegalPulse(parallelMax(parallelMax(pulse, access), 1)),
+		hold, cycle);
+}
+
+// Computes the fastest legal SMC timings for a device profile
+constexpr ParallelSmcTiming_t parallelSolveTiming(const ParallelTimingProfile_t &profile,
+		uint32_t mck = PARALLEL_MCK)
+{
+	return parallelSolveCyclesFromProfile(
+		parallelNsToCycles(profile.addressSetup, mck),
+		parallelNsToCycles(profile.pulseWidth, mck),
+		parallelNsToCycles(profile.hold, mck),
+		parallelNsToCycles(profile.cycle, mck),
+		parallelNsToCycles(profile.readAccess, mck));
+}
+
+// Throughput the solved timing achieves for back to back accesses.  Pass 2 
+// for bytesPerAccess on a 16-bit bus.
+constexpr uint32_t parallelWriteBytesPerSecond(const ParallelSmcTiming_t &timing,
+		uint32_t bytesPerAccess = 1, uint32_t mck = PARALLEL_MCK)
+{
+	return (timing.valid && timing.writeCycles) ? (mck / timing.writeCycles) * bytesPerAccess : 0;
+}
+
+constexpr uint32_t parallelReadBytesPerSecond(const ParallelSmcTiming_t &timing,
+		uint32_t bytesPerAccess = 1, uint32_t mck = PARALLEL_MCK)
+{
+	return (timing.valid && timing.readCycles) ? (mck / timing.readCycles) * bytesPerAccess : 0;
+}
+
+#endif
@@ -0,0 +1,257 @@
+/*
+  ParallelTuner.cpp
+
+  Bus timing search with write/readback verification.  See ParallelTuner.h
+  for usage.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "ParallelTuner.h"
+
+ParallelTuner::ParallelTuner(ParallelClass &bus)
+	: _bus(bus), _trials(0), _seed(1)
+{
+	memset(&_profile, 0, sizeof(_profile));
+	memset(&_limit, 0, sizeof(_limit));
+	memset(&_timing, 0, sizeof(_timing));
+}
+
+ParallelSmcTiming_t ParallelTuner::build(const uint16_t *c)
+{
+	return parallelSolveCyclesFromProfile(c[TUNE_SETUP], c[TUNE_PULSE], 
+		c[TUNE_HOLD], c[TUNE_CYCLE], c[TUNE_ACCESS]);
+}
+
+bool ParallelTuner::trial(const uint16_t *c, uint32_t offset, uint32_t length)
+{
+	ParallelSmcTiming_t timing = build(c);
+
+	if (!_bus.setTiming(timing))
+		return false;
+
+	_trials++;
+	return verify(offset, length);
+}
+
+// Rounded down, so parallelSolveTiming() gives the same cycle counts back
+ParallelTimingProfile_t ParallelTuner::toProfile(const uint16_t *c)
+{
+	ParallelTimingProfile_t profile;
+
+	profile.addressSetup = (uint16_t)((uint64_t)c[TUNE_SETUP] * 1000000000ull / PARALLEL_MCK);
+	profile.pulseWidth = (uint16_t)((uint64_t)c[TUNE_PULSE] * 1000000000ull / PARALLEL_MCK);
+	profile.hold = (uint16_t)((uint64_t)c[TUNE_HOLD] * 1000000000ull / PARALLEL_MCK);
+	profile.cycle = (uint16_t)((uint64_t)c[TUNE_CYCLE] * 1000000000ull / PARALLEL_MCK);
+	profile.readAccess = (uint16_t)((uint64_t)c[TUNE_ACCESS] * 1000000000ull / PARALLEL_MCK);
+	return profile;
+}
+
+bool ParallelTuner::tune(const ParallelTimingProfile_t &start, uint32_t offset,
+                         uint32_t length, uint8_t marginPercent)
+{
+	// the order the first three are lowered in; the read pulse is the 
+	// longer of the pulse and access times, so the pulse goes first
+	static const uint8_t order[3] = { TUNE_PULSE, TUNE_ACCESS, TUNE_SETUP };
+	uint16_t c[TUNE_COUNT];
+
+	c[TUNE_SETUP] = (uint16_t)parallelNsToCycles(start.addressSetup, PARALLEL_MCK);
+	c[TUNE_PULSE] = (uint16_t)parallelNsToCycles(start.pulseWidth, PARALLEL_MCK);
+	c[TUNE_ACCESS] = (uint16_t)parallelNsToCycles(start.readAccess, PARALLEL_MCK);
+	c[TUNE_HOLD] = (uint16_t)parallelNsToCycles(start.hold, PARALLEL_MCK);
+	c[TUNE_CYCLE] = (uint16_t)parallelNsToCycles(start.cycle, PARALLEL_MCK);
+	_trials = 0;
+
+	if (!trial(c, offset, length))
+	{
+		_bus.setTiming(parallelSolveTiming(start));
+		return false;
+	}
+
+	for (uint8_t k = 0; k < 3; k++)
+	{
+		uint16_t &value = c[order[k]];
+		uint16_t floor = (order[k] == TUNE_PULSE) ? 1 : 0;
+
+		while (value > floor)
+		{
+			value--;
+			if (!trial(c, offset, length))
+			{
+				value++;
+				break;
+			}
+		}
+	}
+
+	// The cycle stretches to cover setup + pulse + hold, so a long cycle
+	// hides the hold time and vice versa.  Try each hold with the shortest
+	// cycle that works and keep the quickest pair.
+	uint16_t startHold = c[TUNE_HOLD];
+	uint16_t startCycle = c[TUNE_CYCLE];
+	uint16_t bestHold = startHold;
+	uint16_t bestCycle = startCycle;
+	uint32_t bestCost = build(c).readCycles + build(c).writeCycles;
+
+	for (uint16_t hold = 0; hold <= startHold; hold++)
+	{
+		c[TUNE_HOLD] = hold;
+		c[TUNE_CYCLE] = startCycle;
+
+		if (!trial(c, offset, length))
+			continue;
+
+		while (c[TUNE_CYCLE] > 0)
+		{
+			c[TUNE_CYCLE]--;
+			if (!trial(c, offset, length))
+			{
+				c[TUNE_CYCLE]++;
+				break;
+			}
+		}
+
+		ParallelSmcTiming_t timing = build(c);
+		uint32_t cost = timing.readCycles + timing.writeCycles;
+
+		if (cost < bestCost)
+		{
+			bestCost = cost;
+			bestHold = hold;
+			bestCycle = c[TUNE_CYCLE];
+		}
+
+		// the cycle no longer matters, so longer holds only cost time
+		if (c[TUNE_CYCLE] == 0)
+			break;
+	}
+
+	c[TUNE_HOLD] = bestHold;
+	c[TUNE_CYCLE] = bestCycle;
+	_limit = toProfile(c);
+
+	for (uint8_t k = 0; k < TUNE_COUNT; k++)
+	{
+		uint16_t margin = (uint16_t)((c[k] * marginPercent + 99) / 100);
+
+		if ((marginPercent > 0) && (margin == 0))
+			margin = 1;
+		c[k] += margin;
+	}
+
+	_profile = toProfile(c);
+	_timing = build(c);
+	_bus.setTiming(_timing);
+	return true;
+}
+
+void ParallelTuner::print(Print &out)
+{
+	out.print("const ParallelTimingProfile_t profile = { ");
+	out.print((unsigned long)_profile.addressSetup);
+	out.print(", ");
+	out.print((unsigned long)_profile.pulseWidth);
+	out.print(", ");
+	out.print((unsigned long)_profile.hold);
+	out.print(", ");
+	out.print((unsigned long)_profile.cycle);
+	out.print(", ");
+	out.print((unsigned long)_profile.readAccess);
+	out.print(" };	// ");
+	out.print((unsigned long)_timing.writeCycles);
+	out.print("/");
+	out.print((unsigned long)_timing.readCycles);
+	out.println(" cycle write/read");
+}
+
+// Word i of the scratch area, a byte or a halfword as the bus width has it
+void ParallelTuner::put(uint32_t offset, uint32_t i, uint16_t value)
+{
+	if (_bus.getBusWidth() == PARALLEL_BUS_WIDTH_8)
+		_bus.write(offset + i, (uint8_t)value);
+	else
+		_bus.write16(offset + 2 * i, value);
+}
+
+uint16_t ParallelTuner::get(uint32_t offset, uint32_t i)
+{
+	if (_bus.getBusWidth() == PARALLEL_BUS_WIDTH_8)
+		return _bus.read(offset + i);
+
+	return _bus.read16(offset + 2 * i);
+}
+
+// xorshift, reseeded for each check so it can be replayed for the compare
+uint16_t ParallelTuner::random()
+{
+	_seed ^= _seed << 13;
+	_seed ^= _seed >> 17;
+	_seed ^= _seed << 5;
+	return (uint16_t)_seed;
+}
+
+bool ParallelTuner::verify(uint32_t offset, uint32_t length)
+{
+	ParallelBusWidth_t width = _bus.getBusWidth();
+	uint8_t bits = (width == PARALLEL_BUS_WIDTH_8) ? 8 : (width == PARALLEL_BUS_WIDTH_14) ? 14 : 16;
+	uint16_t mask = (uint16_t)((1ul << bits) - 1);
+	uint32_t n = (width == PARALLEL_BUS_WIDTH_8) ? length : length / 2;
+
+	if (n < 2)
+		return false;
+
+	// Walking ones and zeros.  Each pattern is read back after its 
+	// complement has been written next to it, so a read that misses the
+	// data doesn't find it still sitting on the bus.
+	for (uint8_t b = 0; b < bits; b++)
+	{
+		for (uint8_t inverse = 0; inverse < 2; inverse++)
+		{
+			uint16_t p = inverse ? (uint16_t)(~(1u << b) & mask) : (uint16_t)(1u << b);
+
+			put(offset, 0, p);
+			put(offset, 1, (uint16_t)(~p & mask));
+			if ((get(offset, 0) != p) || (get(offset, 1) != (uint16_t)(~p & mask)))
+				return false;
+		}
+	}
+
+	// Address in address: each word holds its own index, so an address that
+	// hasn't settled shows up as the wrong word
+	for (uint32_t i = 0; i < n; i++)
+		put(offset, i, (uint16_t)((i ^ (i >> bits)) & mask));
+
+	for (uint32_t i = 0; i < n; i++)
+	{
+		if (get(offset, i) != (uint16_t)((i ^ (i >> bits)) & mask))
+			return false;
+	}
+
+	// Random data, a different run each time
+	uint32_t seed = (_seed + 0x9E3779B9u) | 1;
+
+	_seed = seed;
+	for (uint32_t i = 0; i < n; i++)
+		put(offset, i, random() & mask);
+
+	_seed = seed;
+	for (uint32_t i = 0; i < n; i++)
+	{
+		if (get(offset, i) != (random() & mask))
+			return false;
+	}
+
+	return true;
+}
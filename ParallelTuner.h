@@ -0,0 +1,99 @@
+/*
+  ParallelTuner.h
+
+  Finds the fastest bus timings a particular board and device actually
+  work at, instead of hand tuning setPulseTiming()/setCycleTiming() for
+  each board revision.  Starting from a profile known to work (the data
+  sheet's worst case, say), the tuner lowers each timing in turn and checks
+  a scratch area of the device with write/readback patterns after every
+  step: walking ones and zeros on the data lines, each location's own
+  address, and pseudo-random data.  The fastest timing that passes is
+  backed off by a safety margin, loaded, and can be printed as a
+  ParallelTimingProfile_t to build into the sketch:
+
+    const ParallelTimingProfile_t datasheet = { 20, 70, 10, 120, 70 };
+    ParallelTuner tuner(Parallel);
+
+    if (tuner.tune(datasheet, 0x1000, 256))
+      tuner.print(Serial);
+
+  The scratch area needs to be RAM (or a register that reads back what was
+  written) and its contents are lost.  Address setup, write pulse and read
+  access are found first, with the hold and cycle times at the starting
+  values; then each hold time from 0 up is tried with the shortest cycle
+  that passes, and the pair with the shortest accesses is kept.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PARALLEL_TUNER_H
+#define PARALLEL_TUNER_H
+
+#include "Parallel.h"
+
+class ParallelTuner {
+public:
+  ParallelTuner(ParallelClass &bus);
+
+  // Searches down from start on the scratch area offset .. offset +
+  // length - 1, then adds marginPercent to each timing (at least one MCK
+  // cycle) and loads the result.  Returns false, with start loaded, if
+  // start itself fails.
+  bool tune(const ParallelTimingProfile_t &start, uint32_t offset,
+            uint32_t length, uint8_t marginPercent = 25);
+
+  // The tuned profile (margin included) and its register images
+  const ParallelTimingProfile_t &profile() { return _profile; }
+  const ParallelSmcTiming_t &timing() { return _timing; }
+
+  // The fastest passing timing, without the margin
+  const ParallelTimingProfile_t &limit() { return _limit; }
+
+  // Timings tried during the last tune()
+  uint16_t trials() { return _trials; }
+
+  // Prints the profile as a line of C++ to paste into a sketch
+  void print(Print &out);
+
+  // The write/readback check on its own, with the timings currently loaded
+  bool verify(uint32_t offset, uint32_t length);
+
+private:
+  typedef enum
+  {
+    TUNE_SETUP,
+    TUNE_PULSE,
+    TUNE_ACCESS,
+    TUNE_HOLD,
+    TUNE_CYCLE,
+    TUNE_COUNT
+  } TuneParameter_t;
+
+  ParallelSmcTiming_t build(const uint16_t *cycles);
+  bool trial(const uint16_t *cycles, uint32_t offset, uint32_t length);
+  ParallelTimingProfile_t toProfile(const uint16_t *cycles);
+  void put(uint32_t offset, uint32_t i, uint16_t value);
+  uint16_t get(uint32_t offset, uint32_t i);
+  uint16_t random();
+
+  ParallelClass &_bus;
+  uint16_t _trials;
+  uint32_t _seed;
+  ParallelTimingProfile_t _profile;
+  ParallelTimingProfile_t _limit;
+  ParallelSmcTiming_t _timing;
+};
+
+#endif
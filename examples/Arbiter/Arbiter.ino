@@ -0,0 +1,197 @@
+/*
+  Shares an index addressed LCD controller on NCS0 (command register at
+  A0 = 1, data at A0 = 0) between the main loop, which draws rows of
+  pixels, and a timer interrupt, which updates a status line.  Each update
+  is a command followed by its data, and neither may be split by the other.
+  The sketch runs once with both sides writing straight to the bus and once
+  through a ParallelArbiter, and prints how many updates the interrupt had
+  to defer.
+
+  The sketch also builds on a Linux host against the simulator, where a
+  model controller checks that every command gets exactly its own data, so
+  the first run shows the corruption and the second that it is gone:
+
+    g++ -std=gnu++11 -DPARALLEL_HOST_SIM -I. *.cpp -x c smc.c \
+        -x c++ examples/Arbiter/Arbiter.ino
+
+  This sketch is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Parallel.h>
+#include <ParallelArbiter.h>
+
+#define LCD_DATA	0x00
+#define LCD_COMMAND	0x01
+
+// Commands, and the data bytes each one takes
+#define CMD_ROW		0x20
+#define CMD_STATUS	0x05
+
+const uint32_t updatesPerSecond = 20000;
+const uint32_t rows = 2000;
+
+ParallelArbiter lcd(Parallel);
+ParallelTransaction status;
+uint8_t statusText[CMD_STATUS];
+uint8_t row[CMD_ROW];
+
+volatile bool arbitrated;
+volatile uint32_t updates;
+volatile uint32_t skipped;
+
+#ifdef PARALLEL_HOST_SIM
+// A command is followed by as many data bytes as its value, all of them
+// equal to it.  Anything else is how a real controller gets confused.
+class CheckedLcd : public ParallelSimDevice {
+public:
+  CheckedLcd() { clear(); }
+  void clear() { command = 0; remaining = 0; errors = 0; }
+  virtual uint16_t read(uint32_t offset, uint8_t width) {
+    (void)offset;
+    (void)width;
+    return 0;
+  }
+  virtual void write(uint32_t offset, uint16_t data, uint8_t width) {
+    (void)width;
+    if (offset == LCD_COMMAND) {
+      if (remaining != 0)
+        errors++;
+      command = (uint8_t)data;
+      remaining = command;
+    } else if ((remaining == 0) || (data != command)) {
+      errors++;
+    } else {
+      remaining--;
+    }
+  }
+  uint8_t command;
+  uint8_t remaining;
+  uint32_t errors;
+};
+
+CheckedLcd checker;
+#endif
+
+void TC3_Handler() {
+  TC_GetStatus(TC1, 0);
+  updates = updates + 1;
+
+  if (!arbitrated) {
+    Parallel.write(LCD_COMMAND, CMD_STATUS);
+    Parallel.writeBlock(LCD_DATA, statusText, sizeof(statusText));
+    return;
+  }
+
+  // the last update is still queued behind the main loop
+  if (status.isPending()) {
+    skipped = skipped + 1;
+    return;
+  }
+
+  status.clear();
+  status.add(LCD_COMMAND, CMD_STATUS);
+  status.add(LCD_DATA, statusText, sizeof(statusText));
+  lcd.submit(status, PARALLEL_PRIORITY_HIGH);
+}
+
+void startTimer() {
+  // TIMER_CLOCK1 is MCK/2
+  pmc_enable_periph_clk(ID_TC3);
+  TC_Configure(TC1, 0, TC_CMR_WAVE | TC_CMR_WAVSEL_UP_RC | TC_CMR_TCCLKS_TIMER_CLOCK1);
+  TC_SetRC(TC1, 0, (VARIANT_MCK / 2) / updatesPerSecond);
+  TC1->TC_CHANNEL[0].TC_IER = TC_IER_CPCS;
+  TC1->TC_CHANNEL[0].TC_IDR = ~TC_IER_CPCS;
+  NVIC_ClearPendingIRQ(TC3_IRQn);
+  NVIC_EnableIRQ(TC3_IRQn);
+  TC_Start(TC1, 0);
+}
+
+void stopTimer() {
+  TC_Stop(TC1, 0);
+  NVIC_DisableIRQ(TC3_IRQn);
+}
+
+void run(bool withArbiter) {
+  arbitrated = withArbiter;
+  updates = 0;
+  skipped = 0;
+#ifdef PARALLEL_HOST_SIM
+  checker.clear();
+#endif
+
+  uint32_t start = micros();
+  startTimer();
+
+  for (uint32_t i = 0; i < rows; i++) {
+    if (withArbiter && !lcd.begin())
+      continue;
+
+    Parallel.write(LCD_COMMAND, CMD_ROW);
+    Parallel.writeBlock(LCD_DATA, row, sizeof(row));
+
+    if (withArbiter)
+      lcd.end();
+  }
+
+  stopTimer();
+  uint32_t elapsed = micros() - start;
+
+  Serial.print(withArbiter ? "arbiter: " : "direct:  ");
+  Serial.print((unsigned long)rows);
+  Serial.print(" rows, ");
+  Serial.print((unsigned long)updates);
+  Serial.print(" updates (");
+  Serial.print((unsigned long)lcd.deferred());
+  Serial.print(" deferred, ");
+  Serial.print((unsigned long)skipped);
+  Serial.print(" skipped) in ");
+  Serial.print((unsigned long)elapsed);
+  Serial.print(" us");
+#ifdef PARALLEL_HOST_SIM
+  Serial.print(", ");
+  Serial.print((unsigned long)checker.errors);
+  Serial.print(" protocol errors");
+#endif
+  Serial.println();
+}
+
+void setup() {
+  Serial.begin(115200);
+
+#ifdef PARALLEL_HOST_SIM
+  ParallelSim.attach(0, &checker);
+#endif
+
+  memset(row, CMD_ROW, sizeof(row));
+  memset(statusText, CMD_STATUS, sizeof(statusText));
+
+  Parallel.begin(PARALLEL_BUS_WIDTH_8, PARALLEL_CS_0, 1, 1, 1);
+  Parallel.setAddressSetupTiming(1, 1, 1, 1);
+  Parallel.setPulseTiming(4, 4, 4, 4);
+  Parallel.setCycleTiming(6, 6);
+
+  run(false);
+  run(true);
+}
+
+void loop() {
+}
+
+#ifdef PARALLEL_HOST_SIM
+int main() {
+  setup();
+  return 0;
+}
+#endif
@@ -0,0 +1,192 @@
+/*
+  Sends blocks to an S1D13700 on NCS1 (A0 on A0) with writeAsync(): a cursor
+  set and memory write command, then the block through the DMA controller
+  to the data register.  The blocks are 1, 4095, 4096 and 10000 bytes long,
+  so the longer ones take more than one DMAC buffer transfer and are
+  restarted from DMAC_Handler, plus an empty one.  For each the sketch
+  prints how long writeAsync() took to return, how long wait() then took
+  and how many times the callback ran, which should be exactly once.
+
+  The sketch also builds on a Linux host against the simulator, which runs
+  the DMAC registers the library programs.  There a model controller also
+  checks that:
+
+    - every byte lands in display memory, and only on the data register
+    - isBusy() is true for every byte the DMA moves and false once the
+      callback runs, and wait() returns straight away after that
+    - the block went out in as many DMAC transfers as it needs (4095 bytes
+      each), seen as the channel's source address being reprogrammed
+
+  The simulator runs a DMA transfer to the end as soon as it's started, so
+  there writeAsync() only returns once the block has gone:
+
+    g++ -std=gnu++11 -DPARALLEL_HOST_SIM -I. *.cpp -x c smc.c \
+        -x c++ examples/AsyncWrite/AsyncWrite.ino
+
+  This sketch is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Parallel.h>
+
+#define LCD_DATA	0x00
+#define LCD_COMMAND	0x01
+#define CSRW		0x46
+#define MWRITE		0x42
+#define LAYER		0x1000
+
+const size_t sizes[] = { 0, 1, 4095, 4096, 10000 };
+
+uint8_t block[10000];
+
+volatile uint8_t callbacks;
+volatile bool busyInCallback;
+
+void done() {
+  callbacks++;
+  busyInCallback = Parallel.isBusy();
+}
+
+#ifdef PARALLEL_HOST_SIM
+// Cursor set and memory write, with a note of the DMA state at each data
+// byte
+class ModelLcd : public ParallelSimDevice {
+public:
+  ModelLcd() { reset(); }
+
+  void reset() {
+    memset(memory, 0, sizeof(memory));
+    cursor = 0;
+    cmd = 0;
+    count = 0;
+    dataWrites = 0;
+    idleWrites = 0;
+    chunks = 0;
+    source = 0;
+  }
+
+  virtual uint16_t read(uint32_t offset, uint8_t width) {
+    (void)offset;
+    (void)width;
+    return 0;
+  }
+
+  virtual void write(uint32_t offset, uint16_t data, uint8_t width) {
+    (void)width;
+    if (offset == LCD_COMMAND) {
+      cmd = (uint8_t)data;
+      count = 0;
+    } else if (offset != LCD_DATA) {
+      cmd = 0;
+    } else if (cmd == CSRW) {
+      if (count++ == 0)
+        cursor = (uint8_t)data;
+      else
+        cursor |= (uint16_t)data << 8;
+    } else if (cmd == MWRITE) {
+      uint32_t saddr = DMAC->DMAC_CH_NUM[PARALLEL_DMA_CHANNEL].DMAC_SADDR;
+
+      memory[cursor++] = (uint8_t)data;
+      dataWrites++;
+      if (!Parallel.isBusy())
+        idleWrites++;
+      if (saddr != source) {
+        source = saddr;
+        chunks++;
+      }
+    }
+  }
+
+  uint8_t memory[0x10000];
+  uint16_t cursor;
+  uint8_t cmd;
+  uint8_t count;
+  uint32_t dataWrites;
+  uint32_t idleWrites;
+  uint32_t chunks;
+  uint32_t source;
+};
+
+ModelLcd model;
+#endif
+
+void send(size_t n) {
+#ifdef PARALLEL_HOST_SIM
+  model.reset();
+#endif
+  callbacks = 0;
+  busyInCallback = true;
+
+  Parallel.write(LCD_COMMAND, CSRW);
+  Parallel.write(LCD_DATA, LAYER & 0xFF);
+  Parallel.write(LCD_DATA, LAYER >> 8);
+  Parallel.write(LCD_COMMAND, MWRITE);
+
+  uint32_t start = micros();
+  Parallel.writeAsync(LCD_DATA, block, n, done);
+  uint32_t queued = micros() - start;
+  Parallel.wait();
+  uint32_t finished = micros() - start;
+
+  Serial.print((unsigned long)n);
+  Serial.print(" bytes: returned after ");
+  Serial.print((unsigned long)queued);
+  Serial.print(" us, done after ");
+  Serial.print((unsigned long)finished);
+  Serial.print(" us, ");
+  Serial.print((unsigned long)callbacks);
+  Serial.print(" callback");
+  Serial.print(callbacks == 1 && !busyInCallback && !Parallel.isBusy() ? "" : ", completion WRONG");
+#ifdef PARALLEL_HOST_SIM
+  uint32_t chunks = (n + PARALLEL_DMA_MAX_BLOCK - 1) / PARALLEL_DMA_MAX_BLOCK;
+
+  Serial.print("; ");
+  Serial.print((unsigned long)model.chunks);
+  Serial.print(" DMA transfers");
+  Serial.print((model.dataWrites == n) && (memcmp(&model.memory[LAYER], block, n) == 0)
+    ? ", bytes right" : ", bytes WRONG");
+  Serial.print(model.idleWrites == 0 ? ", busy right" : ", busy WRONG");
+  Serial.print(model.chunks == chunks ? ", transfers right" : ", transfers WRONG");
+#endif
+  Serial.println();
+}
+
+void setup() {
+  Serial.begin(115200);
+
+#ifdef PARALLEL_HOST_SIM
+  ParallelSim.attach(1, &model);
+#endif
+
+  for (size_t i = 0; i < sizeof(block); i++)
+    block[i] = (uint8_t)(i * 7 + (i >> 8));
+
+  Parallel.begin(PARALLEL_BUS_WIDTH_8, PARALLEL_CS_1, 1, 0, 1);
+  Parallel.setAddressSetupTiming(5, 1, 5, 1);
+  Parallel.setPulseTiming(50, 60, 50, 60);
+  Parallel.setCycleTiming(110, 110);
+
+  for (uint8_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    send(sizes[i]);
+}
+
+void loop() {
+}
+
+#ifdef PARALLEL_HOST_SIM
+int main() {
+  setup();
+  return 0;
+}
+#endif
@@ -0,0 +1,113 @@
+/*
+  Tunes the bus timings for an SRAM on NCS0, starting from its data sheet
+  worst case, and prints the profile to build into the sketch.  The first
+  256 bytes of the SRAM are overwritten.
+
+  The sketch also builds on a Linux host against the simulator, where it
+  tunes against simulated memories with known minimum timings and checks
+  that the search finds the fastest timing each one allows:
+
+    g++ -std=gnu++11 -DPARALLEL_HOST_SIM -I. *.cpp -x c smc.c \
+        -x c++ examples/AutoTune/AutoTune.ino
+
+  This sketch is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Parallel.h>
+#include <ParallelTuner.h>
+
+// tAS, tPW, tAH, tCYC, tACC in ns
+const ParallelTimingProfile_t datasheet = { 30, 120, 30, 250, 120 };
+
+ParallelTuner tuner(Parallel);
+
+bool tune() {
+  if (!tuner.tune(datasheet, 0, 256)) {
+    Serial.println("data sheet timing fails");
+    return false;
+  }
+
+  ParallelSmcTiming_t limit = parallelSolveTiming(tuner.limit());
+
+  Serial.print("limit ");
+  Serial.print((unsigned long)limit.writeCycles);
+  Serial.print("/");
+  Serial.print((unsigned long)limit.readCycles);
+  Serial.print(" cycles, ");
+  Serial.print((unsigned long)tuner.trials());
+  Serial.println(" trials");
+  tuner.print(Serial);
+  return true;
+}
+
+#ifdef PARALLEL_HOST_SIM
+uint32_t larger(uint32_t a, uint32_t b) {
+  return (a > b) ? a : b;
+}
+
+// Setup, write pulse, read access, hold and cycle minimums in MCK cycles
+void check(uint32_t s, uint32_t p, uint32_t a, uint32_t h, uint32_t c) {
+  ParallelSimTimedMemory memory(s, p, a, h, c);
+  // the SMC's read pulse is the longer of the pulse and access times
+  uint32_t write = larger(s + larger(p, 1) + h, c);
+  uint32_t read = larger(s + larger(larger(p, a), 1) + h, c);
+
+  ParallelSim.attach(0, &memory);
+  Serial.print("device ");
+  Serial.print((unsigned long)write);
+  Serial.print("/");
+  Serial.print((unsigned long)read);
+  Serial.print(" cycles: ");
+
+  if (tune()) {
+    ParallelSmcTiming_t limit = parallelSolveTiming(tuner.limit());
+    bool found = (limit.writeCycles == write) && (limit.readCycles == read);
+
+    // with the margin, nothing breaks the device's timing
+    memory.violations = 0;
+    bool safe = tuner.verify(0, 256) && (memory.violations == 0);
+
+    Serial.println(found && safe ? "  converged" : "  WRONG");
+  }
+
+  ParallelSim.attach(0, NULL);
+}
+#endif
+
+void setup() {
+  Serial.begin(115200);
+
+  Parallel.begin(PARALLEL_BUS_WIDTH_8, PARALLEL_CS_0, 16, 1, 1);
+
+#ifdef PARALLEL_HOST_SIM
+  check(1, 3, 4, 1, 8);
+  check(0, 2, 2, 0, 3);
+  check(2, 4, 7, 2, 6);
+  check(0, 5, 1, 3, 16);
+  check(3, 1, 9, 0, 10);
+#else
+  tune();
+#endif
+}
+
+void loop() {
+}
+
+#ifdef PARALLEL_HOST_SIM
+int main() {
+  setup();
+  return 0;
+}
+#endif
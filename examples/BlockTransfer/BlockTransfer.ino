@@ -0,0 +1,169 @@
+/*
+  Compares moving a 320x240 1bpp frame (9600 bytes) over the bus a byte at
+  a time, with a write() or read() call per byte, against one writeBlock(),
+  fill() or readBlock() call, and prints the CPU cycles each takes.  Any
+  8-bit device on NCS0 with a data register at offset 0 will do.
+
+  The sketch also builds on a Linux host against the simulator, where it
+  counts the bus accesses of each version and checks that the block calls
+  make exactly the accesses the per byte loops do.  The simulator only
+  models bus time, which is the same for both, so the cycles only differ
+  on the board:
+
+    g++ -std=gnu++11 -DPARALLEL_HOST_SIM -I. *.cpp -x c smc.c \
+        -x c++ examples/BlockTransfer/BlockTransfer.ino
+
+  This sketch is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Parallel.h>
+
+#define DATA	0x00
+
+typedef enum {
+  TEST_WRITE,
+  TEST_FILL,
+  TEST_READ,
+  TEST_COUNT
+} Test_t;
+
+const char *names[TEST_COUNT] = {
+  "writeBlock: ",
+  "fill:       ",
+  "readBlock:  "
+};
+
+uint8_t frame[9600];
+uint8_t readBack[sizeof(frame)];
+
+#ifdef PARALLEL_HOST_SIM
+std::vector<ParallelSimAccess_t> perByte;
+#endif
+
+uint32_t cycles() {
+#ifdef PARALLEL_HOST_SIM
+  return (uint32_t)ParallelSim.cycles();
+#else
+  return DWT->CYCCNT;
+#endif
+}
+
+void transfer(Test_t test, bool block) {
+  switch (test) {
+  case TEST_WRITE:
+    if (block) {
+      Parallel.writeBlock(DATA, frame, sizeof(frame));
+    } else {
+      for (size_t i = 0; i < sizeof(frame); i++)
+        Parallel.write(DATA, frame[i]);
+    }
+    break;
+
+  case TEST_FILL:
+    if (block) {
+      Parallel.fill(DATA, 0x55, sizeof(frame));
+    } else {
+      for (size_t i = 0; i < sizeof(frame); i++)
+        Parallel.write(DATA, 0x55);
+    }
+    break;
+
+  case TEST_READ:
+    if (block) {
+      Parallel.readBlock(DATA, readBack, sizeof(readBack));
+    } else {
+      for (size_t i = 0; i < sizeof(readBack); i++)
+        readBack[i] = Parallel.read(DATA);
+    }
+    break;
+
+  default:
+    break;
+  }
+}
+
+// Returns the cycles taken
+uint32_t measure(Test_t test, bool block) {
+#ifdef PARALLEL_HOST_SIM
+  ParallelSim.clearTrace();
+#endif
+  uint32_t start = cycles();
+  transfer(test, block);
+  return cycles() - start;
+}
+
+void setup() {
+  Serial.begin(115200);
+
+#ifndef PARALLEL_HOST_SIM
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+  for (size_t i = 0; i < sizeof(frame); i++)
+    frame[i] = (uint8_t)(i * 13 + (i >> 8));
+
+  Parallel.begin(PARALLEL_BUS_WIDTH_8, PARALLEL_CS_0, 1, 1, 1);
+  Parallel.setAddressSetupTiming(1, 1, 1, 1);
+  Parallel.setPulseTiming(4, 4, 4, 4);
+  Parallel.setCycleTiming(6, 6);
+
+#ifdef PARALLEL_HOST_SIM
+  ParallelSim.setTrace(true);
+#endif
+
+  for (uint8_t i = 0; i < TEST_COUNT; i++) {
+    Test_t test = (Test_t)i;
+
+    uint32_t loop = measure(test, false);
+#ifdef PARALLEL_HOST_SIM
+    perByte = ParallelSim.trace();
+#endif
+    uint32_t block = measure(test, true);
+
+    Serial.print(names[test]);
+    Serial.print((unsigned long)block);
+    Serial.print(" cycles, per byte ");
+    Serial.print((unsigned long)loop);
+    Serial.print(" cycles");
+#ifdef PARALLEL_HOST_SIM
+    const std::vector<ParallelSimAccess_t> &trace = ParallelSim.trace();
+    bool same = (trace.size() == perByte.size());
+
+    for (size_t j = 0; same && (j < trace.size()); j++) {
+      same = (trace[j].address == perByte[j].address)
+        && (trace[j].data == perByte[j].data)
+        && (trace[j].read == perByte[j].read);
+    }
+
+    Serial.print("; ");
+    Serial.print((unsigned long)trace.size());
+    Serial.print(" accesses, per byte ");
+    Serial.print((unsigned long)perByte.size());
+    Serial.print(same ? ", same accesses" : ", accesses DIFFER");
+#endif
+    Serial.println();
+  }
+}
+
+void loop() {
+}
+
+#ifdef PARALLEL_HOST_SIM
+int main() {
+  setup();
+  return 0;
+}
+#endif
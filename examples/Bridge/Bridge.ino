@@ -0,0 +1,136 @@
+/*
+  Streams 256 KB from an SRAM on NCS0 to a PC over the native USB port in
+  ParallelBridge frames, and prints the throughput and the number of times
+  the PC held the stream up on the programming port.
+
+  The sketch also builds on a Linux host against the simulator, where the
+  USB link is replaced by a loopback at a range of link rates and the
+  frames that come out are checked against the memory:
+
+    g++ -std=gnu++11 -DPARALLEL_HOST_SIM -I. *.cpp -x c smc.c \
+        -x c++ examples/Bridge/Bridge.ino
+
+  This sketch is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Parallel.h>
+#include <ParallelBridge.h>
+
+const uint32_t length = 262144;
+
+uint8_t pattern(uint32_t offset) {
+  return (uint8_t)(offset ^ (offset >> 8) ^ (offset >> 16));
+}
+
+void run(ParallelTransport &link) {
+  ParallelBridge bridge(Parallel, link);
+  uint32_t start = micros();
+
+  bridge.begin(0, length);
+  while (bridge.poll()) {
+#ifdef PARALLEL_HOST_SIM
+    // the loop's own time on the board
+    ParallelSim.advance(30);
+#endif
+  }
+
+  uint32_t elapsed = micros() - start;
+
+  Serial.print((unsigned long)bridge.frames());
+  Serial.print(" frames, ");
+  Serial.print((unsigned long)((uint64_t)bridge.bytes() * 1000 / elapsed));
+  Serial.print(" KB/s, ");
+  Serial.print((unsigned long)bridge.stalls());
+  Serial.println(" stalls");
+}
+
+#ifdef PARALLEL_HOST_SIM
+// Takes the frames apart as the PC would.  Returns the number of bad ones.
+uint32_t check(const std::vector<uint8_t> &data) {
+  uint32_t errors = 0;
+  uint32_t expected = 0;
+  size_t i = 0;
+
+  while (i + PARALLEL_BRIDGE_HEADER + PARALLEL_BRIDGE_TRAILER <= data.size()) {
+    const uint8_t *f = &data[i];
+    uint16_t n = f[2] | (f[3] << 8);
+    uint32_t sequence = f[4] | (f[5] << 8) | (f[6] << 16) | ((uint32_t)f[7] << 24);
+    uint32_t offset = f[8] | (f[9] << 8) | (f[10] << 16) | ((uint32_t)f[11] << 24);
+    size_t size = PARALLEL_BRIDGE_HEADER + n + PARALLEL_BRIDGE_TRAILER;
+
+    if (f[0] != PARALLEL_BRIDGE_SYNC0 || f[1] != PARALLEL_BRIDGE_SYNC1
+        || i + size > data.size()) {
+      errors++;
+      break;
+    }
+
+    uint16_t crc = f[size - 2] | (f[size - 1] << 8);
+    bool bad = (crc != parallelCrc16(&f[2], PARALLEL_BRIDGE_HEADER - 2 + n))
+               || (sequence != expected++);
+
+    for (uint16_t j = 0; j < n; j++)
+      bad |= (f[PARALLEL_BRIDGE_HEADER + j] != pattern(offset + j));
+
+    errors += bad;
+    i += size;
+  }
+
+  return errors + (i != data.size());
+}
+#endif
+
+void setup() {
+  Serial.begin(115200);
+
+  Parallel.begin(PARALLEL_BUS_WIDTH_8, PARALLEL_CS_0, 18, 1, 1);
+  Parallel.setAddressSetupTiming(0, 0, 0, 0);
+  Parallel.setPulseTiming(3, 3, 3, 3);
+  Parallel.setCycleTiming(4, 4);
+
+  for (uint32_t i = 0; i < length; i++)
+    Parallel.write(i, pattern(i));
+
+#ifdef PARALLEL_HOST_SIM
+  // full and high speed USB, and a link faster than the bus
+  const uint32_t rates[] = { 1000000, 40000000, 100000000 };
+
+  for (int i = 0; i < 3; i++) {
+    ParallelSimLoopback link(rates[i]);
+
+    Serial.print((unsigned long)(rates[i] / 1000));
+    Serial.print(" KB/s link: ");
+    run(link);
+    Serial.print("  bad frames: ");
+    Serial.println((unsigned long)check(link.received));
+  }
+#else
+  SerialUSB.begin(0);
+  while (!SerialUSB)
+    ;
+
+  ParallelPrintTransport usb(SerialUSB);
+  run(usb);
+#endif
+}
+
+void loop() {
+}
+
+#ifdef PARALLEL_HOST_SIM
+int main() {
+  setup();
+  return 0;
+}
+#endif
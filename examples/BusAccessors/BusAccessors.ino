@@ -0,0 +1,210 @@
+/*
+  Compares ParallelBus, whose accesses inline to a single store or load to
+  a constant address, with the same accesses through ParallelClass.  Any
+  8-bit device on NCS1 with registers at offsets 0 and 1 will do.  The bus
+  is set to its fastest timings so that the CPU's part of each access
+  shows, and the sketch prints the CPU cycles 1000 writes and 1000 reads
+  take each way (the best of 5 runs).
+
+  The code size is counted from the sketch's .elf (in the IDE's build
+  folder) by sizes.sh, next to this sketch, which prints the bytes,
+  instructions and calls in probeBusWrite() and the other one-access
+  probes below, and in ParallelClass::write() and read() that the
+  ParallelClass probes call:
+
+    sh sizes.sh BusAccessors.ino.elf
+
+  ParallelBus only keeps the offset bits that reach an address pin (one
+  here), while ParallelClass keeps all 24, so an offset past the device's
+  address lines goes to a different address each way: offset 2 is
+  0x61000000 through ParallelBus but 0x61000002 through ParallelClass.
+
+  The sketch also builds on a Linux host against the simulator.  Both ways
+  end in the same simulated access there, so the sketch doesn't time
+  them, but it checks the compile time address and mask with
+  static_assert(), that both ways make exactly the same bus accesses, and
+  where an out of range offset goes each way:
+
+    g++ -std=gnu++11 -DPARALLEL_HOST_SIM -I. *.cpp -x c smc.c \
+        -x c++ examples/BusAccessors/BusAccessors.ino
+
+  This sketch is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Parallel.h>
+#include <ParallelBus.h>
+
+const uint16_t accesses = 1000;
+
+#define RUNS	5
+
+typedef ParallelBus<PARALLEL_CS_1, PARALLEL_BUS_WIDTH_8, 1> Lcd;
+typedef ParallelBus<PARALLEL_CS_0, PARALLEL_BUS_WIDTH_16, 20> Sram;
+
+// Everything an access needs is known at compile time
+static_assert(Lcd::base == 0x61000000u, "NCS1 window");
+static_assert(Lcd::mask == 0x00000001u, "one address line");
+static_assert(Sram::base == 0x60000000u, "NCS0 window");
+static_assert(Sram::mask == 0x000FFFFEu, "A0 is the byte select in 16-bit mode");
+
+volatile uint8_t sink;
+
+#ifdef PARALLEL_HOST_SIM
+std::vector<ParallelSimAccess_t> viaClass;
+#endif
+
+// One access each way, kept out of line for sizes.sh to find
+__attribute__((noinline)) void probeBusWrite(uint8_t value) {
+  Lcd::write(1, value);
+}
+
+__attribute__((noinline)) void probeClassWrite(uint8_t value) {
+  Parallel.write(1, value);
+}
+
+__attribute__((noinline)) uint8_t probeBusRead() {
+  return Lcd::read(1);
+}
+
+__attribute__((noinline)) uint8_t probeClassRead() {
+  return Parallel.read(1);
+}
+
+// Alternate registers, as a command/data sequence would
+void writes(bool inlined) {
+  if (inlined) {
+    for (uint16_t i = 0; i < accesses; i++)
+      Lcd::write(i & 1, (uint8_t)i);
+  } else {
+    for (uint16_t i = 0; i < accesses; i++)
+      Parallel.write(i & 1, (uint8_t)i);
+  }
+}
+
+void reads(bool inlined) {
+  if (inlined) {
+    for (uint16_t i = 0; i < accesses; i++)
+      sink = Lcd::read(i & 1);
+  } else {
+    for (uint16_t i = 0; i < accesses; i++)
+      sink = Parallel.read(i & 1);
+  }
+}
+
+#ifndef PARALLEL_HOST_SIM
+// Fastest of RUNS, so an interrupt landing in one run doesn't count
+uint32_t best(void (*test)(bool), bool inlined) {
+  uint32_t fastest = 0xFFFFFFFF;
+
+  for (uint8_t i = 0; i < RUNS; i++) {
+    uint32_t start = DWT->CYCCNT;
+    test(inlined);
+    uint32_t t = DWT->CYCCNT - start;
+    if (t < fastest)
+      fastest = t;
+  }
+  return fastest;
+}
+#endif
+
+void compare(const char *name, void (*test)(bool)) {
+  Serial.print(name);
+#ifdef PARALLEL_HOST_SIM
+  ParallelSim.clearTrace();
+  test(false);
+  viaClass = ParallelSim.trace();
+  ParallelSim.clearTrace();
+  test(true);
+
+  const std::vector<ParallelSimAccess_t> &trace = ParallelSim.trace();
+  bool same = (trace.size() == viaClass.size());
+
+  for (size_t i = 0; same && (i < trace.size()); i++) {
+    same = (trace[i].address == viaClass[i].address)
+      && (trace[i].data == viaClass[i].data)
+      && (trace[i].read == viaClass[i].read)
+      && (trace[i].width == viaClass[i].width);
+  }
+  Serial.print((unsigned long)trace.size());
+  Serial.print(" accesses, ParallelClass ");
+  Serial.print((unsigned long)viaClass.size());
+  Serial.print(same ? ", same accesses" : ", accesses DIFFER");
+#else
+  uint32_t fast = best(test, true);
+  uint32_t slow = best(test, false);
+
+  Serial.print((unsigned long)fast);
+  Serial.print(" cycles, ParallelClass ");
+  Serial.print((unsigned long)slow);
+  Serial.print(" cycles");
+#endif
+  Serial.println();
+}
+
+#ifdef PARALLEL_HOST_SIM
+// Offset 2 is past the one address line the device has
+void outOfRange() {
+  ParallelSim.clearTrace();
+  Lcd::write(2, 0x55);
+  Parallel.write(2, 0x55);
+
+  const std::vector<ParallelSimAccess_t> &trace = ParallelSim.trace();
+  Serial.print("offset 2: ParallelBus 0x");
+  Serial.print((unsigned long)trace[0].address, HEX);
+  Serial.print(", ParallelClass 0x");
+  Serial.print((unsigned long)trace[1].address, HEX);
+  Serial.println(((trace[0].address == Lcd::base) && (trace[1].address == Lcd::base + 2))
+    ? ", as documented" : ", NOT as documented");
+}
+#endif
+
+void setup() {
+  Serial.begin(115200);
+
+#ifndef PARALLEL_HOST_SIM
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+  Parallel.begin(PARALLEL_BUS_WIDTH_8, PARALLEL_CS_1, 1, 1, 1);
+  Parallel.setAddressSetupTiming(0, 0, 0, 0);
+  Parallel.setPulseTiming(1, 1, 1, 1);
+  Parallel.setCycleTiming(1, 1);
+
+#ifdef PARALLEL_HOST_SIM
+  ParallelSim.setTrace(true);
+#endif
+
+  compare("ParallelBus writes: ", writes);
+  compare("ParallelBus reads:  ", reads);
+
+  // keeps the probes in the .elf
+  probeBusWrite(probeBusRead());
+  probeClassWrite(probeClassRead());
+
+#ifdef PARALLEL_HOST_SIM
+  outOfRange();
+#endif
+}
+
+void loop() {
+}
+
+#ifdef PARALLEL_HOST_SIM
+int main() {
+  setup();
+  return 0;
+}
+#endif
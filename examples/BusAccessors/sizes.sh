@@ -0,0 +1,49 @@
+#!/bin/sh
+#
+# Prints the size of each one-access probe in a BusAccessors build, and of
+# the ParallelClass functions the ParallelClass probes call: bytes,
+# instructions and calls out (tail calls included), from the symbol table
+# and the disassembly.
+#
+#   sh sizes.sh BusAccessors.ino.elf
+#
+# CROSS is the toolchain prefix, arm-none-eabi- unless set (set it empty to
+# look at a host build of the sketch).
+
+elf="$1"
+cross="${CROSS-arm-none-eabi-}"
+
+if [ ! -f "$elf" ]; then
+	echo "usage: sh sizes.sh BusAccessors.ino.elf" >&2
+	exit 1
+fi
+
+listing=$("${cross}objdump" -d -C --no-show-raw-insn "$elf") || exit 1
+
+for name in probeBusWrite probeClassWrite probeBusRead probeClassRead \
+		ParallelClass::write ParallelClass::read; do
+	# bytes from the symbol table, for the first overload of the name
+	bytes=$("${cross}nm" -C -S -t d "$elf" | awk -v n="$name(" '
+		index($0, n) && $3 ~ /^[Tt]$/ { print $2 + 0; exit }')
+
+	# instructions between the function's label and the blank line after
+	# it, and the ones that branch to another function (calls and tail
+	# calls)
+	echo "$listing" | awk -v n="$name(" -v bytes="$bytes" '
+		/^[0-9a-f]+ </ && index($0, "<" n) { inside = 1; next }
+		inside && /^$/ { exit }
+		inside && /^ *[0-9a-f]+:\t/ {
+			count++
+			split($0, field, "\t")
+			op = field[2]
+			sub(/ .*/, "", op)
+			if (op !~ /^(bl|blx|b|b\.w|b\.n|call|callq|jmp|jmpq)$/)
+				next
+			if (match($0, /<[^>]*>$/) && (index(substr($0, RSTART + 1), n) != 1))
+				calls++
+		}
+		END {
+			printf "%-22s %4s bytes, %3d instructions, %d calls\n",
+				substr(n, 1, length(n) - 1), bytes, count, calls
+		}'
+done
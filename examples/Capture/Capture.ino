@@ -0,0 +1,143 @@
+/*
+  Captures a counting pattern from a FIFO on NCS0 (e.g. an FPGA test mode)
+  at a range of rates.  For each rate it prints the samples per second
+  taken out of the ring, the share of chunks dropped because the ring was
+  full or the DMA channel busy, and any samples that broke the count.
+
+  The sketch also builds on a Linux host against the simulator, where a
+  counter stands in for the FIFO and the checking loop is charged a few
+  cycles per sample:
+
+    g++ -std=gnu++11 -DPARALLEL_HOST_SIM -I. *.cpp -x c smc.c \
+        -x c++ examples/Capture/Capture.ino
+
+  This sketch is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Parallel.h>
+#include <ParallelCapture.h>
+
+const uint16_t chunkSize = 64;
+const uint32_t runTime = 100000;		// us per rate
+
+#ifdef PARALLEL_HOST_SIM
+// Each read gives the next count, like the FPGA's FIFO
+class CounterFifo : public ParallelSimDevice {
+public:
+  CounterFifo() : next(0) {}
+  virtual uint16_t read(uint32_t offset, uint8_t width) {
+    (void)offset;
+    (void)width;
+    return next++;
+  }
+  virtual void write(uint32_t offset, uint16_t data, uint8_t width) {
+    (void)offset;
+    (void)data;
+    (void)width;
+  }
+  uint8_t next;
+};
+
+CounterFifo fifo;
+
+// Time the board's CPU spends in the loop below
+#define CPU_CYCLES(n)	ParallelSim.advance(n)
+#else
+#define CPU_CYCLES(n)
+#endif
+
+ParallelCapture capture(Parallel);
+
+// TC2 channel 0 paces the capture
+void TC6_Handler() {
+  ParallelCapture::timerInterrupt();
+}
+
+void run(uint32_t chunksPerSecond) {
+  uint32_t samples = 0;
+  uint32_t errors = 0;
+  uint8_t expected = 0;
+
+  capture.begin(0, chunkSize);
+
+  uint32_t start = micros();
+  capture.start(chunksPerSecond);
+
+  while (micros() - start < runTime) {
+    size_t n;
+    const uint8_t *p = capture.peek(n);
+
+    if (n == 0) {
+      CPU_CYCLES(20);
+      continue;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+      if ((samples > 0 || i > 0) && p[i] != expected)
+        errors++;
+      expected = p[i] + 1;
+    }
+    CPU_CYCLES(4 * n);
+
+    capture.release(n);
+    samples += n;
+  }
+
+  capture.stop();
+  uint32_t elapsed = micros() - start;
+  uint32_t dropped = capture.overruns() + capture.missed();
+
+  Serial.print((unsigned long)(chunksPerSecond * chunkSize));
+  Serial.print(" samples/s asked: ");
+  Serial.print((unsigned long)((uint64_t)samples * 1000000 / elapsed));
+  Serial.print(" taken, ");
+  Serial.print(100.0 * dropped / (capture.chunks() + dropped));
+  Serial.print("% dropped (");
+  Serial.print((unsigned long)capture.overruns());
+  Serial.print(" full, ");
+  Serial.print((unsigned long)capture.missed());
+  Serial.print(" busy), ");
+  Serial.print((unsigned long)errors);
+  Serial.println(" errors");
+}
+
+void setup() {
+  Serial.begin(115200);
+
+#ifdef PARALLEL_HOST_SIM
+  ParallelSim.attach(0, &fifo);
+#endif
+
+  Parallel.begin(PARALLEL_BUS_WIDTH_8, PARALLEL_CS_0, 0, 1, 0);
+  Parallel.setAddressSetupTiming(0, 0, 0, 0);
+  Parallel.setPulseTiming(2, 2, 2, 2);
+  Parallel.setCycleTiming(3, 3);
+
+  run(10000);
+  run(50000);
+  run(100000);
+  run(200000);
+  run(400000);
+}
+
+void loop() {
+}
+
+#ifdef PARALLEL_HOST_SIM
+int main() {
+  setup();
+  return 0;
+}
+#endif
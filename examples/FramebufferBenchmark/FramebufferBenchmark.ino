@@ -0,0 +1,245 @@
+/*
+  Measures what ParallelFramebuffer puts on the bus per frame, against
+  pushing the whole frame every time (cursor set, memory write and all
+  9600 bytes of a 320x240 1bpp screen).  The panel is an S1D13700 on NCS1
+  (A0 on A0).  Three scenes run for 60 frames each:
+
+    - full redraw: every byte of the screen changes each frame
+    - small rect: a 16x16 box moves 3 pixels each frame
+    - text line: an 8 pixel high line of text scrolls 1 pixel each frame
+
+  and for each the sketch prints bytes and microseconds per frame for
+  flush() and for the full push.
+
+  The sketch also builds on a Linux host against the simulator, where a
+  model controller counts the bytes that actually cross the bus and checks
+  that the panel ends up showing the back buffer:
+
+    g++ -std=gnu++11 -DPARALLEL_HOST_SIM -I. *.cpp -x c smc.c \
+        -x c++ examples/FramebufferBenchmark/FramebufferBenchmark.ino
+
+  This sketch is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Parallel.h>
+#include <ParallelFramebuffer.h>
+
+#define WIDTH		320
+#define HEIGHT		240
+#define STRIDE		(WIDTH / 8)
+#define LAYER		0x0960
+#define FRAMES		60
+
+#define LCD_DATA	0x00
+#define LCD_COMMAND	0x01
+#define CSRW		0x46
+#define MWRITE		0x42
+
+#define TEXT_Y		200
+#define TEXT_ROWS	8
+
+typedef enum {
+  SCENE_FULL,
+  SCENE_RECT,
+  SCENE_TEXT,
+  SCENE_COUNT
+} Scene_t;
+
+const char *names[SCENE_COUNT] = {
+  "full redraw: ",
+  "small rect:  ",
+  "text line:   "
+};
+
+uint8_t back[STRIDE * HEIGHT];
+uint8_t front[STRIDE * HEIGHT];
+ParallelFramebuffer fb(Parallel, WIDTH, HEIGHT, back, front);
+
+#ifdef PARALLEL_HOST_SIM
+// Cursor set and memory write, which is all the framebuffer uses, with
+// every access counted
+class ModelLcd : public ParallelSimDevice {
+public:
+  ModelLcd() : cursor(0), cmd(0), count(0), accesses(0) {}
+
+  virtual uint16_t read(uint32_t offset, uint8_t width) {
+    (void)offset;
+    (void)width;
+    accesses++;
+    return 0;
+  }
+
+  virtual void write(uint32_t offset, uint16_t data, uint8_t width) {
+    (void)width;
+    accesses++;
+    if (offset == LCD_COMMAND) {
+      cmd = (uint8_t)data;
+      count = 0;
+    } else if (cmd == CSRW) {
+      if (count++ == 0)
+        cursor = (uint8_t)data;
+      else
+        cursor |= (uint16_t)data << 8;
+    } else if (cmd == MWRITE) {
+      memory[cursor++] = (uint8_t)data;
+    }
+  }
+
+  uint8_t memory[0x10000];
+  uint16_t cursor;
+  uint8_t cmd;
+  uint8_t count;
+  uint32_t accesses;
+};
+
+ModelLcd model;
+#endif
+
+// What a driver without dirty tracking sends every frame
+void pushFrame() {
+  Parallel.write(LCD_COMMAND, CSRW);
+  Parallel.write(LCD_DATA, LAYER & 0xFF);
+  Parallel.write(LCD_DATA, LAYER >> 8);
+  Parallel.write(LCD_COMMAND, MWRITE);
+  Parallel.writeBlock(LCD_DATA, back, sizeof(back));
+}
+
+// Changes the back buffer for one frame of a scene
+void drawFrame(Scene_t scene, uint16_t frame) {
+  switch (scene) {
+  case SCENE_FULL:
+    for (uint16_t i = 0; i < sizeof(back); i++)
+      back[i] = (uint8_t)(((frame & 1) ? 0xAA : 0x55) ^ (i & 0x0F));
+    fb.markAllDirty();
+    break;
+
+  case SCENE_RECT:
+    if (frame > 0)
+      fb.fillRect(20 + (frame - 1) * 3, 100, 16, 16, false);
+    fb.fillRect(20 + frame * 3, 100, 16, 16, true);
+    break;
+
+  case SCENE_TEXT:
+    // rotate each row of the line one pixel to the left
+    for (uint8_t row = 0; row < TEXT_ROWS; row++) {
+      uint8_t *p = &back[(TEXT_Y + row) * STRIDE];
+      uint8_t carry = p[0] >> 7;
+
+      for (int8_t i = STRIDE - 1; i >= 0; i--) {
+        uint8_t out = p[i] >> 7;
+        p[i] = (uint8_t)((p[i] << 1) | carry);
+        carry = out;
+      }
+    }
+    fb.markDirty(0, TEXT_Y, WIDTH, TEXT_ROWS);
+    break;
+
+  default:
+    break;
+  }
+}
+
+// Same starting picture for both runs of a scene, already on the panel
+void prepare(Scene_t scene) {
+  fb.clear();
+  if (scene == SCENE_TEXT) {
+    // something text-like: a few glyph-sized blobs with gaps between them
+    for (uint8_t row = 0; row < TEXT_ROWS; row++) {
+      for (uint8_t i = 0; i < STRIDE; i++)
+        back[(TEXT_Y + row) * STRIDE + i] = (i % 3 == 2) ? 0x00 : (uint8_t)(0x3C ^ (row * 0x11) ^ i);
+    }
+  }
+  fb.invalidate();
+  fb.flush();
+}
+
+void run(Scene_t scene) {
+  uint32_t counted = 0;
+  uint32_t elapsed[2];
+  uint32_t bytes[2];
+  bool shown[2] = { true, true };
+
+  for (uint8_t push = 0; push < 2; push++) {
+    prepare(scene);
+#ifdef PARALLEL_HOST_SIM
+    model.accesses = 0;
+#endif
+    bytes[push] = 0;
+
+    uint32_t start = micros();
+    for (uint16_t frame = 0; frame < FRAMES; frame++) {
+      drawFrame(scene, frame);
+      if (push) {
+        pushFrame();
+        bytes[push] += 4 + sizeof(back);
+      } else {
+        bytes[push] += fb.flush();
+      }
+    }
+    elapsed[push] = micros() - start;
+
+#ifdef PARALLEL_HOST_SIM
+    if (!push)
+      counted = model.accesses;
+    shown[push] = (memcmp(&model.memory[LAYER], back, sizeof(back)) == 0);
+#endif
+  }
+
+  Serial.print(names[scene]);
+  Serial.print((unsigned long)(bytes[0] / FRAMES));
+  Serial.print(" bytes ");
+  Serial.print((unsigned long)(elapsed[0] / FRAMES));
+  Serial.print(" us/frame, full push ");
+  Serial.print((unsigned long)(bytes[1] / FRAMES));
+  Serial.print(" bytes ");
+  Serial.print((unsigned long)(elapsed[1] / FRAMES));
+  Serial.print(" us/frame");
+#ifdef PARALLEL_HOST_SIM
+  Serial.print(counted == bytes[0] ? "; count right" : "; count WRONG");
+  Serial.print(shown[0] && shown[1] ? ", panel right" : ", panel WRONG");
+#else
+  (void)counted;
+  (void)shown;
+#endif
+  Serial.println();
+}
+
+void setup() {
+  Serial.begin(115200);
+
+#ifdef PARALLEL_HOST_SIM
+  ParallelSim.attach(1, &model);
+#endif
+
+  Parallel.begin(PARALLEL_BUS_WIDTH_8, PARALLEL_CS_1, 1, 0, 1);
+  Parallel.setAddressSetupTiming(5, 1, 5, 1);
+  Parallel.setPulseTiming(50, 60, 50, 60);
+  Parallel.setCycleTiming(110, 110);
+
+  fb.setLayerAddress(LAYER);
+
+  for (uint8_t i = 0; i < SCENE_COUNT; i++)
+    run((Scene_t)i);
+}
+
+void loop() {
+}
+
+#ifdef PARALLEL_HOST_SIM
+int main() {
+  setup();
+  return 0;
+}
+#endif
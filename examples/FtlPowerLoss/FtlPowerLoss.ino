@@ -0,0 +1,202 @@
+/*
+  Cuts the power under the flash translation layer and checks that every
+  write it acknowledged survives the remount.  This needs the simulator,
+  whose NAND model can lose power part way through a program or erase
+  (leaving the page or block torn) and stop responding until it's powered
+  on again, so the sketch only builds on a Linux host:
+
+    g++ -std=gnu++11 -DPARALLEL_HOST_SIM -I. *.cpp -x c smc.c \
+        -x c++ examples/FtlPowerLoss/FtlPowerLoss.ino
+
+  For each of 5 seeds the sketch formats a 32 block FTL and makes 40
+  power cuts, each after a random number of flash operations, while it
+  rewrites random pages (most of them in a hot fifth of the FTL) and calls
+  collect() between writes, so cuts land in writes, garbage collection and
+  checkpoints alike.  After each cut it mounts the flash again and reads
+  every page back.  Each page written carries its page number and a tag
+  that goes up with every write, so a page reads back as:
+
+    - right: the last acknowledged write, or the one in progress at the cut
+    - stale: an earlier write of the same page
+    - lost: unwritten, torn, another page's data or an ECC error
+
+  and the sketch prints the count of each per seed, with the time the
+  mounts took.  The whole run takes a couple of minutes.
+
+  This sketch is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PARALLEL_HOST_SIM
+#error "FtlPowerLoss needs the simulator's NAND model, build it on the host"
+#endif
+
+#include <Parallel.h>
+#include <ParallelFtl.h>
+#include <stdlib.h>
+
+#define PAGE_SIZE	2048
+#define BLOCKS		32
+#define SEEDS		5
+#define CUTS		40
+#define MAX_OPERATIONS	1500
+#define MAX_WRITES	2000
+#define NONE		0xFFFFFFFFu
+
+static const ParallelNandGeometry_t geometry = { PAGE_SIZE, 64, 64, BLOCKS };
+
+typedef struct {
+  uint32_t right;
+  uint32_t stale;
+  uint32_t lost;
+} Result_t;
+
+ParallelClass nandBus;
+uint8_t page[PAGE_SIZE];
+
+// The tag last acknowledged for each page, 0 if never written
+std::vector<uint32_t> acknowledged;
+
+// Every word of a page holds its page number and tag
+void fill(uint32_t n, uint32_t tag) {
+  for (uint16_t i = 0; i < PAGE_SIZE; i += 8) {
+    memcpy(&page[i], &n, 4);
+    memcpy(&page[i + 4], &tag, 4);
+  }
+}
+
+// Returns the page's tag, 0 if unwritten or NONE if it isn't one whole
+// write of page n
+uint32_t tagOf(uint32_t n) {
+  uint32_t owner;
+  uint32_t tag;
+
+  memcpy(&owner, &page[0], 4);
+  memcpy(&tag, &page[4], 4);
+  if ((owner == NONE) && (tag == NONE))
+    tag = 0;
+  else if (owner != n)
+    return NONE;
+
+  for (uint16_t i = 8; i < PAGE_SIZE; i += 8) {
+    if (memcmp(&page[i], &page[0], 8) != 0)
+      return NONE;
+  }
+  return tag;
+}
+
+void check(ParallelFtl &ftl, uint32_t pending, uint32_t pendingTag, Result_t &result) {
+  for (uint32_t n = 0; n < ftl.capacity(); n++) {
+    ParallelNandStatus_t status = ftl.read(n, page);
+    uint32_t tag = (status <= PARALLEL_NAND_CORRECTED) ? tagOf(n) : NONE;
+
+    if ((n == pending) && (tag == pendingTag)) {
+      // the write in progress made it after all
+      acknowledged[n] = tag;
+      result.right++;
+    } else if (tag == acknowledged[n]) {
+      result.right++;
+    } else if (tag < acknowledged[n]) {
+      result.stale++;
+    } else {
+      result.lost++;
+    }
+  }
+}
+
+void run(uint32_t seed) {
+  ParallelSimNand flash(PAGE_SIZE, 64, 64, BLOCKS);
+  Result_t result = { 0, 0, 0 };
+  uint32_t tag = 0;
+  uint64_t mountCycles = 0;
+
+  ParallelSim.attach(1, &flash);
+  srand(seed);
+
+  ParallelNand *nand = new ParallelNand(nandBus);
+  ParallelFtl *ftl = new ParallelFtl(*nand);
+  if (!nand->begin(geometry) || !ftl->format(0, BLOCKS)) {
+    Serial.println("format failed");
+    return;
+  }
+  acknowledged.assign(ftl->capacity(), 0);
+
+  for (uint8_t cut = 0; cut < CUTS; cut++) {
+    uint32_t pending = NONE;
+    uint32_t pendingTag = 0;
+
+    flash.powerFail(1 + (uint32_t)rand() % MAX_OPERATIONS);
+    for (uint16_t i = 0; (i < MAX_WRITES) && flash.powered(); i++) {
+      uint32_t hot = ftl->capacity() / 5;
+      uint32_t n = (rand() % 10 < 8) ? (uint32_t)rand() % hot : (uint32_t)rand() % ftl->capacity();
+
+      fill(n, ++tag);
+      pending = n;
+      pendingTag = tag;
+      if ((ftl->write(n, page) == PARALLEL_NAND_OK) && flash.powered()) {
+        acknowledged[n] = tag;
+        pending = NONE;
+      }
+      ftl->collect();
+    }
+
+    // power back on and mount from scratch, as after a reset
+    flash.powerOn();
+    delete ftl;
+    delete nand;
+    nand = new ParallelNand(nandBus);
+    ftl = new ParallelFtl(*nand);
+
+    uint64_t start = ParallelSim.cycles();
+    if (!nand->begin(geometry) || !ftl->begin(0, BLOCKS)) {
+      Serial.println("mount failed");
+      break;
+    }
+    mountCycles += ParallelSim.cycles() - start;
+
+    check(*ftl, pending, pendingTag, result);
+  }
+
+  delete ftl;
+  delete nand;
+
+  Serial.print("seed ");
+  Serial.print((unsigned long)seed);
+  Serial.print(": ");
+  Serial.print((unsigned long)result.right);
+  Serial.print(" pages right, ");
+  Serial.print((unsigned long)result.stale);
+  Serial.print(" stale, ");
+  Serial.print((unsigned long)result.lost);
+  Serial.print(" lost, mount ");
+  Serial.print((unsigned long)(mountCycles / CUTS / 84));
+  Serial.println(" us");
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  nandBus.begin(PARALLEL_BUS_WIDTH_8, PARALLEL_CS_1, 0, 0, 0);
+
+  for (uint32_t seed = 1; seed <= SEEDS; seed++)
+    run(seed);
+}
+
+void loop() {
+}
+
+int main() {
+  setup();
+  return 0;
+}
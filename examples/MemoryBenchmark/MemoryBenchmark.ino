@@ -0,0 +1,342 @@
+/*
+  Compares the external SRAM allocators with a general purpose first-fit
+  heap kept in the same SRAM (on NCS0), each given 32 KB of it.
+
+  The first workload keeps up to 120 buffers of 16 to 1024 bytes alive,
+  allocating and freeing them in random order, as a logger or a network
+  stack might.  It runs on three ParallelPools, one per size class, and on
+  the heap.  The second allocates 16 buffers per frame and frees them all at
+  the end of it, on a ParallelArena and on the heap.
+
+  For each the sketch prints the average and worst CPU cycles per
+  allocate() or release(), the allocations that failed, and how the memory
+  went to waste: rounding up to a block size for the pools, and for the heap
+  how much of the free memory was outside its largest free block at the
+  worst point (external fragmentation).
+
+  The sketch also builds on a Linux host against the simulator, where the
+  cycles are those the bus accesses take, the CPU's own being free:
+
+    g++ -std=gnu++11 -DPARALLEL_HOST_SIM -I. *.cpp -x c smc.c \
+        -x c++ examples/MemoryBenchmark/MemoryBenchmark.ino
+
+  This sketch is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Parallel.h>
+#include <ParallelMemory.h>
+
+#define HEAP_SIZE	(32 * 1024UL)
+#define MAX_LIVE	120
+#define STEPS		20000
+#define FRAMES		1000
+#define PER_FRAME	16
+
+// Size classes for the pools, sharing HEAP_SIZE between them
+#define CLASSES		3
+const uint32_t classSize[CLASSES] = { 64, 256, 1024 };
+const uint32_t classCount[CLASSES] = { 96, 40, 16 };
+
+// A heap with a 4 byte header in front of each block (its size, with the
+// low bit set while in use), walked from the start on every allocate().
+// Free neighbours are merged as the walk finds them.
+class FirstFitHeap {
+public:
+  bool begin(ParallelMemory &memory, uint32_t size) {
+    _memory = &memory;
+    _base = memory.reserve(size);
+    _end = _base + size;
+    if (_base == PARALLEL_MEMORY_NULL)
+      return false;
+    memory.store<uint32_t>(_base, size);
+    return true;
+  }
+
+  uint32_t allocate(uint32_t n) {
+    uint32_t need = ((n + 3) & ~3u) + 4;
+
+    for (uint32_t a = _base; a < _end; ) {
+      uint32_t header = _memory->load<uint32_t>(a);
+      uint32_t size = header & ~1u;
+
+      if (!(header & 1)) {
+        uint32_t merged = size;
+        while (a + merged < _end) {
+          uint32_t next = _memory->load<uint32_t>(a + merged);
+          if (next & 1)
+            break;
+          merged += next;
+        }
+        if (merged != size) {
+          size = merged;
+          _memory->store<uint32_t>(a, size);
+        }
+
+        if (size >= need) {
+          if (size - need >= 8) {
+            _memory->store<uint32_t>(a + need, size - need);
+            size = need;
+          }
+          _memory->store<uint32_t>(a, size | 1);
+          return a + 4;
+        }
+      }
+      a += size;
+    }
+    return PARALLEL_MEMORY_NULL;
+  }
+
+  void release(uint32_t address) {
+    uint32_t header = _memory->load<uint32_t>(address - 4);
+    _memory->store<uint32_t>(address - 4, header & ~1u);
+  }
+
+  // Free bytes, and the largest run of them one allocation could use
+  void survey(uint32_t &free, uint32_t &largest) {
+    uint32_t run = 0;
+    free = 0;
+    largest = 0;
+    for (uint32_t a = _base; a < _end; ) {
+      uint32_t header = _memory->load<uint32_t>(a);
+      uint32_t size = header & ~1u;
+      if (header & 1) {
+        run = 0;
+      } else {
+        free += size;
+        run += size;
+        if (run > largest)
+          largest = run;
+      }
+      a += size;
+    }
+  }
+
+private:
+  ParallelMemory *_memory;
+  uint32_t _base;
+  uint32_t _end;
+};
+
+typedef struct {
+  uint32_t operations;
+  uint64_t total;
+  uint32_t worst;
+  uint32_t failed;
+} Latency_t;
+
+ParallelMemory sram(Parallel, 128 * 1024UL);
+ParallelPool pools[CLASSES];
+ParallelArena arena;
+FirstFitHeap heap;
+FirstFitHeap frameHeap;
+
+uint32_t live[MAX_LIVE];
+uint8_t liveClass[MAX_LIVE];
+uint32_t liveCount;
+uint32_t seed;
+
+uint32_t nextRandom(uint32_t range) {
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 16) % range;
+}
+
+// Mostly small buffers, some large ones
+uint32_t randomSize() {
+  uint32_t kind = nextRandom(20);
+  if (kind < 10)
+    return 16 + nextRandom(49);
+  if (kind < 17)
+    return 65 + nextRandom(192);
+  return 257 + nextRandom(768);
+}
+
+uint32_t cycles() {
+#ifdef PARALLEL_HOST_SIM
+  return (uint32_t)ParallelSim.cycles();
+#else
+  return DWT->CYCCNT;
+#endif
+}
+
+void count(Latency_t &latency, uint32_t start, bool ok) {
+  uint32_t spent = cycles() - start;
+  latency.operations++;
+  latency.total += spent;
+  if (spent > latency.worst)
+    latency.worst = spent;
+  if (!ok)
+    latency.failed++;
+}
+
+void print(const char *name, const Latency_t &latency) {
+  Serial.print(name);
+  Serial.print((unsigned long)(latency.total / latency.operations));
+  Serial.print(" cycles/op, worst ");
+  Serial.print((unsigned long)latency.worst);
+  Serial.print(", ");
+  Serial.print((unsigned long)latency.failed);
+  Serial.print(" failed");
+}
+
+// Random allocate/release of up to MAX_LIVE buffers
+void randomWorkload(bool pooled) {
+  Latency_t latency = { 0, 0, 0, 0 };
+  uint64_t requested = 0;
+  uint64_t held = 0;
+  uint32_t worstFragmentation = 0;
+
+  seed = 1;
+  liveCount = 0;
+
+  for (uint32_t step = 0; step < STEPS; step++) {
+    // drawn on both runs to keep the workload the same
+    bool grow = nextRandom(2) == 0;
+    uint32_t victim = nextRandom(MAX_LIVE);
+    uint32_t n = randomSize();
+
+    if (grow && (liveCount < MAX_LIVE)) {
+      uint32_t start = cycles();
+      uint32_t address;
+      uint8_t c = 0;
+
+      if (pooled) {
+        while (classSize[c] < n)
+          c++;
+        address = pools[c].allocate();
+      } else {
+        address = heap.allocate(n);
+      }
+      count(latency, start, address != PARALLEL_MEMORY_NULL);
+
+      if (address != PARALLEL_MEMORY_NULL) {
+        live[liveCount] = address;
+        liveClass[liveCount] = c;
+        liveCount++;
+        requested += n;
+        held += pooled ? classSize[c] : ((n + 3) & ~3u) + 4;
+      }
+    } else if (liveCount > 0) {
+      uint32_t i = victim % liveCount;
+      uint32_t start = cycles();
+
+      if (pooled)
+        pools[liveClass[i]].release(live[i]);
+      else
+        heap.release(live[i]);
+      count(latency, start, true);
+
+      liveCount--;
+      live[i] = live[liveCount];
+      liveClass[i] = liveClass[liveCount];
+    }
+
+    // outside the timed calls, as it walks the whole heap
+    if (!pooled && (step % 100 == 0)) {
+      uint32_t free;
+      uint32_t largest;
+      heap.survey(free, largest);
+      uint32_t fragmentation = (uint32_t)((uint64_t)(free - largest) * 100 / free);
+      if (fragmentation > worstFragmentation)
+        worstFragmentation = fragmentation;
+    }
+  }
+
+  // hand everything back for the next run
+  for (uint32_t i = 0; i < liveCount; i++) {
+    if (pooled)
+      pools[liveClass[i]].release(live[i]);
+    else
+      heap.release(live[i]);
+  }
+
+  print(pooled ? "random, pools: " : "random, heap:  ", latency);
+  Serial.print(", ");
+  Serial.print((unsigned long)((held - requested) * 100 / held));
+  Serial.print("% rounding");
+  if (!pooled) {
+    Serial.print(", up to ");
+    Serial.print((unsigned long)worstFragmentation);
+    Serial.print("% fragmented");
+  }
+  Serial.println();
+}
+
+// PER_FRAME buffers a frame, all freed at its end
+void frameWorkload(bool useArena) {
+  Latency_t latency = { 0, 0, 0, 0 };
+  uint32_t frame[PER_FRAME];
+
+  seed = 2;
+
+  for (uint32_t f = 0; f < FRAMES; f++) {
+    uint32_t mark = arena.mark();
+
+    for (uint8_t i = 0; i < PER_FRAME; i++) {
+      uint32_t n = randomSize();
+      uint32_t start = cycles();
+      frame[i] = useArena ? arena.allocate(n) : frameHeap.allocate(n);
+      count(latency, start, frame[i] != PARALLEL_MEMORY_NULL);
+    }
+
+    uint32_t start = cycles();
+    if (useArena) {
+      arena.release(mark);
+    } else {
+      for (uint8_t i = 0; i < PER_FRAME; i++) {
+        if (frame[i] != PARALLEL_MEMORY_NULL)
+          frameHeap.release(frame[i]);
+      }
+    }
+    count(latency, start, true);
+  }
+
+  print(useArena ? "frames, arena: " : "frames, heap:  ", latency);
+  Serial.println();
+}
+
+void setup() {
+  Serial.begin(115200);
+
+#ifndef PARALLEL_HOST_SIM
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+  Parallel.begin(PARALLEL_BUS_WIDTH_8, PARALLEL_CS_0, 17, 1, 1);
+  Parallel.setAddressSetupTiming(1, 1, 1, 1);
+  Parallel.setPulseTiming(4, 4, 4, 4);
+  Parallel.setCycleTiming(6, 6);
+
+  for (uint8_t c = 0; c < CLASSES; c++)
+    pools[c].begin(sram, classSize[c], classCount[c]);
+  heap.begin(sram, HEAP_SIZE);
+  arena.begin(sram, HEAP_SIZE);
+  frameHeap.begin(sram, HEAP_SIZE);
+
+  randomWorkload(true);
+  randomWorkload(false);
+  frameWorkload(true);
+  frameWorkload(false);
+}
+
+void loop() {
+}
+
+#ifdef PARALLEL_HOST_SIM
+int main() {
+  setup();
+  return 0;
+}
+#endif
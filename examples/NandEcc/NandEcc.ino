@@ -0,0 +1,220 @@
+/*
+  Checks ParallelNand's ECC on a 2 KB page NAND part on NCS1: writes a
+  block of random pages, reads them back and prints what the ECC had to
+  do.  On a good part every page reads back clean.
+
+  The sketch also builds on a Linux host against the simulator, whose NAND
+  model can flip bits in what it stores.  There the sketch flips, 200 times
+  each:
+
+    - one bit anywhere in a page: corrected, and the data reads back right
+    - one bit of the stored parity: reported as corrected, data untouched
+    - one bit in each 512 byte sector at once: all four corrected
+    - two bits in the same sector: reported as an ECC error, never
+      "corrected" into a third wrong bit
+
+  restoring the page after each, and prints how many of each came out as
+  expected:
+
+    g++ -std=gnu++11 -DPARALLEL_HOST_SIM -I. *.cpp -x c smc.c \
+        -x c++ examples/NandEcc/NandEcc.ino
+
+  This sketch is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Parallel.h>
+#include <ParallelNand.h>
+#include <stdlib.h>
+
+#define PAGE_SIZE	2048
+#define SPARE_SIZE	64
+#define SECTOR		512
+#define ECC_BYTES	(3 * PAGE_SIZE / SECTOR)
+#define BLOCK		1
+#define TRIALS		200
+
+static const ParallelNandGeometry_t geometry = { PAGE_SIZE, SPARE_SIZE, 64, 64 };
+
+#ifdef PARALLEL_HOST_SIM
+ParallelSimNand flash(PAGE_SIZE, SPARE_SIZE, 64, 64);
+
+typedef enum {
+  FLIP_ONE,
+  FLIP_PARITY,
+  FLIP_EACH_SECTOR,
+  FLIP_TWO,
+  FLIP_COUNT
+} Flip_t;
+
+const char *names[FLIP_COUNT] = {
+  "one bit:         ",
+  "one parity bit:  ",
+  "one per sector:  ",
+  "two in a sector: "
+};
+#endif
+
+ParallelClass nandBus;
+ParallelNand nand(nandBus);
+uint8_t page[PAGE_SIZE];
+uint8_t written[PAGE_SIZE];
+
+uint32_t firstPage() {
+  return (uint32_t)BLOCK * nand.pagesPerBlock();
+}
+
+// What page n of the block was written with, made again when needed
+// rather than kept, as the block won't fit in RAM
+void pattern(uint8_t n, uint8_t *p) {
+  uint32_t seed = n + 1;
+  for (uint16_t i = 0; i < PAGE_SIZE; i++) {
+    seed = seed * 1103515245 + 12345;
+    p[i] = (uint8_t)(seed >> 16);
+  }
+}
+
+#ifdef PARALLEL_HOST_SIM
+typedef struct {
+  uint32_t column;
+  uint8_t bit;
+} Bit_t;
+
+// Picks the bits a trial flips, all different
+uint8_t pick(Flip_t flip, Bit_t *bits) {
+  switch (flip) {
+  case FLIP_ONE:
+    bits[0].column = (uint32_t)rand() % PAGE_SIZE;
+    bits[0].bit = (uint8_t)(rand() % 8);
+    return 1;
+
+  case FLIP_PARITY:
+    bits[0].column = PAGE_SIZE + SPARE_SIZE - ECC_BYTES + (uint32_t)rand() % ECC_BYTES;
+    bits[0].bit = (uint8_t)(rand() % 8);
+    return 1;
+
+  case FLIP_EACH_SECTOR:
+    for (uint8_t s = 0; s < PAGE_SIZE / SECTOR; s++) {
+      bits[s].column = s * SECTOR + (uint32_t)rand() % SECTOR;
+      bits[s].bit = (uint8_t)(rand() % 8);
+    }
+    return PAGE_SIZE / SECTOR;
+
+  case FLIP_TWO: {
+    uint32_t sector = ((uint32_t)rand() % (PAGE_SIZE / SECTOR)) * SECTOR;
+    uint32_t first = (uint32_t)rand() % (SECTOR * 8);
+    uint32_t second = (first + 1 + (uint32_t)rand() % (SECTOR * 8 - 1)) % (SECTOR * 8);
+
+    bits[0].column = sector + (first >> 3);
+    bits[0].bit = (uint8_t)(first & 7);
+    bits[1].column = sector + (second >> 3);
+    bits[1].bit = (uint8_t)(second & 7);
+    return 2;
+  }
+
+  default:
+    return 0;
+  }
+}
+
+void inject(Flip_t flip) {
+  ParallelNandStatus_t expected = (flip == FLIP_TWO) ? PARALLEL_NAND_ECC_ERROR : PARALLEL_NAND_CORRECTED;
+  uint32_t corrected = nand.corrected();
+  uint32_t errors = nand.eccErrors();
+  uint16_t right = 0;
+
+  for (uint16_t t = 0; t < TRIALS; t++) {
+    uint8_t n = (uint8_t)(rand() % nand.pagesPerBlock());
+    Bit_t bits[PAGE_SIZE / SECTOR];
+    uint8_t count = pick(flip, bits);
+
+    for (uint8_t i = 0; i < count; i++)
+      flash.flipBit(firstPage() + n, bits[i].column, bits[i].bit);
+
+    ParallelNandStatus_t status = nand.readPage(firstPage() + n, page);
+    pattern(n, written);
+    if ((status == expected)
+        && ((expected == PARALLEL_NAND_ECC_ERROR) || (memcmp(page, written, PAGE_SIZE) == 0)))
+      right++;
+
+    // put the page back as it was written
+    for (uint8_t i = 0; i < count; i++)
+      flash.flipBit(firstPage() + n, bits[i].column, bits[i].bit);
+  }
+
+  Serial.print(names[flip]);
+  Serial.print((unsigned long)right);
+  Serial.print(" of ");
+  Serial.print((unsigned long)TRIALS);
+  Serial.print(" as expected, ");
+  Serial.print((unsigned long)(nand.corrected() - corrected));
+  Serial.print(" sectors corrected, ");
+  Serial.print((unsigned long)(nand.eccErrors() - errors));
+  Serial.println(" ECC errors");
+}
+#endif
+
+void setup() {
+  Serial.begin(115200);
+
+#ifdef PARALLEL_HOST_SIM
+  ParallelSim.attach(1, &flash);
+  srand(1);
+#endif
+
+  nandBus.begin(PARALLEL_BUS_WIDTH_8, PARALLEL_CS_1, 0, 0, 0);
+
+  if (!nand.begin(geometry) || nand.isBad(BLOCK) || (nand.eraseBlock(BLOCK) != PARALLEL_NAND_OK)) {
+    Serial.println("no flash");
+    return;
+  }
+
+  for (uint8_t n = 0; n < nand.pagesPerBlock(); n++) {
+    pattern(n, written);
+    nand.writePage(firstPage() + n, written);
+  }
+
+  uint8_t clean = 0;
+  for (uint8_t n = 0; n < nand.pagesPerBlock(); n++) {
+    pattern(n, written);
+    if ((nand.readPage(firstPage() + n, page) == PARALLEL_NAND_OK)
+        && (memcmp(page, written, PAGE_SIZE) == 0))
+      clean++;
+  }
+
+  Serial.print("clean reads:     ");
+  Serial.print((unsigned long)clean);
+  Serial.print(" of ");
+  Serial.print((unsigned long)nand.pagesPerBlock());
+  Serial.print(", ");
+  Serial.print((unsigned long)nand.corrected());
+  Serial.print(" sectors corrected, ");
+  Serial.print((unsigned long)nand.eccErrors());
+  Serial.println(" ECC errors");
+
+#ifdef PARALLEL_HOST_SIM
+  for (uint8_t i = 0; i < FLIP_COUNT; i++)
+    inject((Flip_t)i);
+#endif
+}
+
+void loop() {
+}
+
+#ifdef PARALLEL_HOST_SIM
+int main() {
+  setup();
+  return 0;
+}
+#endif
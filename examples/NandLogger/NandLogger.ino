@@ -0,0 +1,106 @@
+/*
+  Measures the flash translation layer on a 2 KB page NAND part on NCS1:
+  sequential appends as a data logger makes them, then random rewrites
+  once the FTL is full.  Prints the pages per second, the worst write
+  time and the write amplification (pages programmed per page written)
+  for each.
+
+  The sketch also builds on a Linux host against the simulator, with a
+  simulated 128 MB part:
+
+    g++ -std=gnu++11 -DPARALLEL_HOST_SIM -I. *.cpp -x c smc.c \
+        -x c++ examples/NandLogger/NandLogger.ino
+
+  This sketch is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Parallel.h>
+#include <ParallelFtl.h>
+#include <stdlib.h>
+
+static const ParallelNandGeometry_t geometry = { 2048, 64, 64, 1024 };
+
+#ifdef PARALLEL_HOST_SIM
+ParallelSimNand flash(2048, 64, 64, 1024);
+#endif
+
+ParallelClass nandBus;
+ParallelNand nand(nandBus);
+ParallelFtl ftl(nand);
+uint8_t page[2048];
+
+void run(const char *name, uint32_t writes, bool shuffle) {
+  uint32_t host = ftl.hostWrites();
+  uint32_t programmed = ftl.flashWrites();
+  uint32_t worst = 0;
+  uint32_t start = micros();
+
+  for (uint32_t i = 0; i < writes; i++) {
+    uint32_t n = shuffle ? (uint32_t)rand() % ftl.capacity() : i % ftl.capacity();
+    uint32_t t = micros();
+
+    page[0] = (uint8_t)i;
+    ftl.write(n, page);
+    t = micros() - t;
+    if (t > worst)
+      worst = t;
+
+    // the logger's idle time between samples
+    ftl.collect();
+  }
+
+  uint32_t elapsed = micros() - start;
+
+  Serial.print(name);
+  Serial.print(": ");
+  Serial.print((unsigned long)((uint64_t)writes * 1000000 / elapsed));
+  Serial.print(" pages/s, worst ");
+  Serial.print((unsigned long)worst);
+  Serial.print(" us, WA ");
+  Serial.println((float)(ftl.flashWrites() - programmed) / (ftl.hostWrites() - host));
+}
+
+void setup() {
+  Serial.begin(115200);
+
+#ifdef PARALLEL_HOST_SIM
+  ParallelSim.attach(1, &flash);
+#endif
+
+  nandBus.begin(PARALLEL_BUS_WIDTH_8, PARALLEL_CS_1, 0, 0, 0);
+
+  if (!nand.begin(geometry) || !ftl.format(0, 144)) {
+    Serial.println("no flash");
+    return;
+  }
+
+  run("sequential", 2 * ftl.capacity(), false);
+  run("random    ", ftl.capacity(), true);
+
+  Serial.print("erase counts ");
+  Serial.print((unsigned long)ftl.minErases());
+  Serial.print("..");
+  Serial.println((unsigned long)ftl.maxErases());
+}
+
+void loop() {
+}
+
+#ifdef PARALLEL_HOST_SIM
+int main() {
+  setup();
+  return 0;
+}
+#endif
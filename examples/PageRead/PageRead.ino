@@ -0,0 +1,67 @@
+/*
+  Compares plain and page mode reads from a page mode memory (e.g. a 
+  PSRAM or NOR flash with a 70 ns access time and 25 ns page access 
+  time) on NCS0 and prints the time each one takes to read 8 KB.
+
+  The sketch also builds on a Linux host against the simulator:
+
+    g++ -std=gnu++11 -DPARALLEL_HOST_SIM -I. *.cpp -x c smc.c \
+        -x c++ examples/PageRead/PageRead.ino
+
+  This sketch is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Parallel.h>
+
+const size_t blockSize = 8192;
+uint8_t buffer[blockSize];
+
+uint32_t timeRead() {
+  uint32_t start = micros();
+  Parallel.readMemory(0, buffer, blockSize);
+  return micros() - start;
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  Parallel.begin(PARALLEL_BUS_WIDTH_8, PARALLEL_CS_0, 16, 1, 1);
+
+  // 84 MHz MCK: 70 ns is 6 cycles, 25 ns is 3 cycles
+  Parallel.setAddressSetupTiming(1, 0, 1, 0);
+  Parallel.setPulseTiming(4, 6, 6, 7);
+  Parallel.setCycleTiming(7, 8);
+
+  Serial.print("single reads: ");
+  Serial.print((unsigned long)timeRead());
+  Serial.println(" us");
+
+  // 16 byte pages: 6 cycles for the first read, 3 for the rest
+  Parallel.setPageMode(PAGE_SIZE_16, 6, 3);
+
+  Serial.print("page reads:   ");
+  Serial.print((unsigned long)timeRead());
+  Serial.println(" us");
+}
+
+void loop() {
+}
+
+#ifdef PARALLEL_HOST_SIM
+int main() {
+  setup();
+  return 0;
+}
+#endif
@@ -0,0 +1,150 @@
+/*
+  Boots into bus timings tuned for this board.  The first boot tunes the
+  SRAM on NCS0 from its data sheet worst case and stores the result in
+  flash; later boots load it from there.  The sketch then switches between
+  the data sheet profile and the tuned one and prints how many CPU cycles a
+  switch takes.  The first 256 bytes of the SRAM are overwritten on the
+  first boot.
+
+  The sketch also builds on a Linux host against the simulator, where it
+  boots twice to check the tuned profile comes back from flash, then
+  corrupts the stored page to check it is ignored:
+
+    g++ -std=gnu++11 -DPARALLEL_HOST_SIM -I. *.cpp -x c smc.c \
+        -x c++ examples/Profiles/Profiles.ino
+
+  This sketch is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Parallel.h>
+#include <ParallelTuner.h>
+#include <ParallelProfile.h>
+
+// tAS, tPW, tAH, tCYC, tACC in ns
+const ParallelTimingProfile_t datasheet = { 30, 120, 30, 250, 120 };
+
+#define SLOT_FAST	0
+
+ParallelTuner tuner(Parallel);
+ParallelProfileStore store;
+ParallelBusProfile_t slow;
+ParallelBusProfile_t fast;
+
+// Returns true if the tuned profile was loaded rather than tuned
+bool boot() {
+  Parallel.begin(PARALLEL_BUS_WIDTH_8, PARALLEL_CS_0, 16, 1, 1);
+  Parallel.setTiming(parallelSolveTiming(datasheet));
+  Parallel.getProfile(slow);
+
+  if (store.load() && store.get(SLOT_FAST, fast)) {
+    Serial.println("loaded tuned profile");
+    return true;
+  }
+
+  if (!tuner.tune(datasheet, 0, 256)) {
+    Serial.println("data sheet timing fails");
+    fast = slow;
+    return false;
+  }
+
+  Parallel.getProfile(fast);
+  Parallel.setProfile(slow);
+  store.set(SLOT_FAST, fast);
+  Serial.println(store.save() ? "tuned profile saved" : "saving failed");
+  return false;
+}
+
+void printCycles(const char *name) {
+  Serial.print(name);
+  Serial.print((unsigned long)Parallel.getWriteCycles());
+  Serial.print("/");
+  Serial.print((unsigned long)Parallel.getReadCycles());
+  Serial.println(" cycles per write/read");
+}
+
+#ifndef PARALLEL_HOST_SIM
+// CPU cycles to switch profiles, against setting the same registers up
+// through setTiming() and setMode()
+void measure() {
+  ParallelSmcTiming_t timing = parallelSolveTiming(datasheet);
+
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  uint32_t start = DWT->CYCCNT;
+  Parallel.setProfile(fast);
+  uint32_t profile = DWT->CYCCNT - start;
+
+  start = DWT->CYCCNT;
+  Parallel.setTiming(timing);
+  Parallel.setMode(READ_MODE_NRD_CTRL, WRITE_MODE_NWE_CTRL);
+  uint32_t setters = DWT->CYCCNT - start;
+
+  Serial.print("setProfile() ");
+  Serial.print((unsigned long)profile);
+  Serial.print(" cycles, setters ");
+  Serial.print((unsigned long)setters);
+  Serial.println(" cycles");
+}
+#endif
+
+void setup() {
+  Serial.begin(115200);
+
+#ifdef PARALLEL_HOST_SIM
+  ParallelSimTimedMemory memory(1, 3, 4, 1, 8);
+  ParallelSim.attach(0, &memory);
+
+  bool first = boot();
+  ParallelBusProfile_t tuned = fast;
+
+  // reboot: the SMC is back to its reset values, the flash isn't
+  ParallelSim.reset();
+  uint16_t trials = tuner.trials();
+  bool second = boot();
+  bool same = (memcmp(&tuned, &fast, sizeof(fast)) == 0)
+    && (tuner.trials() == trials);
+
+  // the loaded profile runs the device without breaking its timing
+  Parallel.setProfile(fast);
+  printCycles("fast ");
+  memory.violations = 0;
+  bool works = tuner.verify(0, 256) && (memory.violations == 0);
+  Parallel.setProfile(slow);
+  printCycles("slow ");
+
+  // a damaged page is ignored
+  parallelSimFlash1[(PARALLEL_PROFILE_PAGE) * IFLASH1_PAGE_SIZE + 20] ^= 0x01;
+  bool rejected = !store.load();
+
+  Serial.println(!first && second && same && works && rejected ? "profiles OK" : "profiles WRONG");
+  ParallelSim.attach(0, NULL);
+#else
+  boot();
+  Parallel.setProfile(fast);
+  printCycles("fast ");
+  measure();
+#endif
+}
+
+void loop() {
+}
+
+#ifdef PARALLEL_HOST_SIM
+int main() {
+  setup();
+  return 0;
+}
+#endif
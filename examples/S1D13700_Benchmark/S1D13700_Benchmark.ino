@@ -0,0 +1,331 @@
+/*
+  Times the S1D13700 drawing functions against the same drawing done a
+  pixel at a time, the way a driver without them would: set the cursor,
+  read the byte back, set the cursor again and write it.  The panel is a
+  320x240 CFAG320240 on NCS1 (A0 on A0, NRD connected) showing part of a
+  640x360 virtual screen, and the sketch prints the time each
+  version takes for a filled rectangle, a 200x150 blit, a diagonal line and
+  a scroll down and across (redrawing every pixel of the panel, for the
+  per pixel version).
+
+  The sketch also builds on a Linux host against the simulator, where a
+  model controller also counts the bytes that cross the bus and checks that
+  both versions leave the same picture on the panel:
+
+    g++ -std=gnu++11 -DPARALLEL_HOST_SIM -I. *.cpp -x c smc.c \
+        -x c++ examples/S1D13700_Benchmark/S1D13700_Benchmark.ino
+
+  This sketch is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Parallel.h>
+#include <ParallelS1D13700.h>
+
+#define WIDTH		640
+#define HEIGHT		360
+#define STRIDE		(WIDTH / 8)
+#define PANEL_WIDTH	320
+#define PANEL_LINES	240
+#define GRAPHICS	0x0960
+
+typedef enum {
+  TEST_FILL,
+  TEST_BLIT,
+  TEST_LINE,
+  TEST_SCROLL,
+  TEST_COUNT
+} Test_t;
+
+const char *names[TEST_COUNT] = {
+  "fillRect 300x200 ",
+  "blit 200x150     ",
+  "drawLine 320x240 ",
+  "setScroll 12,100 "
+};
+
+ParallelS1D13700 lcd(Parallel);
+
+// The default set up, with 80 bytes per row of display memory
+const uint8_t init[] = {
+  S1D13700_SYSTEM_SET, 8, 0x30, 0x87, 0x07, 0x27, 0x39, PANEL_LINES - 1, STRIDE, 0x00,
+  S1D13700_SCROLL, 10, 0x00, 0x00, PANEL_LINES - 1,
+    GRAPHICS & 0xFF, GRAPHICS >> 8, PANEL_LINES - 1, 0x00, 0x00, 0x00, 0x00,
+  S1D13700_HDOT_SCR, 1, 0x00,
+  S1D13700_OVLAY, 1, 0x01,
+  S1D13700_CSRDIR + S1D13700_CURSOR_RIGHT, 0,
+  S1D13700_DISP_OFF, 1, 0x00,
+};
+
+// The whole virtual screen, drawn once; blit() copies from it and the per
+// pixel scroll redraws the panel from it
+uint8_t image[STRIDE * HEIGHT];
+
+#ifdef PARALLEL_HOST_SIM
+// Enough of the controller for the graphics layer: cursor, auto-increment,
+// memory reads and writes and the scroll registers, with every access
+// counted
+class ModelLcd : public ParallelSimDevice {
+public:
+  ModelLcd() : cursor(0), step(1), cmd(0), count(0), start(0), hdot(0), accesses(0) {}
+
+  virtual uint16_t read(uint32_t offset, uint8_t width) {
+    (void)width;
+    accesses++;
+    if (offset != 0x01)
+      return 0;
+    uint8_t value = memory[cursor];
+    cursor += step;
+    return value;
+  }
+
+  virtual void write(uint32_t offset, uint16_t data, uint8_t width) {
+    (void)width;
+    accesses++;
+    if (offset == 0x01) {
+      cmd = (uint8_t)data;
+      count = 0;
+      if ((cmd >= S1D13700_CSRDIR) && (cmd <= S1D13700_CSRDIR + 3)) {
+        static const uint16_t steps[] = { 1, 0xFFFF, (uint16_t)-STRIDE, STRIDE };
+        step = steps[cmd - S1D13700_CSRDIR];
+      }
+      return;
+    }
+
+    if (count < sizeof(params))
+      params[count] = (uint8_t)data;
+    count++;
+
+    if ((cmd == S1D13700_CSRW) && (count == 2))
+      cursor = params[0] | (params[1] << 8);
+    else if ((cmd == S1D13700_SCROLL) && (count == 5))
+      start = params[3] | (params[4] << 8);
+    else if (cmd == S1D13700_HDOT_SCR)
+      hdot = params[0] & 7;
+    else if (cmd == S1D13700_MWRITE) {
+      memory[cursor] = (uint8_t)data;
+      cursor += step;
+    }
+  }
+
+  // What the panel shows at x, y
+  bool pixel(uint16_t x, uint16_t y) {
+    uint32_t bit = x + hdot;
+    return (memory[(uint16_t)(start + y * STRIDE + bit / 8)] >> (7 - (bit & 7))) & 1;
+  }
+
+  uint8_t memory[0x10000];
+  uint16_t cursor;
+  uint16_t step;
+  uint8_t cmd;
+  uint8_t params[8];
+  uint8_t count;
+  uint16_t start;
+  uint8_t hdot;
+  uint32_t accesses;
+};
+
+ModelLcd model;
+std::vector<bool> panel;
+
+void capture(std::vector<bool> &shown) {
+  shown.clear();
+  for (uint16_t y = 0; y < PANEL_LINES; y++) {
+    for (uint16_t x = 0; x < PANEL_WIDTH; x++)
+      shown.push_back(model.pixel(x, y));
+  }
+}
+#endif
+
+// One pixel with nothing but the cursor and memory commands
+void naivePixel(uint16_t x, uint16_t y, bool on) {
+  uint16_t address = GRAPHICS + y * STRIDE + (x >> 3);
+  uint8_t mask = 0x80 >> (x & 7);
+  uint8_t value;
+
+  lcd.setCursor(address);
+  lcd.memoryRead(&value, 1);
+  value = on ? (value | mask) : (value & ~mask);
+  lcd.setCursor(address);
+  lcd.memoryWrite(&value, 1);
+}
+
+bool imagePixel(uint16_t x, uint16_t y) {
+  return (image[y * STRIDE + (x >> 3)] >> (7 - (x & 7))) & 1;
+}
+
+void naiveLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, bool on) {
+  int16_t dx = (x1 > x0) ? x1 - x0 : x0 - x1;
+  int16_t dy = (y1 > y0) ? y0 - y1 : y1 - y0;
+  int16_t sx = (x0 < x1) ? 1 : -1;
+  int16_t sy = (y0 < y1) ? 1 : -1;
+  int16_t err = dx + dy;
+
+  for (;;) {
+    naivePixel(x0, y0, on);
+    if ((x0 == x1) && (y0 == y1))
+      break;
+    int16_t e2 = 2 * err;
+    if (e2 >= dy) {
+      err += dy;
+      x0 += sx;
+    }
+    if (e2 <= dx) {
+      err += dx;
+      y0 += sy;
+    }
+  }
+}
+
+void draw(Test_t test, bool naive) {
+  switch (test) {
+  case TEST_FILL:
+    if (!naive) {
+      lcd.fillRect(3, 5, 300, 200, true);
+    } else {
+      for (uint16_t y = 5; y < 205; y++) {
+        for (uint16_t x = 3; x < 303; x++)
+          naivePixel(x, y, true);
+      }
+    }
+    break;
+
+  case TEST_BLIT:
+    if (!naive) {
+      lcd.blit(13, 7, image, 200, 150, STRIDE);
+    } else {
+      for (uint16_t y = 0; y < 150; y++) {
+        for (uint16_t x = 0; x < 200; x++)
+          naivePixel(13 + x, 7 + y, imagePixel(x, y));
+      }
+    }
+    break;
+
+  case TEST_LINE:
+    if (!naive)
+      lcd.drawLine(0, 0, PANEL_WIDTH - 1, PANEL_LINES - 1, true);
+    else
+      naiveLine(0, 0, PANEL_WIDTH - 1, PANEL_LINES - 1, true);
+    break;
+
+  case TEST_SCROLL:
+    if (!naive) {
+      lcd.setScroll(12, 100);
+    } else {
+      for (uint16_t y = 0; y < PANEL_LINES; y++) {
+        for (uint16_t x = 0; x < PANEL_WIDTH; x++)
+          naivePixel(x, y, imagePixel(x + 12, y + 100));
+      }
+    }
+    break;
+
+  default:
+    break;
+  }
+}
+
+// Starting point for each run: the virtual screen holds the image and the
+// panel shows its top left corner
+void prepare(Test_t test) {
+  lcd.setScroll(0, 0);
+  if (test == TEST_SCROLL) {
+    lcd.setCursor(GRAPHICS);
+    lcd.memoryWrite(image, sizeof(image));
+  } else {
+    lcd.clear();
+  }
+}
+
+uint32_t measure(Test_t test, bool naive, uint32_t &bytes) {
+  prepare(test);
+#ifdef PARALLEL_HOST_SIM
+  model.accesses = 0;
+#endif
+
+  uint32_t start = micros();
+  draw(test, naive);
+  uint32_t elapsed = micros() - start;
+
+#ifdef PARALLEL_HOST_SIM
+  bytes = model.accesses;
+#else
+  bytes = 0;
+#endif
+  return elapsed;
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  // stripes and a checkerboard, so every byte differs from its neighbours
+  for (uint16_t y = 0; y < HEIGHT; y++) {
+    for (uint16_t x = 0; x < STRIDE; x++)
+      image[y * STRIDE + x] = (uint8_t)((((x + y / 8) & 1) ? 0xCC : 0x33) ^ y);
+  }
+
+#ifdef PARALLEL_HOST_SIM
+  ParallelSim.attach(1, &model);
+#endif
+
+  Parallel.begin(PARALLEL_BUS_WIDTH_8, PARALLEL_CS_1, 1, 1, 1);
+  Parallel.setAddressSetupTiming(5, 1, 5, 1);
+  Parallel.setPulseTiming(50, 60, 50, 60);
+  Parallel.setCycleTiming(110, 110);
+
+  lcd.begin(init, sizeof(init));
+  lcd.setLayout(0x0000, GRAPHICS, STRIDE, WIDTH, HEIGHT, PANEL_LINES);
+  lcd.setLayers(false, true);
+
+  for (uint8_t i = 0; i < TEST_COUNT; i++) {
+    Test_t test = (Test_t)i;
+    uint32_t fastBytes;
+    uint32_t naiveBytes;
+    uint32_t fast;
+    uint32_t naive;
+
+    fast = measure(test, false, fastBytes);
+#ifdef PARALLEL_HOST_SIM
+    capture(panel);
+#endif
+    naive = measure(test, true, naiveBytes);
+
+    Serial.print(names[test]);
+    Serial.print((unsigned long)fast);
+    Serial.print(" us, per pixel ");
+    Serial.print((unsigned long)naive);
+    Serial.print(" us");
+#ifdef PARALLEL_HOST_SIM
+    std::vector<bool> shown;
+    capture(shown);
+
+    Serial.print("; ");
+    Serial.print((unsigned long)fastBytes);
+    Serial.print(" bytes, per pixel ");
+    Serial.print((unsigned long)naiveBytes);
+    Serial.print(" bytes; ");
+    Serial.print(shown == panel ? "same picture" : "pictures DIFFER");
+#endif
+    Serial.println();
+  }
+}
+
+void loop() {
+}
+
+#ifdef PARALLEL_HOST_SIM
+int main() {
+  setup();
+  return 0;
+}
+#endif
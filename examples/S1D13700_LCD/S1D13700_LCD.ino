@@ -20,6 +20,7 @@
 */
 
 #include <Parallel.h>
+#include <ParallelS1D13700.h>
 
 #define LCDWIDTH 	320
 #define LCDHEIGHT	240
@@ -28,6 +29,7 @@
 int lcdOn = 46;
 int lcdReset = 44;
 uint8_t count = 0;
+ParallelS1D13700 lcd(Parallel);
 
 
 void setup() {
@@ -58,66 +60,17 @@ void loop() {
 }
 
 void configureLCD() {
-  Parallel.write(0x01, 0x40);
-  Parallel.write(0x00, 0x30);	// no origin comp, single panel, 8pix char 
-                                // height, internal CGROM
-  Parallel.write(0x00, 0x87);	// 8 pix char width
-  Parallel.write(0x00, 0x07);	// 8 pix char height (why twice?)
-  Parallel.write(0x00, 0x27);	// 40 chars wide
-  Parallel.write(0x00, 0x39);	
-  Parallel.write(0x00, 0xEF);	// 240 lines high
-  Parallel.write(0x00, 0x28);	// horizontal address range 40 (?)
-  Parallel.write(0x00, 0x00);
-
-  Parallel.write(0x01, 0x44);	// Screen block start addresses
-  Parallel.write(0x00, 0x00);	// Block 1 @ 0x0
-  Parallel.write(0x00, 0x00);
-  Parallel.write(0x00, 0xEF);	// 240 lines
-  Parallel.write(0x00, 0x60);	// Block 2 start address
-  Parallel.write(0x00, 0x09);	// 0x0960
-  Parallel.write(0x00, 0xEF);	// 240 lines
-  Parallel.write(0x00, 0x00);	// Block 3 start address (not used)
-  Parallel.write(0x00, 0x00);
-  Parallel.write(0x00, 0x00);	// Block 4 start address
-  Parallel.write(0x00, 0x00);
-
-  Parallel.write(0x01, 0x5A);	// Horizontal Scroll
-  Parallel.write(0x00, 0x00);	  // 0 bits
-	
-  Parallel.write(0x01, 0x5B);	// OVRLY
-  Parallel.write(0x00, 0x01);	// three layers, layer 3 text, layer 1 text, XOR
-	
-  Parallel.write(0x01, 0x5D);	// cursor mode
-  Parallel.write(0x00, 0x07);	// 8 bits wide
-  Parallel.write(0x00, 0x87);	// Block style, 8 bits high
-  
-  // Cursor direction	
-  Parallel.write(0x01, 0x4C);
+  // 320x240, text layer at 0x0000 and graphics layer at 0x0960
+  lcd.begin();
 
   // clear text layer
-  Parallel.write(0x01, 0x46);
-  Parallel.write(0x00, 0x00);
-  Parallel.write(0x00, 0x00);
-  
-  Parallel.write(0x01, 0x42);
-  for (int i=0; i < 40*30; i++)
-  {
-	  Parallel.write(0x00, ' ');
-  }
-	
+  lcd.setCursor(0x0000);
+  lcd.memoryFill(' ', 40*30);
+
   // draw vertical lines 
-  Parallel.write(0x01, 0x46);
-  Parallel.write(0x00, 0x60);
-  Parallel.write(0x00, 0x09);
-	
-  Parallel.write(0x01, 0x42);
-  for (int i=0; i < ((LCDWIDTH*LCDHEIGHT)/(8/BPP)); i++)	
-  {
-	Parallel.write(0x00, 0x55);
-  }
+  lcd.setCursor(0x0960);
+  lcd.memoryFill(0x55, (LCDWIDTH*LCDHEIGHT)/(8/BPP));
   
   // Turn display on	
-  Parallel.write(0x01, 0x59);		// DISP_ON
-  Parallel.write(0x00, 0x16);
+  lcd.displayOn(0x16);
 }
-
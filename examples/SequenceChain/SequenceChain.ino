@@ -0,0 +1,249 @@
+/*
+  Builds a ParallelSequence for an S1D13700 on NCS1 (A0 on A0): two cursor
+  set and memory write commands, each followed by pixel data.  The first
+  block of pixels is 10000 bytes, so it is split over three descriptors.
+  Once the sequence is nearly full, one more 10000 byte block is added,
+  which can't fit, so add() has to take back the descriptors it had already
+  used.  A last command goes in after that.
+
+  The sketch walks the descriptor chain the DMAC will follow and checks
+  each descriptor's destination, length, control words and the bytes it
+  points at against what was added, then sends the sequence with writeAsync().
+
+  The sketch also builds on a Linux host against the simulator, which runs
+  the descriptor chain through its DMAC model.  There it also sends the
+  same writes with a write() call per byte and checks that the bus sees
+  exactly the same accesses both ways:
+
+    g++ -std=gnu++11 -DPARALLEL_HOST_SIM -I. *.cpp -x c smc.c \
+        -x c++ examples/SequenceChain/SequenceChain.ino
+
+  This sketch is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Parallel.h>
+#include <ParallelSequence.h>
+
+#define LCD_DATA	0x00
+#define LCD_COMMAND	0x01
+#define CSRW		0x46
+#define MWRITE		0x42
+#define DISP_ON		0x59
+#define MAX_WRITES	32
+
+// Every descriptor copies incrementing SRAM into one fixed bus address
+#define CTRLB	(DMAC_CTRLB_SRC_DSCR_FETCH_FROM_MEM \
+		| DMAC_CTRLB_DST_DSCR_FETCH_FROM_MEM \
+		| DMAC_CTRLB_FC_MEM2MEM_DMA_FC \
+		| DMAC_CTRLB_SRC_INCR_INCREMENTING \
+		| DMAC_CTRLB_DST_INCR_FIXED)
+
+// One add() that the sequence took, to check it against and replay
+typedef struct {
+  uint32_t offset;
+  const uint8_t *src;
+  size_t n;
+} Write_t;
+
+ParallelSequence sequence(Parallel);
+uint8_t pixels[10000];
+uint8_t moreParams[2] = { 0x00, 0x40 };
+uint8_t morePixels[5000];
+
+Write_t writes[MAX_WRITES];
+uint8_t writeCount;
+uint8_t bytes[MAX_WRITES];
+bool built;
+
+#ifdef PARALLEL_HOST_SIM
+std::vector<ParallelSimAccess_t> perByte;
+#endif
+
+bool add(uint32_t offset, const uint8_t *src, size_t n, bool single) {
+  uint8_t segments = sequence.segmentCount();
+  uint32_t total = sequence.byteCount();
+  bool ok = single ? sequence.add(offset, *src) : sequence.add(offset, src, n);
+
+  if (ok) {
+    Write_t w = { offset, src, n };
+    writes[writeCount++] = w;
+  } else if ((sequence.segmentCount() != segments) || (sequence.byteCount() != total)) {
+    // a refused add() has to leave the sequence as it was
+    built = false;
+  }
+  return ok;
+}
+
+bool addBuffer(uint32_t offset, const uint8_t *src, size_t n) {
+  return (writeCount < MAX_WRITES) && add(offset, src, n, false);
+}
+
+// Single bytes are kept here too, as the sequence's copy of them is private
+bool addByte(uint32_t offset, uint8_t value) {
+  if (writeCount >= MAX_WRITES)
+    return false;
+  bytes[writeCount] = value;
+  return add(offset, &bytes[writeCount], 1, true);
+}
+
+// Follows the chain from descriptors() and checks it describes the writes,
+// byte for byte, in order
+bool walk() {
+  const ParallelDmaDescriptor_t *d = sequence.descriptors();
+  uint8_t w = 0;
+  size_t done = 0;
+  uint8_t count = 0;
+  uint32_t total = 0;
+
+  for ( ; d != NULL; d = (const ParallelDmaDescriptor_t *)d->nextDescriptor) {
+    uint32_t n = d->ctrlA & DMAC_CTRLA_BTSIZE_Msk;
+
+    Serial.print("  descriptor ");
+    Serial.print((unsigned long)count);
+    Serial.print(": offset ");
+    Serial.print((unsigned long)(d->destAddr - Parallel.getAddress()));
+    Serial.print(", ");
+    Serial.print((unsigned long)n);
+    Serial.println(" bytes");
+
+    if ((n == 0) || (n > PARALLEL_DMA_MAX_BLOCK) || (d->ctrlB != CTRLB))
+      return false;
+
+    // Consecutive single bytes to the same offset share a descriptor, and
+    // the bytes are copies, so what it sends is compared rather than where
+    // it sends it from
+    const uint8_t *src = (const uint8_t *)(uintptr_t)d->sourceAddr;
+    while (n > 0) {
+      if ((w >= writeCount) || (d->destAddr != Parallel.getAddress() + writes[w].offset))
+        return false;
+
+      size_t take = writes[w].n - done;
+      if (take > n)
+        take = n;
+      if (memcmp(src, writes[w].src + done, take) != 0)
+        return false;
+
+      src += take;
+      n -= take;
+      done += take;
+      total += take;
+      if (done == writes[w].n) {
+        w++;
+        done = 0;
+      }
+    }
+    count++;
+  }
+
+  return (w == writeCount) && (count == sequence.segmentCount()) && (total == sequence.byteCount());
+}
+
+void build() {
+  uint8_t blocks = 0;
+
+  built = true;
+  sequence.clear();
+  writeCount = 0;
+
+  built = addByte(LCD_COMMAND, CSRW) && built;
+  built = addByte(LCD_DATA, 0x00) && built;		// cursor low and high,
+  built = addByte(LCD_DATA, 0x00) && built;		// one descriptor
+  built = addByte(LCD_COMMAND, MWRITE) && built;
+  built = addBuffer(LCD_DATA, pixels, sizeof(pixels)) && built;
+
+  built = addByte(LCD_COMMAND, CSRW) && built;
+  built = addBuffer(LCD_DATA, moreParams, sizeof(moreParams)) && built;
+  built = addByte(LCD_COMMAND, MWRITE) && built;
+  built = addBuffer(LCD_DATA, morePixels, sizeof(morePixels)) && built;
+
+  // Fill up with 10000 byte blocks until one doesn't fit.  With one or
+  // two descriptors left, the refused block has used them before running
+  // out, and add() must take them back.
+  while (addBuffer(LCD_DATA, pixels, sizeof(pixels)))
+    blocks++;
+  uint8_t left = PARALLEL_SEQUENCE_MAX_SEGMENTS - sequence.segmentCount();
+  built = (blocks > 0) && (left > 0) && (left < 3) && built;
+
+  built = addByte(LCD_COMMAND, DISP_ON) && built;
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  for (size_t i = 0; i < sizeof(pixels); i++)
+    pixels[i] = (uint8_t)(i * 5 + (i >> 8));
+  for (size_t i = 0; i < sizeof(morePixels); i++)
+    morePixels[i] = (uint8_t)~i;
+
+  Parallel.begin(PARALLEL_BUS_WIDTH_8, PARALLEL_CS_1, 1, 0, 1);
+  Parallel.setAddressSetupTiming(5, 1, 5, 1);
+  Parallel.setPulseTiming(50, 60, 50, 60);
+  Parallel.setCycleTiming(110, 110);
+
+  build();
+  Serial.print((unsigned long)writeCount);
+  Serial.print(" writes, ");
+  Serial.print((unsigned long)sequence.byteCount());
+  Serial.print(" bytes in ");
+  Serial.print((unsigned long)sequence.segmentCount());
+  Serial.println(built ? " descriptors, rollback right" : " descriptors, build WRONG");
+
+  bool chained = walk();
+  Serial.println(chained ? "chain right" : "chain WRONG");
+
+#ifdef PARALLEL_HOST_SIM
+  ParallelSim.setTrace(true);
+  for (uint8_t w = 0; w < writeCount; w++) {
+    for (size_t i = 0; i < writes[w].n; i++)
+      Parallel.write(writes[w].offset, writes[w].src[i]);
+  }
+  perByte = ParallelSim.trace();
+  ParallelSim.clearTrace();
+#endif
+
+  uint32_t start = micros();
+  Parallel.writeAsync(sequence);
+  Parallel.wait();
+  Serial.print("sent in ");
+  Serial.print((unsigned long)(micros() - start));
+  Serial.print(" us");
+
+#ifdef PARALLEL_HOST_SIM
+  const std::vector<ParallelSimAccess_t> &trace = ParallelSim.trace();
+  bool same = (trace.size() == perByte.size());
+
+  for (size_t i = 0; same && (i < trace.size()); i++) {
+    same = (trace[i].address == perByte[i].address)
+      && (trace[i].data == perByte[i].data)
+      && (trace[i].read == perByte[i].read);
+  }
+  Serial.print("; ");
+  Serial.print((unsigned long)trace.size());
+  Serial.print(" accesses, per byte ");
+  Serial.print((unsigned long)perByte.size());
+  Serial.print(same ? ", same accesses" : ", accesses DIFFER");
+#endif
+  Serial.println();
+}
+
+void loop() {
+}
+
+#ifdef PARALLEL_HOST_SIM
+int main() {
+  setup();
+  return 0;
+}
+#endif
@@ -0,0 +1,234 @@
+/*
+  Draws text on an S1D13700 panel (CFAG320240 on NCS1, A0 on A0) with a
+  5x7 font, once a glyph at a time with a blit() each and once through a
+  ParallelTextCache, which renders each string in SRAM and sends it as one
+  blit().  Two workloads are timed: a menu of four labels redrawn over and
+  over, which the cache only renders once, and a counter that changes on
+  every redraw, which it renders every time.  The sketch prints glyphs
+  drawn per second for each.
+
+  The sketch also builds on a Linux host against the simulator, where a
+  model controller also counts the bytes on the bus per string and checks
+  that both ways leave the same picture on the panel.  The simulator only
+  models bus time, so rendering into the cache is free there:
+
+    g++ -std=gnu++11 -DPARALLEL_HOST_SIM -I. *.cpp -x c smc.c \
+        -x c++ examples/TextBenchmark/TextBenchmark.ino
+
+  This sketch is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Parallel.h>
+#include <ParallelS1D13700.h>
+#include <ParallelFont.h>
+
+#define STRIDE		40
+#define GRAPHICS	0x0960
+#define GLYPHS		96
+
+const uint16_t redraws = 100;
+
+const char *labels[] = { "Volume", "Brightness", "Contrast", "Back" };
+
+// Column-major 5x7 glyphs.  Made up rather than a real typeface: every one
+// is a different pattern, which is all a benchmark needs.
+uint8_t columns[GLYPHS * 5];
+const ParallelFont_t fontInfo = { columns, 5, 7, 0x20, GLYPHS, PARALLEL_FONT_COLUMNS };
+uint8_t packed[GLYPHS * 7];
+
+ParallelS1D13700 lcd(Parallel);
+uint8_t shadow[STRIDE * 240];
+ParallelFont font;
+ParallelTextCache cache(font);
+
+#ifdef PARALLEL_HOST_SIM
+// The controller's cursor, auto-increment and display memory, with every
+// access counted
+class ModelLcd : public ParallelSimDevice {
+public:
+  ModelLcd() : cursor(0), step(1), cmd(0), count(0), accesses(0) {}
+
+  virtual uint16_t read(uint32_t offset, uint8_t width) {
+    (void)width;
+    accesses++;
+    if (offset != 0x01)
+      return 0;
+    uint8_t value = memory[cursor];
+    cursor += step;
+    return value;
+  }
+
+  virtual void write(uint32_t offset, uint16_t data, uint8_t width) {
+    (void)width;
+    accesses++;
+    if (offset == 0x01) {
+      cmd = (uint8_t)data;
+      count = 0;
+      if ((cmd >= S1D13700_CSRDIR) && (cmd <= S1D13700_CSRDIR + 3)) {
+        static const uint16_t steps[] = { 1, 0xFFFF, (uint16_t)-STRIDE, STRIDE };
+        step = steps[cmd - S1D13700_CSRDIR];
+      }
+      return;
+    }
+
+    if (count < sizeof(params))
+      params[count] = (uint8_t)data;
+    count++;
+
+    if ((cmd == S1D13700_CSRW) && (count == 2))
+      cursor = params[0] | (params[1] << 8);
+    else if (cmd == S1D13700_MWRITE) {
+      memory[cursor] = (uint8_t)data;
+      cursor += step;
+    }
+  }
+
+  uint8_t memory[0x10000];
+  uint16_t cursor;
+  uint16_t step;
+  uint8_t cmd;
+  uint8_t params[8];
+  uint8_t count;
+  uint32_t accesses;
+};
+
+ModelLcd model;
+std::vector<uint8_t> panel;
+
+void capture(std::vector<uint8_t> &shown) {
+  shown.assign(&model.memory[GRAPHICS], &model.memory[GRAPHICS + sizeof(shadow)]);
+}
+#endif
+
+// A glyph at a time, straight from the packed font
+void drawGlyphs(uint16_t x, uint16_t y, const char *text) {
+  for (; *text; text++) {
+    const uint8_t *glyph = font.glyph(*text);
+
+    if (glyph != NULL)
+      lcd.blit(x, y, glyph, font.width(), font.height(), font.rowBytes());
+    x += font.advance();
+  }
+}
+
+void draw(uint16_t x, uint16_t y, const char *text, bool cached) {
+  if (cached)
+    cache.draw(lcd, x, y, text);
+  else
+    drawGlyphs(x, y, text);
+}
+
+// Returns glyphs drawn
+uint32_t drawMenu(bool cached) {
+  uint32_t glyphs = 0;
+
+  for (uint16_t i = 0; i < redraws; i++) {
+    for (uint8_t j = 0; j < 4; j++) {
+      draw(3, 10 + j * 10, labels[j], cached);
+      glyphs += strlen(labels[j]);
+    }
+  }
+  return glyphs;
+}
+
+uint32_t drawCounter(bool cached) {
+  uint32_t glyphs = 0;
+  char text[16];
+
+  for (uint16_t i = 0; i < redraws * 4; i++) {
+    sprintf(text, "Count %05u", (unsigned)(i * 7919));
+    draw(3, 60, text, cached);
+    glyphs += strlen(text);
+  }
+  return glyphs;
+}
+
+void run(const char *name, bool menu, bool cached) {
+  lcd.clear();
+  cache.invalidate();
+#ifdef PARALLEL_HOST_SIM
+  model.accesses = 0;
+#endif
+  uint32_t hits = cache.hits();
+  uint32_t misses = cache.misses();
+
+  uint32_t start = micros();
+  uint32_t glyphs = menu ? drawMenu(cached) : drawCounter(cached);
+  uint32_t elapsed = micros() - start;
+
+  Serial.print(name);
+  Serial.print(cached ? ", cached:    " : ", per glyph: ");
+  Serial.print((unsigned long)((uint64_t)glyphs * 1000000 / elapsed));
+  Serial.print(" glyphs/s");
+  if (cached) {
+    Serial.print(", ");
+    Serial.print((unsigned long)(cache.hits() - hits));
+    Serial.print(" hits ");
+    Serial.print((unsigned long)(cache.misses() - misses));
+    Serial.print(" misses");
+  }
+#ifdef PARALLEL_HOST_SIM
+  Serial.print(", ");
+  Serial.print((unsigned long)(model.accesses / (redraws * 4)));
+  Serial.print(" bytes/string");
+
+  if (!cached) {
+    capture(panel);
+  } else {
+    std::vector<uint8_t> shown;
+    capture(shown);
+    Serial.print(shown == panel ? ", same picture" : ", pictures DIFFER");
+  }
+#endif
+  Serial.println();
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  for (uint16_t i = 0; i < sizeof(columns); i++)
+    columns[i] = (uint8_t)((i * 37 + (i / 5) * 11) & 0x7F);
+
+#ifdef PARALLEL_HOST_SIM
+  ParallelSim.attach(1, &model);
+#endif
+
+  Parallel.begin(PARALLEL_BUS_WIDTH_8, PARALLEL_CS_1, 1, 1, 1);
+  Parallel.setAddressSetupTiming(5, 1, 5, 1);
+  Parallel.setPulseTiming(50, 60, 50, 60);
+  Parallel.setCycleTiming(110, 110);
+
+  lcd.begin();
+  lcd.setShadow(shadow);
+  lcd.setLayers(false, true);
+
+  font.begin(fontInfo, packed);
+  font.setSpacing(1);
+
+  run("menu", true, false);
+  run("menu", true, true);
+  run("counter", false, false);
+  run("counter", false, true);
+}
+
+void loop() {
+}
+
+#ifdef PARALLEL_HOST_SIM
+int main() {
+  setup();
+  return 0;
+}
+#endif
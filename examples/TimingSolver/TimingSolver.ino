@@ -0,0 +1,165 @@
+/*
+  Checks parallelSolveTiming() against hand worked data sheet profiles,
+  including the points where the SMC's non-linear SETUP, PULSE and CYCLE
+  encodings jump (more than 31 setup, 63 pulse or 127 cycle clocks) and
+  profiles too slow to encode at all.  Each case is solved at compile time
+  and checked with static_assert(), so the sketch only builds if the
+  solver is right, then solved again at run time, programmed into NCS0 and
+  printed with the bus throughput it gives.
+
+  At 84 MHz one MCK cycle is 11.9 ns, so for example a 751 ns pulse needs
+  64 cycles, which PULSE can't encode; the next value it can is 256.
+
+  The sketch also builds on a Linux host against the simulator, which
+  decodes the SMC registers on its own and records the NWE/NRD edges of
+  every access, so it also checks that the programmed registers give the
+  pulse and cycle lengths the solver reported:
+
+    g++ -std=gnu++11 -DPARALLEL_HOST_SIM -I. *.cpp -x c smc.c \
+        -x c++ examples/TimingSolver/TimingSolver.ino
+
+  This sketch is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Parallel.h>
+#include <ParallelTiming.h>
+
+#define MCK	84000000u
+
+// tAS, tPW, tAH, tCYC, tACC in ns, and the cycles each should solve to
+typedef struct {
+  const char *name;
+  ParallelTimingProfile_t profile;
+  uint16_t setup;
+  uint16_t writePulse;
+  uint16_t readPulse;
+  uint16_t writeCycles;
+  uint16_t readCycles;
+  bool valid;
+} Case_t;
+
+// 1 + 7 + 1 = 9 cycles of NCS, stretched to the 17 cycle minimum
+constexpr ParallelSmcTiming_t lcd = parallelSolveTiming({ 10, 80, 10, 200, 0 }, MCK);
+static_assert(lcd.valid, "LCD profile");
+static_assert(lcd.writeCycles == 17, "LCD write cycle");
+static_assert(lcd.readCycles == 17, "LCD read cycle");
+
+// The read pulse covers the 120 ns access time: 11 cycles
+constexpr ParallelSmcTiming_t sram = parallelSolveTiming({ 30, 60, 10, 0, 120 }, MCK);
+static_assert(sram.valid && (sram.writeCycles == 10) && (sram.readCycles == 15), "SRAM profile");
+
+// 750 ns is 63 cycles of pulse, the most PULSE encodes linearly
+constexpr ParallelSmcTiming_t pulse63 = parallelSolveTiming({ 0, 750, 0, 0, 0 }, MCK);
+static_assert(pulse63.valid && (pulse63.writeCycles == 63), "63 cycle pulse");
+
+// 751 ns is 64, which rounds up to 256, and so does the cycle
+constexpr ParallelSmcTiming_t pulse64 = parallelSolveTiming({ 0, 751, 0, 0, 0 }, MCK);
+static_assert(pulse64.valid && (pulse64.writeCycles == 256), "64 cycle pulse");
+
+// 1511 ns is 127 cycles, 1512 ns is 128, which CYCLE rounds up to 256
+constexpr ParallelSmcTiming_t cycle127 = parallelSolveTiming({ 0, 10, 0, 1511, 0 }, MCK);
+constexpr ParallelSmcTiming_t cycle128 = parallelSolveTiming({ 0, 10, 0, 1512, 0 }, MCK);
+static_assert(cycle127.valid && (cycle127.writeCycles == 127), "127 cycle cycle");
+static_assert(cycle128.valid && (cycle128.writeCycles == 256), "128 cycle cycle");
+
+// 32 cycles of setup rounds up to 128, which makes the NCS pulse 129, and
+// that rounds up to 256
+constexpr ParallelSmcTiming_t setup32 = parallelSolveTiming({ 375, 10, 0, 0, 0 }, MCK);
+static_assert(setup32.valid && (setup32.writeCycles == 256), "32 cycle setup");
+
+// 3810 ns is 321 cycles, past the longest pulse (319)
+constexpr ParallelSmcTiming_t tooSlow = parallelSolveTiming({ 0, 3810, 0, 0, 0 }, MCK);
+static_assert(!tooSlow.valid, "pulse too long");
+static_assert(parallelWriteBytesPerSecond(tooSlow, 1, MCK) == 0, "no throughput");
+
+const Case_t cases[] = {
+  { "LCD       ", { 10, 80, 10, 200, 0 },   1, 7, 7, 17, 17, true },
+  { "SRAM      ", { 30, 60, 10, 0, 120 },   3, 6, 11, 10, 15, true },
+  { "pulse 63  ", { 0, 750, 0, 0, 0 },      0, 63, 63, 63, 63, true },
+  { "pulse 64  ", { 0, 751, 0, 0, 0 },      0, 256, 256, 256, 256, true },
+  { "cycle 127 ", { 0, 10, 0, 1511, 0 },    0, 1, 1, 127, 127, true },
+  { "cycle 128 ", { 0, 10, 0, 1512, 0 },    0, 1, 1, 256, 256, true },
+  { "setup 32  ", { 375, 10, 0, 0, 0 },     128, 1, 1, 256, 256, true },
+  { "too slow  ", { 0, 3810, 0, 0, 0 },     0, 0, 0, 0, 0, false },
+};
+
+#ifdef PARALLEL_HOST_SIM
+// Setup, pulse and cycle of the last access in the trace
+bool edges(const Case_t &c, bool read) {
+  const ParallelSimAccess_t &a = ParallelSim.trace().back();
+  return (a.read == read)
+    && (a.strobeFall == c.setup)
+    && (a.strobeRise - a.strobeFall == (read ? c.readPulse : c.writePulse))
+    && (a.cycle == (read ? c.readCycles : c.writeCycles));
+}
+#endif
+
+void setup() {
+  Serial.begin(115200);
+
+  Parallel.begin(PARALLEL_BUS_WIDTH_8, PARALLEL_CS_0, 16, 1, 1);
+#ifdef PARALLEL_HOST_SIM
+  ParallelSim.setTrace(true);
+#endif
+
+  uint8_t failures = 0;
+
+  for (uint8_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    const Case_t &c = cases[i];
+    ParallelSmcTiming_t timing = parallelSolveTiming(c.profile, MCK);
+    bool ok = (timing.valid == c.valid);
+
+    Serial.print(c.name);
+    if (timing.valid) {
+      ok = ok && (timing.writeCycles == c.writeCycles) && (timing.readCycles == c.readCycles);
+
+      Parallel.setTiming(timing);
+      ok = ok && (Parallel.getWriteCycles() == c.writeCycles) && (Parallel.getReadCycles() == c.readCycles);
+
+      Serial.print((unsigned long)timing.writeCycles);
+      Serial.print("/");
+      Serial.print((unsigned long)timing.readCycles);
+      Serial.print(" cycles, ");
+      Serial.print((unsigned long)(parallelWriteBytesPerSecond(timing, 1, MCK) / 1000));
+      Serial.print("/");
+      Serial.print((unsigned long)(parallelReadBytesPerSecond(timing, 1, MCK) / 1000));
+      Serial.print(" KB/s write/read");
+#ifdef PARALLEL_HOST_SIM
+      Parallel.write(0, 0x5A);
+      ok = ok && edges(c, false);
+      Parallel.read(0);
+      ok = ok && edges(c, true);
+#endif
+    } else {
+      Serial.print("invalid");
+    }
+
+    Serial.println(ok ? "" : "  WRONG");
+    if (!ok)
+      failures++;
+  }
+
+  Serial.println(failures == 0 ? "timing OK" : "timing WRONG");
+}
+
+void loop() {
+}
+
+#ifdef PARALLEL_HOST_SIM
+int main() {
+  setup();
+  return 0;
+}
+#endif
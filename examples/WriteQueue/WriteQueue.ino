@@ -0,0 +1,196 @@
+/*
+  Sends the same stream of writes to an index addressed LCD controller on
+  NCS0 (command register at A0 = 1, data at A0 = 0) three times: straight
+  to the bus, through a ParallelWriteQueue flushed at random points, and
+  through one that flushes itself at a threshold.  The stream mixes single
+  commands with runs of pixel data up to 400 bytes long, so runs are merged
+  into blocks, cut at the end of the ring buffer and split by the queue
+  filling up.  Each pass prints how long it took.
+
+  The sketch also builds on a Linux host against the simulator, where it
+  records every bus access of each pass and checks that the queued passes
+  put exactly the same addresses and data on the bus, in the same order, as
+  the direct one:
+
+    g++ -std=gnu++11 -DPARALLEL_HOST_SIM -I. *.cpp -x c smc.c \
+        -x c++ examples/WriteQueue/WriteQueue.ino
+
+  This sketch is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Parallel.h>
+#include <ParallelQueue.h>
+
+#define LCD_DATA	0x00
+#define LCD_COMMAND	0x01
+
+const uint32_t updates = 2000;
+
+typedef enum {
+  PASS_DIRECT,
+  PASS_FLUSHED,
+  PASS_THRESHOLD
+} Pass_t;
+
+ParallelWriteQueue queue(Parallel);
+uint8_t pixels[512];
+
+uint32_t seed;
+uint32_t writes;
+uint32_t runs;
+uint32_t wraps;
+uint32_t lastOffset;
+
+#ifdef PARALLEL_HOST_SIM
+std::vector<ParallelSimAccess_t> direct;
+#endif
+
+// Same sequence of numbers on every pass
+uint32_t nextRandom(uint32_t range) {
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 16) % range;
+}
+
+void send(Pass_t pass, uint32_t offset, const uint8_t *src, size_t n) {
+  if (offset != lastOffset)
+    runs++;
+  lastOffset = offset;
+  writes += n;
+
+  if (pass != PASS_DIRECT) {
+    if (n == 1)
+      queue.write(offset, *src);
+    else
+      queue.write(offset, src, n);
+  } else if (n == 1) {
+    Parallel.write(offset, *src);
+  } else {
+    Parallel.writeBlock(offset, src, n);
+  }
+}
+
+void flush() {
+  // everything written and not pending has been sent, so that is where
+  // the ring buffer's tail is
+  uint32_t pending = queue.pending();
+  uint32_t tail = (writes - pending) % PARALLEL_QUEUE_SIZE;
+
+  if (tail + pending > PARALLEL_QUEUE_SIZE)
+    wraps++;
+  queue.flush();
+}
+
+void run(Pass_t pass) {
+  seed = 1;
+  writes = 0;
+  runs = 0;
+  wraps = 0;
+  lastOffset = 0xFFFFFFFF;
+  queue.setThreshold(pass == PASS_THRESHOLD ? 100 : 0);
+#ifdef PARALLEL_HOST_SIM
+  ParallelSim.clearTrace();
+#endif
+
+  uint32_t start = micros();
+
+  for (uint32_t i = 0; i < updates; i++) {
+    uint8_t command = (uint8_t)nextRandom(0x100);
+    send(pass, LCD_COMMAND, &command, 1);
+
+    // some commands have parameters, most are followed by pixels
+    uint32_t kind = nextRandom(4);
+    if (kind == 0) {
+      send(pass, LCD_DATA, &pixels[nextRandom(256)], 1 + nextRandom(3));
+    } else if (kind != 1) {
+      size_t n = 1 + nextRandom(400);
+      send(pass, LCD_DATA, &pixels[nextRandom(sizeof(pixels) - n)], n);
+    }
+
+    // drawn on every pass to keep the stream the same
+    bool flushNow = (nextRandom(3) == 0);
+    if ((pass == PASS_FLUSHED) && flushNow)
+      flush();
+  }
+
+  if (pass != PASS_DIRECT)
+    flush();
+
+  uint32_t elapsed = micros() - start;
+
+  static const char *names[] = { "direct:    ", "flushed:   ", "threshold: " };
+  Serial.print(names[pass]);
+  Serial.print((unsigned long)writes);
+  Serial.print(" writes in ");
+  Serial.print((unsigned long)runs);
+  Serial.print(" runs, ");
+  Serial.print((unsigned long)elapsed);
+  Serial.print(" us");
+  if (pass == PASS_FLUSHED) {
+    Serial.print(", ");
+    Serial.print((unsigned long)wraps);
+    Serial.print(" flushes across the ring end");
+  }
+#ifdef PARALLEL_HOST_SIM
+  const std::vector<ParallelSimAccess_t> &trace = ParallelSim.trace();
+
+  if (pass == PASS_DIRECT) {
+    direct = trace;
+  } else {
+    size_t match = 0;
+
+    while ((match < trace.size()) && (match < direct.size())
+      && (trace[match].address == direct[match].address)
+      && (trace[match].data == direct[match].data)
+      && (trace[match].read == direct[match].read))
+      match++;
+
+    bool same = (match == trace.size()) && (match == direct.size());
+    Serial.print(same ? ", same accesses" : ", accesses DIFFER at ");
+    if (!same)
+      Serial.print((unsigned long)match);
+  }
+#endif
+  Serial.println();
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  for (size_t i = 0; i < sizeof(pixels); i++)
+    pixels[i] = (uint8_t)(i * 7 + (i >> 8));
+
+  Parallel.begin(PARALLEL_BUS_WIDTH_8, PARALLEL_CS_0, 1, 1, 1);
+  Parallel.setAddressSetupTiming(1, 1, 1, 1);
+  Parallel.setPulseTiming(4, 4, 4, 4);
+  Parallel.setCycleTiming(6, 6);
+
+#ifdef PARALLEL_HOST_SIM
+  ParallelSim.setTrace(true);
+#endif
+
+  run(PASS_DIRECT);
+  run(PASS_FLUSHED);
+  run(PASS_THRESHOLD);
+}
+
+void loop() {
+}
+
+#ifdef PARALLEL_HOST_SIM
+int main() {
+  setup();
+  return 0;
+}
+#endif
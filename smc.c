@@ -344,6 +344,11 @@ void smc_nfc_set_bank(Smc *p_smc, uint32_t ul_bank)
 void smc_nfc_send_command(Smc *p_smc, uint32_t ul_cmd,
 		uint32_t ul_address_cycle, uint32_t ul_cycle0)
 {
+#ifdef PARALLEL_HOST_SIM
+	/* The command space isn't mapped on the host, hand it to the model. */
+	(void)p_smc;
+	parallelSimNfcCommand(ul_cmd, ul_address_cycle, ul_cycle0);
+#else
 	volatile uint32_t *p_command_address;
 
 	/* Wait until host controller is not busy. */
@@ -356,6 +361,7 @@ void smc_nfc_send_command(Smc *p_smc, uint32_t ul_cmd,
 	*p_command_address = ul_address_cycle;
 	while (!((p_smc->SMC_SR & SMC_SR_CMDDONE) == SMC_SR_CMDDONE)) {
 	}
+#endif
 }
 
 /**
@@ -45,7 +45,11 @@
 #define SMC_H_INCLUDED
 
 //#include "compiler.h"
+#ifdef PARALLEL_HOST_SIM
+#include "ParallelSim.h"
+#else
 #include "sam.h"
+#endif
 
 /// @cond 0
 /**INDENT-OFF**/